@@ -0,0 +1,185 @@
+#pragma once
+
+#include "v128.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <emmintrin.h> // __m128i
+#if defined(__AVX2__)
+#include <immintrin.h> // _mm256_permutevar8x32_epi32
+#elif defined(__SSE4_1__)
+#include <smmintrin.h> // _mm_blendv_epi8
+#elif defined(__SSSE3__)
+#include <tmmintrin.h> // _mm_shuffle_epi8
+#endif
+
+// Sorting 8 uint16 keys together with their payloads.
+//
+// argsort8 sorts the keys of a vector with the bitonic network of
+// sort8_network (see Sort8.hpp) and carries the lane numbers along, so it
+// also returns the sorting permutation: sorted lane j came from input lane
+// lanes[j]. The network compares (key, lane) pairs, so the sort is stable.
+// The permutation then moves payloads of any width: 16 bit payloads with
+// one pshufb, 32 and 64 bit payloads with AVX2 permutevar, and other
+// payloads with moves.
+//
+// The definitions are inline, like h8_inline.h, so that the header-only
+// heaps can sort their nodes with them. SSSE3, SSE4.1 and AVX2 are used
+// when enabled at compile time, with SSE2 fallbacks.
+
+struct Sorted8 {
+  __m128i keys;  // ascending
+  __m128i lanes; // sorted lane j came from lane lanes[j] of the input
+};
+
+// Lane i swapped with lane i ^ kDistance.
+template<int kDistance>
+inline __m128i argsort8Partner(__m128i v) {
+  if constexpr (kDistance == 1) {
+#if defined(__SSSE3__)
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+#else
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+#endif
+  } else if constexpr (kDistance == 2) {
+    return _mm_shuffle_epi32(v, 0xb1);
+  } else {
+    static_assert(kDistance == 4);
+    return _mm_shuffle_epi32(v, 0x4e);
+  }
+}
+
+// Lanes from b where mask is set, otherwise from a.
+inline __m128i argsort8Blend(__m128i a, __m128i b, __m128i mask) {
+#if defined(__SSE4_1__)
+  return _mm_blendv_epi8(a, b, mask);
+#else
+  return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+#endif
+}
+
+// The lanes that keep the maximum of a compare-exchange at distance j in
+// the bitonic merge of runs of length k, see loLanes in Sort8.cpp.
+template<int k, int j>
+inline __m128i argsort8HiLanes() {
+  auto hiLane = [](int i) -> short { return ((i & j) == 0) == ((i & k) == 0) ? 0 : -1; };
+  return _mm_setr_epi16(hiLane(0), hiLane(1), hiLane(2), hiLane(3),
+                        hiLane(4), hiLane(5), hiLane(6), hiLane(7));
+}
+
+// A compare-exchange layer of the bitonic merge of runs of length k at
+// distance j. The lanes that keep the minimum take their partner if it's
+// less, the other lanes if it's greater, which is when it isn't less
+// because no two (key, lane) pairs are equal. The keys are biased by
+// 0x8000 so the signed compares order them unsigned.
+template<int k, int j>
+inline void argsort8Layer(__m128i& keys, __m128i& lanes) {
+  __m128i pkeys = argsort8Partner<j>(keys);
+  __m128i planes = argsort8Partner<j>(lanes);
+  __m128i less = _mm_or_si128(
+      _mm_cmplt_epi16(pkeys, keys),
+      _mm_and_si128(_mm_cmpeq_epi16(pkeys, keys), _mm_cmplt_epi16(planes, lanes)));
+  __m128i take = _mm_xor_si128(less, argsort8HiLanes<k, j>());
+  keys = argsort8Blend(keys, pkeys, take);
+  lanes = argsort8Blend(lanes, planes, take);
+}
+
+// Sorts the 8 uint16 lanes of keys in ascending order, stably.
+inline Sorted8 argsort8(__m128i keys) {
+  const __m128i kBias = _mm_set1_epi16(-0x8000);
+  __m128i k = _mm_xor_si128(keys, kBias);
+  __m128i lanes = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+  argsort8Layer<2, 1>(k, lanes);
+  argsort8Layer<4, 2>(k, lanes);
+  argsort8Layer<4, 1>(k, lanes);
+  argsort8Layer<8, 4>(k, lanes);
+  argsort8Layer<8, 2>(k, lanes);
+  argsort8Layer<8, 1>(k, lanes);
+  return Sorted8{_mm_xor_si128(k, kBias), lanes};
+}
+
+// The pshufb control that moves 16 bit lanes like lanes: bytes 2 * l and
+// 2 * l + 1 for each lane l.
+inline __m128i argsort8Shuffle(__m128i lanes) {
+  return _mm_add_epi16(_mm_mullo_epi16(lanes, _mm_set1_epi16(0x0202)), _mm_set1_epi16(0x0100));
+}
+
+// The 8 uint16 payloads moved like lanes, i.e. lane j from lane lanes[j].
+inline __m128i permute8Epi16(__m128i payloads, __m128i lanes) {
+#if defined(__SSSE3__)
+  return _mm_shuffle_epi8(payloads, argsort8Shuffle(lanes));
+#else
+  v128 p = mm2v128(payloads), l = mm2v128(lanes), r;
+  for (std::size_t j = 0; j < 8; ++j) r.values[j] = p.values[l.values[j]];
+  return r.mm;
+#endif
+}
+
+// The 8 uint32 payloads in payloads[0, 2) moved like lanes.
+inline void permute8Epi32(__m128i* payloads, __m128i lanes) {
+#if defined(__AVX2__)
+  __m256i p = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(payloads));
+  p = _mm256_permutevar8x32_epi32(p, _mm256_cvtepu16_epi32(lanes));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(payloads), p);
+#else
+  std::uint32_t p[8], r[8];
+  v128 l = mm2v128(lanes);
+  std::memcpy(p, payloads, sizeof(p));
+  for (std::size_t j = 0; j < 8; ++j) r[j] = p[l.values[j]];
+  std::memcpy(payloads, r, sizeof(r));
+#endif
+}
+
+// The 8 uint64 payloads in payloads[0, 4) moved like lanes.
+inline void permute8Epi64(__m128i* payloads, __m128i lanes) {
+#if defined(__AVX2__)
+  __m256i lo = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(payloads));
+  __m256i hi = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(payloads + 2));
+  __m256i r[2];
+  for (int h = 0; h < 2; ++h) {
+    // Payloads 4h to 4h + 3 from lanes l, i.e. 32 bit lanes 2l and 2l + 1
+    // of lo if l < 4 and hi otherwise (permutevar only uses 3 bits).
+    __m256i l = _mm256_cvtepu16_epi64(h == 0 ? lanes : _mm_srli_si128(lanes, 8));
+    __m256i twice = _mm256_slli_epi64(l, 1);
+    __m256i index = _mm256_or_si256(
+        twice, _mm256_slli_epi64(_mm256_add_epi64(twice, _mm256_set1_epi64x(1)), 32));
+    __m256i fromHi = _mm256_cmpgt_epi64(l, _mm256_set1_epi64x(3));
+    r[h] = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(lo, index),
+                              _mm256_permutevar8x32_epi32(hi, index), fromHi);
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(payloads), r[0]);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(payloads + 2), r[1]);
+#else
+  std::uint64_t p[8], r[8];
+  v128 l = mm2v128(lanes);
+  std::memcpy(p, payloads, sizeof(p));
+  for (std::size_t j = 0; j < 8; ++j) r[j] = p[l.values[j]];
+  std::memcpy(payloads, r, sizeof(r));
+#endif
+}
+
+// Moves values[j] = values[lanes[j]] for j < n in place, where lanes[0, n)
+// is a permutation of [0, n), following its cycles with one temporary, so
+// the values only need to be move constructible and move assignable.
+// Values is anything indexable with T values, e.g. a T* or a vector<T>, or
+// a container with proxy references like PackedVector.
+template<class T, class Values>
+void permute8(Values&& values, __m128i lanes, std::size_t n) {
+  assert(n <= 8);
+  v128 l = mm2v128(lanes);
+  unsigned done = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (done & (1u << i) || l.values[i] == i) continue;
+    T t = std::move(values[i]);
+    std::size_t j = i;
+    for (std::size_t s = l.values[j]; s != i; j = s, s = l.values[j]) {
+      assert(s < n);
+      values[j] = std::move(values[s]);
+      done |= 1u << j;
+    }
+    values[j] = std::move(t);
+    done |= 1u << j;
+  }
+}
@@ -0,0 +1,132 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main Argsort8Test.cpp
+   ./a.out
+*/
+
+#include "Argsort8.hpp"
+#include "v128.h"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace std;
+
+constexpr uint16_t kMax = numeric_limits<uint16_t>::max();
+
+// The stable sorting permutation of v.
+v128 stdArgsort(v128 v) {
+  v128 lanes;
+  uint16_t* ls = reinterpret_cast<uint16_t*>(&lanes);
+  iota(ls, ls + 8, 0);
+  stable_sort(ls, ls + 8, [&](uint16_t a, uint16_t b) { return v.values[a] < v.values[b]; });
+  return lanes;
+}
+
+v128 gather(v128 v, v128 lanes) {
+  v128 r;
+  for (int j = 0; j < 8; ++j) r.values[j] = v.values[lanes.values[j]];
+  return r;
+}
+
+void expectArgsort(v128 v) {
+  Sorted8 s = argsort8(v.mm);
+  v128 lanes = stdArgsort(v);
+  ASSERT_EQ(lanes, mm2v128(s.lanes)) << v;
+  ASSERT_EQ(gather(v, lanes), mm2v128(s.keys)) << v;
+}
+
+TEST(argsort8, argsort8) {
+  v128 unsorted = { { kMax - 7, 0, kMax - 13, 3, 2, 3, 2, 3 } };
+  Sorted8 s = argsort8(unsorted.mm);
+  v128 sorted = { { 0, 2, 2, 3, 3, 3, kMax - 13, kMax - 7 } };
+  v128 lanes = { { 1, 4, 6, 3, 5, 7, 2, 0 } };
+  EXPECT_EQ(sorted, mm2v128(s.keys));
+  EXPECT_EQ(lanes, mm2v128(s.lanes));
+}
+
+// The network sorts all inputs if it sorts all 0/1 inputs, and they're
+// also the inputs with the most ties.
+TEST(argsort8, zeroOne) {
+  for (int bits = 0; bits < 256; ++bits) {
+    v128 v;
+    for (int i = 0; i < 8; ++i) v.values[i] = (bits >> i) & 1 ? kMax : 0;
+    expectArgsort(v);
+  }
+}
+
+TEST(argsort8, random) {
+  default_random_engine gen(0);
+  for (uint16_t max : {uint16_t(3), kMax}) {
+    uniform_int_distribution<uint16_t> distr(0, max);
+    for (int n = 0; n < 10000; ++n) {
+      v128 v;
+      for (int i = 0; i < 8; ++i) v.values[i] = distr(gen);
+      expectArgsort(v);
+    }
+  }
+}
+
+TEST(argsort8, permute) {
+  v128 keys = { { 5, 0, 7, 3, 5, 1, 0, 2 } };
+  Sorted8 s = argsort8(keys.mm);
+  v128 lanes = mm2v128(s.lanes);
+
+  v128 payloads16 = { { 50, 0, 70, 30, 51, 10, 1, 20 } };
+  EXPECT_EQ(mm2v128(s.keys), gather(keys, lanes));
+  v128 expected16 = { { 0, 1, 10, 20, 30, 50, 51, 70 } };
+  EXPECT_EQ(expected16, mm2v128(permute8Epi16(payloads16.mm, s.lanes)));
+
+  alignas(16) uint32_t payloads32[8] = {
+    50u << 20, 0, 70u << 20, 30u << 20, 51u << 20, 10u << 20, 1, 20u << 20 };
+  uint32_t expected32[8] = {
+    0, 1, 10u << 20, 20u << 20, 30u << 20, 50u << 20, 51u << 20, 70u << 20 };
+  permute8Epi32(reinterpret_cast<__m128i*>(payloads32), s.lanes);
+  EXPECT_TRUE(equal(payloads32, payloads32 + 8, expected32));
+
+  alignas(16) uint64_t payloads64[8];
+  uint64_t expected64[8];
+  for (int i = 0; i < 8; ++i) payloads64[i] = uint64_t(payloads16.values[i]) << 40 | i;
+  for (int i = 0; i < 8; ++i) expected64[i] = payloads64[lanes.values[i]];
+  permute8Epi64(reinterpret_cast<__m128i*>(payloads64), s.lanes);
+  EXPECT_TRUE(equal(payloads64, payloads64 + 8, expected64));
+}
+
+TEST(argsort8, permuteMoveOnly) {
+  default_random_engine gen(1);
+  uniform_int_distribution<uint16_t> distr(0, 5);
+  for (size_t n = 0; n <= 8; ++n) {
+    for (int r = 0; r < 100; ++r) {
+      // Lanes from n on keep kMax and sort after the values.
+      v128 keys = kV128Max;
+      for (size_t i = 0; i < n; ++i) keys.values[i] = distr(gen);
+      v128 lanes = mm2v128(argsort8(keys.mm).lanes);
+      unique_ptr<size_t> values[8];
+      for (size_t i = 0; i < 8; ++i) values[i].reset(new size_t(i));
+      permute8<unique_ptr<size_t>>(values, lanes.mm, n);
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_TRUE(values[i]) << n << " " << keys;
+        ASSERT_EQ(lanes.values[i], *values[i]) << n << " " << keys;
+      }
+      for (size_t i = n; i < 8; ++i) ASSERT_EQ(i, *values[i]);
+    }
+  }
+}
+
+TEST(argsort8, permuteVector) {
+  v128 lanes = { { 2, 0, 1, 4, 3, 5, 0, 0 } };
+  vector<string> values = {"c", "a", "b", "e", "d", "f"};
+  permute8<string>(values, lanes.mm, values.size());
+  EXPECT_EQ((vector<string>{"b", "c", "a", "d", "e", "f"}), values);
+}
+
+} // namespace
@@ -0,0 +1,427 @@
+#pragma once
+
+#include "KWayMerge.hpp"
+#include "Heap8Aux.hpp"
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+// External merge sort of fixed size records with 16 bit keys, for files
+// larger than memory.
+//
+// Run generation uses replacement selection on a Heap8Aux from keys to
+// records: the smallest record is written to the current run and replaced
+// in the heap by the next input record, unless that record's key is smaller
+// than the last one written, in which case it's held back in a second heap
+// for the next run. The current heap only shrinks during a run while the
+// other grows by the records it gives up, but a Heap8Aux doesn't give back
+// the memory of popped entries, so each heap reserves room for all the
+// records up front and gets half the memory. On random input the runs are
+// about twice the records in the heaps, which is about as many records as
+// fit in the memory, and sorted input is a single run.
+//
+// The runs are written with large sequential writes to anonymous temporary
+// files (unlinked as soon as they're created) and merged with a KWayMerger
+// whose cursors read each run a block at a time. After reading a block a
+// cursor asks the kernel to read ahead the next one (POSIX_FADV_WILLNEED),
+// so the disk reads overlap with the merge, in effect double buffering
+// each run through the page cache. If there are more runs than fit in
+// memory with a block each, groups of runs are merged into longer runs
+// first.
+//
+// I/O errors throw std::system_error.
+
+struct ExternalSortOptions {
+  // Memory for the run generation heaps and buffers and for the merge block
+  // buffers, see ExternalSorter::footprint.
+  std::size_t memory_bytes = std::size_t(256) << 20;
+  // Size of each read and write.
+  std::size_t block_bytes = std::size_t(1) << 20;
+  // Directory for the run files, defaults to $TMPDIR or /tmp.
+  std::string temp_dir;
+  // Generate runs of memory size with std::sort instead of replacement
+  // selection, for comparison.
+  bool sort_runs = false;
+};
+
+[[noreturn]] inline void externalSortThrowErrno(char const* what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Reads records from fd in blocks.
+template<class T> class ExternalSortReader {
+ public:
+  ExternalSortReader(int fd, std::size_t block_records)
+    : fd_(fd), buffer_(block_records), pos_(0), end_(0), eof_(false) { }
+
+  // Reads the next record into x, returns false at end of file.
+  bool next(T& x) {
+    if (pos_ == end_ && !fill()) return false;
+    x = buffer_[pos_++];
+    return true;
+  }
+
+ private:
+  bool fill() {
+    if (eof_) return false;
+    char* data = reinterpret_cast<char*>(buffer_.data());
+    std::size_t size = buffer_.size() * sizeof(T), n = 0;
+    while (n < size) {
+      ssize_t r = ::read(fd_, data + n, size - n);
+      if (r < 0) {
+        if (errno == EINTR) continue;
+        externalSortThrowErrno("read");
+      }
+      if (r == 0) {
+        eof_ = true;
+        break;
+      }
+      n += r;
+    }
+    if (n % sizeof(T) != 0) throw std::runtime_error("input ends with a partial record");
+    pos_ = 0;
+    end_ = n / sizeof(T);
+    return end_ > 0;
+  }
+
+  int fd_;
+  std::vector<T> buffer_;
+  std::size_t pos_;
+  std::size_t end_;
+  bool eof_;
+};
+
+// Writes records to fd in blocks.
+template<class T> class ExternalSortWriter {
+ public:
+  ExternalSortWriter(int fd, std::size_t block_records) : fd_(fd), count_(0) {
+    buffer_.reserve(block_records);
+  }
+
+  void put(T const& x) {
+    if (buffer_.size() == buffer_.capacity()) flush();
+    buffer_.push_back(x);
+  }
+
+  // Writes out the buffered records.
+  void flush() {
+    char const* data = reinterpret_cast<char const*>(buffer_.data());
+    std::size_t size = buffer_.size() * sizeof(T), n = 0;
+    while (n < size) {
+      ssize_t w = ::write(fd_, data + n, size - n);
+      if (w < 0) {
+        if (errno == EINTR) continue;
+        externalSortThrowErrno("write");
+      }
+      n += w;
+    }
+    count_ += buffer_.size();
+    buffer_.clear();
+  }
+
+  // Number of records flushed.
+  std::size_t count() const { return count_; }
+
+  // An output iterator for KWayMerger::merge.
+  struct Iterator {
+    typedef std::output_iterator_tag iterator_category;
+    typedef void value_type;
+    typedef void difference_type;
+    typedef void pointer;
+    typedef void reference;
+    Iterator& operator*() { return *this; }
+    Iterator& operator++() { return *this; }
+    Iterator& operator++(int) { return *this; }
+    Iterator& operator=(T const& x) { writer->put(x); return *this; }
+    ExternalSortWriter* writer;
+  };
+  Iterator iterator() { return Iterator{this}; }
+
+ private:
+  int fd_;
+  std::vector<T> buffer_;
+  std::size_t count_;
+};
+
+// KWayMerger cursor over a run of count records at the start of fd.
+template<class T, class KeyOf> class ExternalSortRunCursor {
+ public:
+  typedef T value_type;
+
+  ExternalSortRunCursor(int fd, std::size_t count, std::size_t block_records, KeyOf key_of)
+    : fd_(fd), remaining_(count), offset_(0), buffer_(std::min(count, block_records)),
+      pos_(0), end_(0), key_of_(key_of) {
+    fill();
+  }
+
+  bool empty() const { return pos_ == end_; }
+  std::uint16_t key() const { return key_of_(buffer_[pos_]); }
+  T const& value() const { return buffer_[pos_]; }
+  void next() {
+    if (++pos_ == end_) fill();
+  }
+  void prefetch() const {
+    constexpr std::size_t kDistance = 256 / sizeof(T) + 1;
+    if (pos_ + kDistance < end_) __builtin_prefetch(&buffer_[pos_ + kDistance]);
+  }
+
+ private:
+  void fill() {
+    std::size_t records = std::min(remaining_, buffer_.size());
+    char* data = reinterpret_cast<char*>(buffer_.data());
+    std::size_t size = records * sizeof(T), n = 0;
+    while (n < size) {
+      ssize_t r = ::pread(fd_, data + n, size - n, offset_ + n);
+      if (r < 0) {
+        if (errno == EINTR) continue;
+        externalSortThrowErrno("pread");
+      }
+      if (r == 0) throw std::runtime_error("run file is truncated");
+      n += r;
+    }
+    offset_ += size;
+    remaining_ -= records;
+    pos_ = 0;
+    end_ = records;
+#ifdef POSIX_FADV_WILLNEED
+    if (remaining_ > 0) {
+      std::size_t ahead = std::min(remaining_, buffer_.size()) * sizeof(T);
+      ::posix_fadvise(fd_, offset_, ahead, POSIX_FADV_WILLNEED);
+    }
+#endif
+  }
+
+  int fd_;
+  std::size_t remaining_;
+  off_t offset_;
+  std::vector<T> buffer_;
+  std::size_t pos_;
+  std::size_t end_;
+  KeyOf key_of_;
+};
+
+// Heap is the KWayMerger heap used to merge the runs.
+template<class T, class KeyOf = KeyIdentity, class Heap = Heap8Aux<std::uint32_t>>
+class ExternalSorter {
+  static_assert(std::is_trivially_copyable<T>::value);
+
+ public:
+  typedef T value_type;
+  typedef std::size_t size_type;
+
+  explicit ExternalSorter(ExternalSortOptions options = ExternalSortOptions(), KeyOf key_of = KeyOf())
+    : options_(std::move(options)), key_of_(key_of), run_count_(0), passes_(0), footprint_(0) {
+    if (options_.temp_dir.empty()) {
+      char const* tmpdir = std::getenv("TMPDIR");
+      options_.temp_dir = tmpdir ? tmpdir : "/tmp";
+    }
+    block_records_ = std::max<size_type>(1, options_.block_bytes / sizeof(T));
+    // Two blocks of the memory go to the input and output buffers, and
+    // each of the two heaps gets half the rest.
+    size_type block_bytes = block_records_ * sizeof(T);
+    size_type heap_bytes = options_.memory_bytes > 2 * block_bytes ? (options_.memory_bytes - 2 * block_bytes) / 2 : 0;
+    size_type heap_overhead = sizeof(SelectionHeap) + sizeof(v128); // and a partial node
+    heap_bytes = heap_bytes > heap_overhead ? heap_bytes - heap_overhead : 0;
+    heap_records_ = std::max<size_type>(1, heap_bytes / (sizeof(T) + sizeof(std::uint16_t)));
+    fan_in_ = std::max<size_type>(2, options_.memory_bytes / block_bytes - 1);
+  }
+
+  ~ExternalSorter() { close_runs(); }
+  ExternalSorter(const ExternalSorter&) = delete;
+  ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+  // Sorts the records read from in_fd to the end of file and writes them
+  // to out_fd. Returns the number of records.
+  size_type sort(int in_fd, int out_fd) {
+    close_runs();
+    passes_ = 0;
+    footprint_ = 0;
+    if (options_.sort_runs) {
+      sort_runs(in_fd);
+    } else {
+      select_runs(in_fd);
+    }
+    run_count_ = runs_.size();
+    size_type count = 0;
+    for (Run const& run : runs_) count += run.count;
+    while (runs_.size() > fan_in_) {
+      // Each merged run replaces its inputs in runs_ as soon as it's
+      // written, so runs_ always holds exactly the open runs for
+      // close_runs, also if a merge throws.
+      size_type size = runs_.size(), merged = 0;
+      runs_.reserve(size + 1);
+      for (size_type i = 0; i < size; i += fan_in_) {
+        size_type j = std::min(i + fan_in_, size);
+        if (j - i > 1) {
+          runs_.push_back(Run{temp_file(), 0});
+          runs_.back().count = merge_runs(i, j, runs_.back().fd);
+          for (size_type r = i; r < j; ++r) {
+            ::close(runs_[r].fd);
+            runs_[r].fd = -1;
+          }
+          runs_[i] = runs_.back();
+          runs_.pop_back();
+        }
+        // Slots before i hold merged runs or closed inputs.
+        if (merged < i) {
+          runs_[merged] = runs_[i];
+          runs_[i].fd = -1;
+        }
+        ++merged;
+      }
+      runs_.resize(merged);
+      ++passes_;
+    }
+    merge_runs(0, runs_.size(), out_fd);
+    ++passes_;
+    close_runs();
+    return count;
+  }
+
+  // Number of runs generated by the last sort.
+  size_type runs() const { return run_count_; }
+
+  // Number of merge passes over the data in the last sort.
+  size_type passes() const { return passes_; }
+
+  // Records per run file read or write.
+  size_type block_records() const { return block_records_; }
+
+  // Records in the run generation heaps.
+  size_type heap_records() const { return heap_records_; }
+
+  // Runs merged at once.
+  size_type fan_in() const { return fan_in_; }
+
+  // Bytes allocated for the run generation of the last sort, the heaps or
+  // the std::sort buffer and the input and output blocks, which is at most
+  // memory_bytes unless that's too small for the blocks and one record.
+  size_type footprint() const { return footprint_; }
+
+ private:
+  typedef ExternalSortRunCursor<T, KeyOf> Cursor;
+  typedef Heap8Aux<T> SelectionHeap;
+
+  struct Run {
+    int fd;
+    size_type count;
+  };
+
+  int temp_file() {
+    std::string path = options_.temp_dir + "/ExternalSort.XXXXXX";
+    int fd = ::mkstemp(&path[0]);
+    if (fd < 0) externalSortThrowErrno("mkstemp");
+    ::unlink(path.c_str());
+    return fd;
+  }
+
+  void close_runs() {
+    for (Run const& run : runs_) {
+      if (run.fd >= 0) ::close(run.fd);
+    }
+    runs_.clear();
+  }
+
+  // Replacement selection: heaps[cur] holds the records for the current
+  // run and heaps[!cur] those held back for the next, together at most
+  // heap_records_.
+  void select_runs(int in_fd) {
+    ExternalSortReader<T> reader(in_fd, block_records_);
+    SelectionHeap heaps[2];
+    heaps[0].reserve(heap_records_);
+    heaps[1].reserve(heap_records_);
+    footprint_ = heaps[0].footprint() + heaps[1].footprint() + 2 * block_records_ * sizeof(T);
+    int cur = 0;
+    T x;
+    while (heaps[cur].size() < heap_records_ && reader.next(x)) {
+      heaps[cur].push_entry(key_of_(x), x);
+    }
+    while (heaps[cur].size() > 0) {
+      Run run{temp_file(), 0};
+      runs_.push_back(run);
+      ExternalSortWriter<T> writer(run.fd, block_records_);
+      SelectionHeap& heap = heaps[cur];
+      SelectionHeap& next = heaps[!cur];
+      while (heap.size() > 0) {
+        size_type i = heap.top_index();
+        std::uint16_t last = heap.key(i);
+        writer.put(heap.mapped(i));
+        if (!reader.next(x)) {
+          heap.pop_entry();
+          continue;
+        }
+        std::uint16_t k = key_of_(x);
+        if (k >= last) {
+          // Faster than pop_entry followed by push_entry.
+          heap.push_down(k, x, i);
+        } else {
+          heap.pop_entry();
+          next.push_entry(k, x);
+        }
+      }
+      writer.flush();
+      runs_.back().count = writer.count();
+      cur = !cur;
+    }
+  }
+
+  // Load, std::sort and store runs of 2 * heap_records_ records, about as
+  // long as replacement selection's runs from random input.
+  void sort_runs(int in_fd) {
+    ExternalSortReader<T> reader(in_fd, block_records_);
+    std::vector<T> buffer;
+    buffer.reserve(2 * heap_records_);
+    footprint_ = buffer.capacity() * sizeof(T) + 2 * block_records_ * sizeof(T);
+    T x;
+    for (;;) {
+      buffer.clear();
+      while (buffer.size() < 2 * heap_records_ && reader.next(x)) buffer.push_back(x);
+      if (buffer.empty()) break;
+      std::sort(buffer.begin(), buffer.end(),
+        [this](T const& a, T const& b) { return key_of_(a) < key_of_(b); });
+      Run run{temp_file(), 0};
+      runs_.push_back(run);
+      ExternalSortWriter<T> writer(run.fd, block_records_);
+      for (T const& y : buffer) writer.put(y);
+      writer.flush();
+      runs_.back().count = writer.count();
+    }
+  }
+
+  // Merges runs [i, j) to out_fd and returns the number of records.
+  size_type merge_runs(size_type i, size_type j, int out_fd) {
+    std::vector<Cursor> cursors;
+    cursors.reserve(j - i);
+    for (size_type r = i; r < j; ++r) {
+      cursors.emplace_back(runs_[r].fd, runs_[r].count, block_records_, key_of_);
+    }
+    ExternalSortWriter<T> writer(out_fd, block_records_);
+    KWayMerger<Cursor, Heap> merger(std::make_move_iterator(cursors.begin()),
+                                    std::make_move_iterator(cursors.end()));
+    merger.merge(writer.iterator());
+    writer.flush();
+    return writer.count();
+  }
+
+  ExternalSortOptions options_;
+  KeyOf key_of_;
+  size_type block_records_;
+  size_type heap_records_;
+  size_type fan_in_;
+  std::vector<Run> runs_;
+  size_type run_count_;
+  size_type passes_;
+  size_type footprint_;
+};
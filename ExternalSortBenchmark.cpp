@@ -0,0 +1,138 @@
+/*
+   brew install google-benchmark
+   g++ -g -std=c++17 -msse4 -O2 -DNDEBUG -lbenchmark ExternalSortBenchmark.cpp
+
+   # sorts a file of 16 byte records with 16 bit keys, EXTERNAL_SORT_MB
+   # megabytes (default 1024), with memory limits of 1/16 and 1/4 of that;
+   # the files are written to $TMPDIR (default /tmp), which should be on a
+   # local disk, and the throughput is bytes_per_second of input
+   ./a.out
+*/
+
+#include "ExternalSort.hpp"
+#include "StdMinHeapMap.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+struct Record {
+  std::uint16_t key;
+  char payload[14];
+};
+
+static_assert(sizeof(Record) == 16);
+
+struct KeyOfRecord {
+  std::uint16_t operator()(Record const& r) const { return r.key; }
+};
+
+std::string tmpdir() {
+  char const* dir = std::getenv("TMPDIR");
+  return dir ? dir : "/tmp";
+}
+
+size_t fileBytes() {
+  char const* mb = std::getenv("EXTERNAL_SORT_MB");
+  return size_t(mb ? std::atol(mb) : 1024) << 20;
+}
+
+std::string inputPath() { return tmpdir() + "/ExternalSortBenchmark.in"; }
+std::string textPath() { return tmpdir() + "/ExternalSortBenchmark.txt"; }
+std::string outputPath() { return tmpdir() + "/ExternalSortBenchmark.out"; }
+
+// Writes the binary input and the same records as 16 byte lines of text
+// (a 5 digit key, a space, 9 payload characters and a newline) for GNU sort.
+void initInputs() {
+  size_t n = fileBytes() / sizeof(Record);
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<std::uint16_t> keys(0, 65535);
+  int fd = ::open(inputPath().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  FILE* text = std::fopen(textPath().c_str(), "w");
+  if (fd < 0 || !text) {
+    std::perror("initInputs");
+    std::exit(1);
+  }
+  ExternalSortWriter<Record> writer(fd, (1 << 20) / sizeof(Record));
+  for (size_t i = 0; i < n; ++i) {
+    Record r;
+    r.key = keys(gen);
+    std::snprintf(r.payload, sizeof(r.payload), "%013zu", i % 10000000000000);
+    writer.put(r);
+    std::fprintf(text, "%05u %.9s\n", unsigned(r.key), r.payload + 4);
+  }
+  writer.flush();
+  ::close(fd);
+  std::fclose(text);
+}
+
+template<class Heap>
+void sortFile(benchmark::State& state, bool sort_runs) {
+  ExternalSortOptions options;
+  options.memory_bytes = fileBytes() / state.range(0);
+  options.sort_runs = sort_runs;
+  ExternalSorter<Record, KeyOfRecord, Heap> sorter(options);
+  for (auto _ : state) {
+    int in = ::open(inputPath().c_str(), O_RDONLY);
+    int out = ::open(outputPath().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    benchmark::DoNotOptimize(sorter.sort(in, out));
+    ::fsync(out);
+    ::close(in);
+    ::close(out);
+  }
+  state.counters["runs"] = sorter.runs();
+  state.counters["passes"] = sorter.passes();
+  state.SetBytesProcessed(state.iterations() * fileBytes());
+}
+
+// Replacement selection runs, minpos heap merge.
+void bm_external_sort(benchmark::State& state) {
+  sortFile<Heap8Aux<std::uint32_t>>(state, false);
+}
+
+// std::sort runs of memory size, std::priority_queue merge.
+void bm_std_sort_merge(benchmark::State& state) {
+  sortFile<StdMinHeapMap<std::uint32_t>>(state, true);
+}
+
+void bm_gnu_sort(benchmark::State& state) {
+  if (std::system("command -v sort > /dev/null 2>&1") != 0) {
+    state.SkipWithError("sort not found");
+    return;
+  }
+  size_t memory_kb = (fileBytes() / state.range(0)) >> 10;
+  std::string command = "LC_ALL=C sort -k1,1 -S " + std::to_string(memory_kb) + "K -T " + tmpdir() +
+    " -o " + outputPath() + " " + textPath();
+  for (auto _ : state) {
+    if (std::system(command.c_str()) != 0) {
+      state.SkipWithError("sort failed");
+      return;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * fileBytes());
+}
+
+// The memory limit is the file size divided by the argument.
+BENCHMARK(bm_external_sort)->Arg(16)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(bm_std_sort_merge)->Arg(16)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(bm_gnu_sort)->Arg(16)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+int main(int argc, char** argv) {
+  initInputs();
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  std::remove(inputPath().c_str());
+  std::remove(textPath().c_str());
+  std::remove(outputPath().c_str());
+  return 0;
+}
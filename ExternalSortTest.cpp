@@ -0,0 +1,259 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main ExternalSortTest.cpp
+   ./a.out
+*/
+
+#include "ExternalSort.hpp"
+#include "StdMinHeapMap.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+typedef std::uint16_t Key;
+
+struct Record {
+  Key key;
+  std::uint16_t pad;
+  std::uint32_t id;
+};
+
+struct KeyOfRecord {
+  std::uint16_t operator()(Record const& r) const { return r.key; }
+};
+
+bool operator<(Record const& a, Record const& b) {
+  return a.key < b.key || (a.key == b.key && a.id < b.id);
+}
+
+bool operator==(Record const& a, Record const& b) {
+  return a.key == b.key && a.id == b.id;
+}
+
+// An anonymous temporary file.
+int tempFile() {
+  FILE* f = std::tmpfile();
+  if (!f) throw std::runtime_error("tmpfile");
+  int fd = ::dup(fileno(f));
+  std::fclose(f);
+  return fd;
+}
+
+template<class T>
+int writeFile(std::vector<T> const& v) {
+  int fd = tempFile();
+  ExternalSortWriter<T> writer(fd, 100);
+  for (T const& x : v) writer.put(x);
+  writer.flush();
+  ::lseek(fd, 0, SEEK_SET);
+  return fd;
+}
+
+template<class T>
+std::vector<T> readFile(int fd) {
+  ::lseek(fd, 0, SEEK_SET);
+  std::vector<T> v;
+  ExternalSortReader<T> reader(fd, 100);
+  T x;
+  while (reader.next(x)) v.push_back(x);
+  return v;
+}
+
+std::vector<Record> randomRecords(int seed, size_t n, Key max_key) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<Key> keys(0, max_key);
+  std::vector<Record> v(n);
+  for (size_t i = 0; i < n; ++i) v[i] = {keys(gen), 0, std::uint32_t(i)};
+  return v;
+}
+
+ExternalSortOptions smallOptions(size_t memory_bytes, size_t block_bytes) {
+  ExternalSortOptions options;
+  options.memory_bytes = memory_bytes;
+  options.block_bytes = block_bytes;
+  return options;
+}
+
+template<class T, class KeyOf, class Heap>
+std::vector<T> sortFile(ExternalSorter<T, KeyOf, Heap>& sorter, std::vector<T> const& input) {
+  int in = writeFile(input);
+  int out = tempFile();
+  EXPECT_EQ(input.size(), sorter.sort(in, out));
+  std::vector<T> output = readFile<T>(out);
+  ::close(in);
+  ::close(out);
+  return output;
+}
+
+// Sorted by key, and a permutation of input.
+void expectSorted(std::vector<Record> input, std::vector<Record> output) {
+  EXPECT_TRUE(std::is_sorted(output.begin(), output.end(),
+    [](Record const& a, Record const& b) { return a.key < b.key; }));
+  std::sort(input.begin(), input.end());
+  std::sort(output.begin(), output.end());
+  EXPECT_EQ(input, output);
+}
+
+TEST(ExternalSortTest, Empty) {
+  ExternalSorter<Key> sorter(smallOptions(1 << 12, 1 << 8));
+  EXPECT_TRUE(sortFile(sorter, std::vector<Key>()).empty());
+  EXPECT_EQ(0, sorter.runs());
+}
+
+TEST(ExternalSortTest, Keys) {
+  std::vector<Key> input{5, 3, 9, 0, 65535, 3, 7, 1};
+  ExternalSorter<Key> sorter(smallOptions(1 << 12, 1 << 8));
+  std::vector<Key> expected = input;
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(expected, sortFile(sorter, input));
+  EXPECT_EQ(1, sorter.runs());
+}
+
+TEST(ExternalSortTest, Random) {
+  for (size_t n : {1, 100, 1000, 20000}) {
+    std::vector<Record> input = randomRecords(n, n, 1000);
+    ExternalSorter<Record, KeyOfRecord> sorter(smallOptions(1 << 12, 1 << 8));
+    expectSorted(input, sortFile(sorter, input));
+  }
+}
+
+// Replacement selection makes runs of about twice the heap size from
+// random input.
+TEST(ExternalSortTest, RunLength) {
+  ExternalSorter<Record, KeyOfRecord> sorter(smallOptions(1 << 16, 1 << 10));
+  size_t n = 100 * sorter.heap_records();
+  std::vector<Record> input = randomRecords(1, n, 65535);
+  expectSorted(input, sortFile(sorter, input));
+  double run_length = double(n) / sorter.runs();
+  EXPECT_GT(run_length, 1.8 * sorter.heap_records());
+  EXPECT_LT(run_length, 2.2 * sorter.heap_records());
+}
+
+TEST(ExternalSortTest, SortedInputIsOneRun) {
+  std::vector<Record> input = randomRecords(2, 10000, 65535);
+  std::sort(input.begin(), input.end());
+  ExternalSorter<Record, KeyOfRecord> sorter(smallOptions(1 << 12, 1 << 8));
+  expectSorted(input, sortFile(sorter, input));
+  EXPECT_EQ(1, sorter.runs());
+}
+
+TEST(ExternalSortTest, ReverseSortedInput) {
+  std::vector<Record> input = randomRecords(3, 10000, 65535);
+  std::sort(input.rbegin(), input.rend());
+  ExternalSorter<Record, KeyOfRecord> sorter(smallOptions(1 << 12, 1 << 8));
+  expectSorted(input, sortFile(sorter, input));
+  EXPECT_GT(sorter.runs(), 1);
+}
+
+// More runs than the fan-in needs more than one merge pass.
+TEST(ExternalSortTest, MultiplePasses) {
+  ExternalSorter<Record, KeyOfRecord> sorter(smallOptions(1 << 10, 1 << 8));
+  EXPECT_EQ(3, sorter.fan_in());
+  std::vector<Record> input = randomRecords(4, 5000, 65535);
+  expectSorted(input, sortFile(sorter, input));
+  EXPECT_GT(sorter.runs(), 9);
+  EXPECT_GT(sorter.passes(), 2);
+}
+
+TEST(ExternalSortTest, SortRuns) {
+  ExternalSortOptions options = smallOptions(1 << 12, 1 << 8);
+  options.sort_runs = true;
+  ExternalSorter<Record, KeyOfRecord, StdMinHeapMap<std::uint32_t>> sorter(options);
+  std::vector<Record> input = randomRecords(5, 20000, 65535);
+  expectSorted(input, sortFile(sorter, input));
+  size_t run_records = 2 * sorter.heap_records();
+  EXPECT_EQ((input.size() + run_records - 1) / run_records, sorter.runs());
+}
+
+TEST(ExternalSortTest, TournamentMerge) {
+  ExternalSorter<Record, KeyOfRecord, TournamentTree8> sorter(smallOptions(1 << 12, 1 << 8));
+  std::vector<Record> input = randomRecords(6, 20000, 100);
+  expectSorted(input, sortFile(sorter, input));
+}
+
+TEST(ExternalSortTest, PartialRecord) {
+  int in = tempFile();
+  char bytes[9] = {};
+  ASSERT_EQ(9, ::write(in, bytes, 9));
+  ::lseek(in, 0, SEEK_SET);
+  int out = tempFile();
+  ExternalSorter<Record, KeyOfRecord> sorter(smallOptions(1 << 12, 1 << 8));
+  EXPECT_THROW(sorter.sort(in, out), std::runtime_error);
+  ::close(in);
+  ::close(out);
+}
+
+// Run generation stays within memory_bytes.
+TEST(ExternalSortTest, Footprint) {
+  for (bool sort_runs : {false, true}) {
+    for (size_t memory_bytes : {1 << 12, 1 << 16, 1 << 18}) {
+      ExternalSortOptions options = smallOptions(memory_bytes, 1 << 10);
+      options.sort_runs = sort_runs;
+      ExternalSorter<Record, KeyOfRecord> sorter(options);
+      std::vector<Record> input = randomRecords(7, 4 * sorter.heap_records(), 65535);
+      expectSorted(input, sortFile(sorter, input));
+      EXPECT_LE(sorter.footprint(), memory_bytes) << sort_runs;
+      EXPECT_GT(sorter.footprint(), memory_bytes / 2) << sort_runs;
+    }
+  }
+}
+
+// KeyOfRecord that throws when countdown runs out.
+struct KeyOfRecordOrThrow {
+  static inline long countdown = 0;
+  std::uint16_t operator()(Record const& r) const {
+    if (--countdown == 0) throw std::runtime_error("key");
+    return r.key;
+  }
+};
+
+int openFileCount() {
+  int count = 0;
+  for (int fd = 0; fd < 1024; ++fd) count += ::fcntl(fd, F_GETFD) != -1;
+  return count;
+}
+
+// A sort that throws, in the run generation or in any merge pass, leaves
+// no run files open.
+TEST(ExternalSortTest, ThrowClosesRuns) {
+  std::vector<Record> input = randomRecords(8, 5000, 65535);
+  int in = writeFile(input);
+  int out = tempFile();
+  long const kNever = 1L << 40;
+  KeyOfRecordOrThrow::countdown = kNever;
+  {
+    ExternalSorter<Record, KeyOfRecordOrThrow> sorter(smallOptions(1 << 10, 1 << 8));
+    sorter.sort(in, out);
+    EXPECT_GT(sorter.passes(), 2);
+  }
+  long calls = kNever - KeyOfRecordOrThrow::countdown;
+  int open_files = openFileCount();
+  for (long at = calls / 10; at < calls; at += calls / 10) {
+    ::lseek(in, 0, SEEK_SET);
+    KeyOfRecordOrThrow::countdown = at;
+    {
+      ExternalSorter<Record, KeyOfRecordOrThrow> sorter(smallOptions(1 << 10, 1 << 8));
+      EXPECT_THROW(sorter.sort(in, out), std::runtime_error) << at;
+    }
+    EXPECT_EQ(open_files, openFileCount()) << at;
+  }
+  ::close(in);
+  ::close(out);
+}
+
+TEST(ExternalSortTest, BadFileDescriptor) {
+  ExternalSorter<Key> sorter(smallOptions(1 << 12, 1 << 8));
+  EXPECT_THROW(sorter.sort(-1, -1), std::system_error);
+}
+
+} // namespace
@@ -1,25 +1,58 @@
 #pragma once
 
 #include "h8.h"
+#include "h8_inline.h"
 #include <new>
+#include <stdexcept>
 #include <algorithm>
 #include <functional>
 #include <iterator>
 
-class H8 {
+// Calls to the h8 library.
+struct H8ExternOps {
+  static void pull_up(h8_heap* h, h8_value_type b, size_t q) { h8_heap_pull_up(h, b, q); }
+  static void push_down(h8_heap* h, h8_value_type a, size_t p) { h8_heap_push_down(h, a, p); }
+  static void heapify(h8_heap* h) { h8_heap_heapify(h); }
+  static bool is_heap(h8_heap const* h) { return h8_heap_is_heap(h); }
+  static bool push(h8_heap* h, h8_value_type b) { return h8_heap_push(h, b); }
+  static h8_value_type top(h8_heap const* h) { return h8_heap_top(h); }
+  static h8_value_type pop(h8_heap* h) { return h8_heap_pop(h); }
+  static void sort(h8_heap* h) { h8_heap_sort(h); }
+};
+
+// Inlinable definitions from h8_inline.h.
+struct H8InlineOps {
+  static void pull_up(h8_heap* h, h8_value_type b, size_t q) { h8i_heap_pull_up(h, b, q); }
+  static void push_down(h8_heap* h, h8_value_type a, size_t p) { h8i_heap_push_down(h, a, p); }
+  static void heapify(h8_heap* h) { h8i_heap_heapify(h); }
+  static bool is_heap(h8_heap const* h) { return h8i_heap_is_heap(h); }
+  static bool push(h8_heap* h, h8_value_type b) { return h8i_heap_push(h, b); }
+  static h8_value_type top(h8_heap const* h) { return h8i_heap_top(h); }
+  static h8_value_type pop(h8_heap* h) { return h8i_heap_pop(h); }
+  static void sort(h8_heap* h) { h8i_heap_sort(h); }
+};
+
+template<class Ops> class BasicH8 {
  public:
   typedef h8_value_type value_type;
   typedef ::size_t size_type;
 
-  H8() { h8_heap_init(&h_); }
-  ~H8() { h8_heap_clear(&h_); }
-  H8(const H8&) = delete;
-  H8& operator=(const H8&) = delete;
+  BasicH8() { h8_heap_init(&h_); }
+  // flags are H8_HEAP_* allocation flags, see h8.h.
+  explicit BasicH8(unsigned flags) { h8_heap_init_flags(&h_, flags); }
+  ~BasicH8() { h8_heap_clear(&h_); }
+  BasicH8(const BasicH8&) = delete;
+  BasicH8& operator=(const BasicH8&) = delete;
 
   size_type size() const { return h_.size; }
+  // The number of values the array has room for, see h8_heap in h8.h.
+  size_type capacity() const { return h_.capacity; }
   value_type& operator[](size_type index) {
     return h_.array[index];
   }
+  void reserve(size_type n) {
+    if (!h8_heap_reserve(&h_, n)) throw_bad_alloc();
+  }
   value_type* extend(size_type n) {
     value_type* ptr = h8_heap_extend(&h_, n);
     if (!ptr) throw_bad_alloc();
@@ -30,17 +63,25 @@ class H8 {
     value_type* ptr = h8_heap_extend(&h_, std::distance(begin, end));
     std::copy(begin, end, ptr);
   }
-  void pull_up(value_type b, size_type q) { h8_heap_pull_up(&h_, b, q); }
-  void push_down(value_type a, size_type p) { h8_heap_push_down(&h_, a, p); }
-  void heapify() { h8_heap_heapify(&h_); }
+  // Heapifies the caller's array in place, see h8_heap_adopt in h8.h.
+  void adopt(value_type* array, size_type sz, size_type capacity) {
+    if (!h8_heap_adopt(&h_, array, sz, capacity)) throw std::invalid_argument("h8_heap_adopt");
+  }
+  // Hands the array back, see h8_heap_release in h8.h. Read capacity()
+  // first to munmap the array of a heap constructed with H8_HEAP_MMAP or
+  // H8_HEAP_HUGETLB.
+  value_type* release() { return h8_heap_release(&h_); }
+  void pull_up(value_type b, size_type q) { Ops::pull_up(&h_, b, q); }
+  void push_down(value_type a, size_type p) { Ops::push_down(&h_, a, p); }
+  void heapify() { Ops::heapify(&h_); }
   void push(value_type b) {
-    bool ok = h8_heap_push(&h_, b);
+    bool ok = Ops::push(&h_, b);
     if (!ok) throw_bad_alloc();
   }
-  bool is_heap() const { return h8_heap_is_heap(&h_); }
-  value_type top() const { return h8_heap_top(&h_); }
-  value_type pop() { return h8_heap_pop(&h_); }
-  void sort() { h8_heap_sort(&h_); }
+  bool is_heap() const { return Ops::is_heap(&h_); }
+  value_type top() const { return Ops::top(&h_); }
+  value_type pop() { return Ops::pop(&h_); }
+  void sort() { Ops::sort(&h_); }
   bool is_sorted(size_type sz) const {
     return std::is_sorted(h_.array, h_.array + sz, std::greater<value_type>());
   }
@@ -53,3 +94,8 @@ class H8 {
   }
   h8_heap h_;
 };
+
+typedef BasicH8<H8ExternOps> H8;
+
+// H8 with the hot operations inlined into the caller, see h8_inline.h.
+typedef BasicH8<H8InlineOps> H8Inline;
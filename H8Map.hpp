@@ -0,0 +1,114 @@
+#pragma once
+
+#include "h8map.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Heap map interface over the h8_map C library, for comparison with the
+// C++ heap maps. The payloads are sizeof(S) bytes copied with memcpy.
+template<class S> class H8Map {
+ public:
+  typedef h8_value_type key_type;
+  typedef S mapped_type;
+  typedef std::pair<key_type, S> entry_type;
+  typedef std::size_t size_type;
+
+  static_assert(std::is_trivially_copyable<S>::value);
+
+  H8Map() { h8_map_init(&m_, sizeof(S)); }
+  ~H8Map() { h8_map_clear(&m_); }
+  H8Map(const H8Map&) = delete;
+  H8Map& operator=(const H8Map&) = delete;
+
+  size_type size() const { return h8_map_size(&m_); }
+
+  key_type key(size_type index) const { return h8_map_key(&m_, index); }
+
+  mapped_type mapped(size_type index) const {
+    mapped_type s;
+    std::memcpy(&s, h8_map_payload(&m_, index), sizeof(S));
+    return s;
+  }
+
+  entry_type entry(size_type index) const {
+    return std::make_pair(key(index), mapped(index));
+  }
+
+  void set_entry(size_type index, entry_type a) {
+    h8_map_set_entry(&m_, index, a.first, &a.second);
+  }
+
+  // The new entries have key kMax and value initialized mapped values.
+  void extend(size_type n) {
+    size_type old_size = size();
+    if (!h8_map_extend(&m_, n)) throw_bad_alloc();
+    for (size_type i = old_size; i < size(); ++i) set_entry(i, entry_type(kMax, S()));
+  }
+
+  template<class InputIterator>
+  void append_entries(InputIterator begin, InputIterator end) {
+    while (begin != end) {
+      entry_type a = *begin;
+      if (!h8_map_extend(&m_, 1)) throw_bad_alloc();
+      set_entry(size() - 1, a);
+      ++begin;
+    }
+  }
+
+  void pull_up(key_type b, mapped_type t, size_type q) { h8_map_pull_up(&m_, b, &t, q); }
+
+  void push_down(key_type a, mapped_type s, size_type p) { h8_map_push_down(&m_, a, &s, p); }
+
+  void heapify() { h8_map_heapify(&m_); }
+
+  bool is_heap() const { return h8_map_is_heap(&m_); }
+
+  void push_entry(entry_type e) { push_entry(e.first, e.second); }
+
+  void push_entry(key_type b, mapped_type t) {
+    if (!h8_map_push(&m_, b, &t)) throw_bad_alloc();
+  }
+
+  template<class... Args>
+  void emplace_entry(key_type b, Args&&... args) {
+    push_entry(b, mapped_type(std::forward<Args>(args)...));
+  }
+
+  size_type top_index() const { return h8_map_top_index(&m_); }
+
+  entry_type top_entry() const { return entry(top_index()); }
+
+  entry_type pop_entry() {
+    entry_type e;
+    e.first = h8_map_pop(&m_, &e.second);
+    return e;
+  }
+
+  // Leaves size() zero and the entries readable with entry() and mapped()
+  // in descending order until the next mutation.
+  void sort() { h8_map_sort(&m_); }
+
+  bool is_sorted(size_type sz) const {
+    key_type const* keys = m_.keys.array;
+    return std::is_sorted(keys, keys + sz, std::greater<key_type>());
+  }
+
+  void clear() { h8_map_clear(&m_); }
+
+ private:
+  static constexpr key_type kMax = std::numeric_limits<key_type>::max();
+
+  [[noreturn]] static void throw_bad_alloc() {
+    std::bad_alloc exception;
+    throw exception;
+  }
+
+  h8_map m_;
+};
@@ -157,6 +157,12 @@ class Heap8 {
     return minpos_min(x);
   }
 
+  size_type top_index() const {
+    assert(size_ > 0);
+    minpos_type x = minpos(vectors_[0].mm);
+    return minpos_pos(x);
+  }
+
   value_type pop() {
     assert(size_ > 0);
     minpos_type x = minpos(vectors_[0].mm);
@@ -3,6 +3,9 @@
 #include "minpos.h"
 #include "v128.h"
 #include "align.h"
+#include "Argsort8.hpp"
+#include "SmallVector.hpp"
+#include "PackedVector.hpp"
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -11,9 +14,18 @@
 #include <new>
 #include <utility>
 #include <functional>
+#include <type_traits>
 #include <vector>
 
-template<class S> class Heap8Aux {
+// Mapped values may be move-only or expensive to copy: the sifts move each
+// displaced value once per level. Only extend requires a default
+// constructible S.
+//
+// InlineNodes > 0 stores the first InlineNodes nodes (kArity keys and their
+// mapped values each) inside the object so that small heaps don't allocate.
+//
+// Shadow replaces the container of mapped values, e.g. with PackedVector.
+template<class S, std::size_t InlineNodes = 0, class Shadow = void> class Heap8Aux {
  public:
   typedef std::uint16_t key_type;
   typedef S mapped_type;
@@ -30,6 +42,15 @@ template<class S> class Heap8Aux {
 
   static_assert(sizeof(v128) == kArity * sizeof(key_type));
 
+  template<class T, std::size_t N>
+  using vector_type = typename std::conditional<
+    N == 0, std::vector<T>, SmallVector<T, N>>::type;
+  typedef vector_type<v128, InlineNodes> vectors_type;
+  typedef typename std::conditional<
+    std::is_void<Shadow>::value, vector_type<S, kArity * InlineNodes>, Shadow>::type shadow_type;
+
+  static_assert(std::is_same<typename shadow_type::value_type, S>::value);
+
  public:
   Heap8Aux() : size_(0) { }
   ~Heap8Aux() = default;
@@ -38,42 +59,63 @@ template<class S> class Heap8Aux {
 
   size_type size() const { return size_; }
 
+  // Bytes allocated on the heap by this instance.
+  size_type allocated_bytes() const {
+    return allocated_bytes(vectors_) + allocated_bytes(shadow_);
+  }
+
+  // Total memory used by this instance, including inline storage.
+  size_type footprint() const { return sizeof(*this) + allocated_bytes(); }
+
   key_type key(size_type index) const { return data()[index]; }
 
+  typename shadow_type::const_reference mapped(size_type index) const {
+    return shadow_[index];
+  }
+
   entry_type entry(size_type index) const {
     return std::make_pair(data()[index], shadow_[index]);
   }
 
   void set_entry(size_type index, entry_type a) {
     data()[index] = a.first;
-    shadow_[index] = a.second;
+    shadow_[index] = std::move(a.second);
+  }
+
+  // Allocates room for n entries, so that the heap doesn't reallocate
+  // until it grows beyond n.
+  void reserve(size_type n) {
+    if (n > kSizeMax) throw_bad_alloc();
+    vectors_.reserve(align_up(n, kArity) / kArity);
+    shadow_.reserve(n);
   }
 
   void extend(size_type n) {
     if (n > kSizeMax - size_) throw_bad_alloc();
+    trim_shadow();
     size_type new_size = size_ + n;
     if (new_size > kArity * vectors_.size()) {
-      static_assert(std::numeric_limits<vectors_type::size_type>::max() >=
+      static_assert(std::numeric_limits<typename vectors_type::size_type>::max() >=
                     std::numeric_limits<size_type>::max() / kArity);
       // Smallest new_vectors_size s.t. size <= kArity * new_vectors_size.
       size_type new_vectors_size = align_up(new_size, kArity) / kArity;
       vectors_.resize(new_vectors_size, kV128Max);
-      shadow_.resize(new_size);
     }
+    shadow_.resize(new_size);
     size_ = new_size;
-    key_type* array = data();
   }
 
   template<class InputIterator>
   void append_entries(InputIterator begin, InputIterator end) {
     key_type* array = data();
+    trim_shadow();
     while (begin != end) {
       if (size_ == kArity * vectors_.size()) {
         vectors_.push_back(kV128Max);
         array = data();
       }
-      array[size_] = begin->first;
-      shadow_.push_back(begin->second);
+      array[size_] = (*begin).first;
+      shadow_.push_back((*begin).second); // moves from move iterators
       ++begin;
       ++size_;
     }
@@ -87,11 +129,11 @@ template<class S> class Heap8Aux {
       key_type a = array[p];
       if (a <= b) break;
       array[q] = a;
-      shadow_[q] = shadow_[p];
+      shadow_[q] = std::move(shadow_[p]);
       q = p;
     }
     array[q] = b;
-    shadow_[q] = t;
+    shadow_[q] = std::move(t);
   }
 
   void push_down(key_type a, mapped_type s, size_type p) {
@@ -105,11 +147,11 @@ template<class S> class Heap8Aux {
       if (a <= b) break;
       array[p] = b;
       q += minpos_pos(x);
-      shadow_[p] = shadow_[q];
+      shadow_[p] = std::move(shadow_[q]);
       p = q;
     }
     array[p] = a;
-    shadow_[p] = s;
+    shadow_[p] = std::move(s);
   }
 
   void heapify() {
@@ -128,13 +170,13 @@ template<class S> class Heap8Aux {
       key_type a = array[p];
       if (b < a) {
         size_type q_new = q + minpos_pos(x);
-        mapped_type s = shadow_[p];
-        shadow_[p] = shadow_[q_new];
+        mapped_type s = std::move(shadow_[p]);
+        shadow_[p] = std::move(shadow_[q_new]);
         array[p] = b;
         // The next line inlines push_down(a, s, q_new)
         // with the knowledge that children(q_new) >= size_.
         array[q_new] = a;
-        shadow_[q_new] = s;
+        shadow_[q_new] = std::move(s);
       }
       q -= kArity;
     }
@@ -146,10 +188,10 @@ template<class S> class Heap8Aux {
       key_type a = array[p];
       if (b < a) {
         size_type q_new = q + minpos_pos(x);
-        mapped_type s = shadow_[p];
-        shadow_[p] = shadow_[q_new];
+        mapped_type s = std::move(shadow_[p]);
+        shadow_[p] = std::move(shadow_[q_new]);
         array[p] = b;
-        push_down(a, s, q_new);
+        push_down(a, std::move(s), q_new);
       }
       q -= kArity;
     }
@@ -171,14 +213,21 @@ template<class S> class Heap8Aux {
   }
 
   void push_entry(entry_type e) {
-    push_entry(e.first, e.second);
+    push_entry(e.first, std::move(e.second));
   }
 
   void push_entry(key_type b, mapped_type t) {
+    emplace_entry(b, std::move(t));
+  }
+
+  // Constructs the mapped value from args and pushes it with key b.
+  template<class... Args>
+  void emplace_entry(key_type b, Args&&... args) {
+    trim_shadow();
     if (size_ == kArity * vectors_.size()) vectors_.push_back(kV128Max);
-    size_++;
-    shadow_.push_back(t); // to grow shadow_; pull_up overwrites the value
-    pull_up(b, t, size_ - 1);
+    size_type q = size_++;
+    shadow_.emplace_back(std::forward<Args>(args)...);
+    pull_up(b, std::move(shadow_[q]), q);
   }
 
   size_type top_index() const {
@@ -194,23 +243,21 @@ template<class S> class Heap8Aux {
   }
 
   entry_type pop_entry() {
-    assert(size_ > 0);
-    minpos_type x = minpos(vectors_[0].mm);
-    size_type q = minpos_pos(x);
-    entry_type e(minpos_min(x), shadow_[q]);
-    key_type* array = data();
-    key_type a = array[size_ - 1];
-    array[size_ - 1] = kMax;
-    size_--;
-    if (q != size_) {
-      mapped_type s = shadow_[size_];
-      push_down(a, s, q);
-    }
+    entry_type e = pop_entry_in_place();
     shadow_.pop_back();
     return e;
   }
 
+  // Leaves size() zero and the entries readable with entry() and mapped()
+  // in descending order until the next mutation. Only a heap of one node
+  // with at least kArity / 2 entries is sorted with argsort8 and permute8;
+  // larger heaps are drained with scalar pops, one entry at a time.
   void sort() {
+    if (size_ <= kArity && size_ >= kArity / 2) {
+      sort_node();
+      size_ = 0;
+      return;
+    }
     v128 v = kV128Max;
     size_type x = size_;
     size_type i = x % kArity;
@@ -218,18 +265,18 @@ template<class S> class Heap8Aux {
     if (i != 0) {
       do {
         --i;
-        entry_type e = pop_entry();
+        entry_type e = pop_entry_in_place();
         v.values[i] = e.first;
-        shadow_[x + i] = e.second;
+        shadow_[x + i] = std::move(e.second);
       } while (i > 0);
       vectors_[x / kArity] = v;
     }
     while (x > 0) {
       x -= kArity;
       for (size_type j = kArity; j > 0; --j) {
-        entry_type e = pop_entry();
+        entry_type e = pop_entry_in_place();
         v.values[j - 1] = e.first;
-        shadow_[x + j - 1] = e.second;
+        shadow_[x + j - 1] = std::move(e.second);
       }
       vectors_[x / kArity] = v;
     }
@@ -252,10 +299,62 @@ template<class S> class Heap8Aux {
     std::bad_alloc exception;
     throw exception;
   }
+
+  // sort of the at most kArity entries of the first node in one go:
+  // argsort8 sorts them ascending, stably so the empty kMax lanes stay
+  // after the entries, and the first size_ are reversed into place. Pops
+  // are faster for fewer than kArity / 2 entries.
+  void sort_node() {
+    Sorted8 s = argsort8((vectors_[0]).mm);
+    v128 keys = mm2v128(s.keys), lanes = mm2v128(s.lanes);
+    v128 v = kV128Max, descending = lanes;
+    for (size_type j = 0; j < size_; ++j) {
+      v.values[j] = keys.values[size_ - 1 - j];
+      descending.values[j] = lanes.values[size_ - 1 - j];
+    }
+    vectors_[0] = v;
+    permute8<S>(shadow_, descending.mm, size_);
+  }
+
+  // Destroys the values sort left behind beyond size_ and resets their
+  // keys to kMax, so that the heap can grow again.
+  void trim_shadow() {
+    if (shadow_.size() == size_) return;
+    std::fill(data() + size_, data() + shadow_.size(), kMax);
+    while (shadow_.size() > size_) shadow_.pop_back();
+  }
+
+  // Pops like pop_entry but leaves the vacated slot shadow_[size_]
+  // (moved from) in place for sort to fill.
+  entry_type pop_entry_in_place() {
+    assert(size_ > 0);
+    minpos_type x = minpos(vectors_[0].mm);
+    size_type q = minpos_pos(x);
+    entry_type e(minpos_min(x), std::move(shadow_[q]));
+    key_type* array = data();
+    key_type a = array[size_ - 1];
+    array[size_ - 1] = kMax;
+    size_--;
+    if (q != size_) push_down(a, std::move(shadow_[size_]), q);
+    return e;
+  }
+  template<class T>
+  static size_type allocated_bytes(std::vector<T> const& v) {
+    return v.capacity() * sizeof(T);
+  }
+  template<class V>
+  static size_type allocated_bytes(V const& v) {
+    return v.allocated_bytes();
+  }
   key_type* data() { return reinterpret_cast<key_type*>(vectors_.data()); }
   key_type const* data() const { return reinterpret_cast<key_type const*>(vectors_.data()); }
-  typedef std::vector<v128> vectors_type;
   vectors_type vectors_;
-  std::vector<S> shadow_;
+  shadow_type shadow_;
   size_type size_;
 };
+
+// Heap8Aux with the first node inline, for many heaps of at most 8 entries.
+template<class S> using Heap8AuxSmall = Heap8Aux<S, 1>;
+
+// Heap8Aux with N bit mapped values bit-packed N bytes per node.
+template<unsigned N> using Heap8AuxPacked = Heap8Aux<UInt<N>, 0, PackedVector<N>>;
@@ -3,6 +3,7 @@
 #include "minpos.h"
 #include "v128.h"
 #include "align.h"
+#include "Argsort8.hpp"
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -13,7 +14,26 @@
 #include <utility>
 #include <vector>
 
-template<class S> class Heap8Embed {
+// Node layout policy for Heap8Embed. Nodes are stored in blocks of
+// NodesPerBlock nodes: their key vectors followed by their mapped values.
+// NodesPerBlock 1 interleaves keys and mapped values node by node and
+// NodesPerBlock 4 puts the keys of 4 nodes in one 64 byte cache line.
+// PayloadAlign > 0 aligns the mapped values of each node to PayloadAlign
+// bytes, e.g. 16 or 64, and pads them to a multiple of it.
+template<std::size_t NodesPerBlock = 1, std::size_t PayloadAlign = 0>
+struct Heap8EmbedLayout {
+  static_assert(NodesPerBlock > 0 && (NodesPerBlock & (NodesPerBlock - 1)) == 0,
+                "NodesPerBlock must be a power of 2");
+  static_assert((PayloadAlign & (PayloadAlign - 1)) == 0,
+                "PayloadAlign must be 0 or a power of 2");
+  static constexpr std::size_t kNodesPerBlock = NodesPerBlock;
+  static constexpr std::size_t kPayloadAlign = PayloadAlign;
+};
+
+// Mapped values may be move-only or expensive to copy: the sifts move each
+// displaced value once per level. Requires a default constructible S, which
+// also fills the padding slots of the last node.
+template<class S, class Layout = Heap8EmbedLayout<>> class Heap8Embed {
  public:
   typedef std::uint16_t key_type;
   typedef S mapped_type;
@@ -30,18 +50,30 @@ template<class S> class Heap8Embed {
 
   static_assert(sizeof(v128) == kArity * sizeof(key_type));
 
-  struct node {
-    typedef std::array<mapped_type, kArity> shadow_vector;
-    node() = default;
-    node(v128 vals) : values(vals), shadows{0,0,0,0,0,0,0,0} { }
-    v128 values;
-    shadow_vector shadows;
-    minpos_type minpos() const { return ::minpos(values.mm); }
+  static constexpr size_type kNodesPerBlock = Layout::kNodesPerBlock;
+  static constexpr size_type kPayloadAlign =
+    std::max(Layout::kPayloadAlign, alignof(mapped_type));
+
+  struct alignas(kPayloadAlign) shadow_vector {
+    std::array<mapped_type, kArity> shadows;
   };
-  static_assert(sizeof(node) == kArity * sizeof(entry_type));
+
+  struct block {
+    v128 values[kNodesPerBlock];
+    shadow_vector shadows[kNodesPerBlock];
+  };
+
+  // View of the keys and mapped values of a node in a block.
+  template<class V, class M> struct basic_node {
+    V* values;
+    M* shadows;
+    minpos_type minpos() const { return ::minpos(values->mm); }
+  };
+  typedef basic_node<v128, mapped_type> node;
+  typedef basic_node<v128 const, mapped_type const> const_node;
 
  public:
-  Heap8Embed() : size_(0) { }
+  Heap8Embed() : nodes_(0), size_(0) { }
   ~Heap8Embed() = default;
   Heap8Embed(const Heap8Embed&) = delete;
   Heap8Embed& operator=(const Heap8Embed&) = delete;
@@ -49,33 +81,38 @@ template<class S> class Heap8Embed {
   size_type size() const { return size_; }
 
   key_type key(size_type index) const {
-    return nod(index)->values.values[index % kArity];
+    return nod(index).values->values[index % kArity];
+  }
+
+  mapped_type const& mapped(size_type index) const {
+    return nod(index).shadows[index % kArity];
   }
 
   entry_type entry(size_type index) const {
-    node const* n = nod(index);
+    const_node n = nod(index);
     size_type i = index % kArity;
-    return std::make_pair(n->values.values[i], n->shadows[i]);
+    return std::make_pair(n.values->values[i], n.shadows[i]);
   }
 
   void set_entry(size_type index, entry_type a) {
-    node* n = nod(index);
+    node n = nod(index);
     size_type i = index % kArity;
-    n->values.values[i] = a.first;
-    n->shadows[i] = a.second;
+    n.values->values[i] = a.first;
+    n.shadows[i] = std::move(a.second);
   }
 
   void extend(size_type n) {
     if (n > kSizeMax - size_) throw_bad_alloc();
     size_type new_size = size_ + n;
-    if (new_size > kArity * nodes_.size()) {
-      static_assert(std::numeric_limits<typename nodes_type::size_type>::max() >=
+    if (new_size > kArity * nodes_) {
+      static_assert(std::numeric_limits<typename blocks_type::size_type>::max() >=
                     std::numeric_limits<size_type>::max() / kArity);
       // Smallest new_nodes_size s.t. size <= kArity * new_nodes_size.
       size_type new_nodes_size = align_up(new_size, kArity) / kArity;
-      nodes_.resize(new_nodes_size);
+      blocks_.resize(align_up(new_nodes_size, kNodesPerBlock) / kNodesPerBlock);
+      nodes_ = new_nodes_size;
       // Pad values in case new_size < kArity * new_nodes_size
-      nodes_.back().values = kV128Max;
+      *nod(new_size - 1).values = kV128Max;
     }
     size_ = new_size;
   }
@@ -83,11 +120,11 @@ template<class S> class Heap8Embed {
   template<class InputIterator>
   void append_entries(InputIterator begin, InputIterator end) {
     while (begin != end) {
-      if (size_ == kArity * nodes_.size()) nodes_.emplace_back(kV128Max);
-      node* n = nod(size_);
+      if (size_ == kArity * nodes_) append_node();
+      node n = nod(size_);
       size_type i = size_ % kArity;
-      n->values.values[i] = begin->first;
-      n->shadows[i] = begin->second;
+      n.values->values[i] = (*begin).first;
+      n.shadows[i] = (*begin).second; // moves from move iterators
       ++begin;
       ++size_;
     }
@@ -95,44 +132,44 @@ template<class S> class Heap8Embed {
 
   void pull_up(key_type b, mapped_type t, size_type q) {
     assert(q < size_);
-    node* n = nod(q);
+    node n = nod(q);
     size_type j = q % kArity;
     while (q >= kArity) {
       size_type p = parent(q);
-      node* m = nod(p);
+      node m = nod(p);
       size_type i = p % kArity;
-      key_type a = m->values.values[i];
+      key_type a = m.values->values[i];
       if (a <= b) break;
-      n->values.values[j] = a;
-      n->shadows[j] = m->shadows[i];
+      n.values->values[j] = a;
+      n.shadows[j] = std::move(m.shadows[i]);
       q = p;
       n = m;
       j = i;
     }
-    n->values.values[j] = b;
-    n->shadows[j] = t;
+    n.values->values[j] = b;
+    n.shadows[j] = std::move(t);
   }
 
   void push_down(key_type a, mapped_type s, size_type p) {
     assert(p < size_);
-    node* m = nod(p);
+    node m = nod(p);
     size_type i = p % kArity;
     while (true) {
       size_type q = children(p);
       if (q >= size_) break;
-      node* n = nod(q);
-      minpos_type x = n->minpos();
+      node n = nod(q);
+      minpos_type x = n.minpos();
       key_type b = minpos_min(x);
       if (a <= b) break;
       size_type j = minpos_pos(x);
-      m->values.values[i] = b;
-      m->shadows[i] = n->shadows[j];
+      m.values->values[i] = b;
+      m.shadows[i] = std::move(n.shadows[j]);
       p = q + j;
       m = n;
       i = j;
     }
-    m->values.values[i] = a;
-    m->shadows[i] = s;
+    m.values->values[i] = a;
+    m.shadows[i] = std::move(s);
   }
 
   void heapify() {
@@ -144,40 +181,40 @@ template<class S> class Heap8Embed {
     // Here "bottom level" means the 8-vectors without children.
     size_type r = parent(q);
     while (q > r) {
-      node* n = nod(q);
-      minpos_type x = n->minpos();
+      node n = nod(q);
+      minpos_type x = n.minpos();
       key_type b = minpos_min(x);
       size_type p = parent(q);
-      node* m = nod(p);
+      node m = nod(p);
       size_type i = p % kArity;
-      key_type a = m->values.values[i];
+      key_type a = m.values->values[i];
       if (b < a) {
         size_type j = minpos_pos(x);
-        mapped_type s = m->shadows[i];
-        m->shadows[i] = n->shadows[j];
-        m->values.values[i] = b;
+        mapped_type s = std::move(m.shadows[i]);
+        m.shadows[i] = std::move(n.shadows[j]);
+        m.values->values[i] = b;
         // The next line inlines push_down(a, s, q + j)
         // with the knowledge that children(q + j) >= size_.
-        n->values.values[j] = a;
-        n->shadows[j] = s;
+        n.values->values[j] = a;
+        n.shadows[j] = std::move(s);
       }
       q -= kArity;
     }
 
     while (q > 0) {
-      node* n = nod(q);
-      minpos_type x = n->minpos();
+      node n = nod(q);
+      minpos_type x = n.minpos();
       key_type b = minpos_min(x);
       size_type p = parent(q);
-      node* m = nod(p);
+      node m = nod(p);
       size_type i = p % kArity;
-      key_type a = m->values.values[i];
+      key_type a = m.values->values[i];
       if (b < a) {
         size_type j = minpos_pos(x);
-        mapped_type s = m->shadows[i];
-        m->shadows[i] = n->shadows[j];
-        m->values.values[i] = b;
-        push_down(a, s, q + j);
+        mapped_type s = std::move(m.shadows[i]);
+        m.shadows[i] = std::move(n.shadows[j]);
+        m.values->values[i] = b;
+        push_down(a, std::move(s), q + j);
       }
       q -= kArity;
     }
@@ -187,7 +224,7 @@ template<class S> class Heap8Embed {
     if (size_ <= kArity) return true;
     size_type q = align_down(size_ - 1, kArity);
     while (q > 0) {
-      minpos_type x = nod(q)->minpos();
+      minpos_type x = nod(q).minpos();
       key_type b = minpos_min(x);
       size_type p = parent(q);
       key_type a = key(p);
@@ -198,73 +235,89 @@ template<class S> class Heap8Embed {
   }
 
   void push_entry(entry_type e) {
-    push_entry(e.first, e.second);
+    push_entry(e.first, std::move(e.second));
   }
 
   void push_entry(key_type b, mapped_type t) {
-    if (size_ == kArity * nodes_.size()) nodes_.emplace_back(kV128Max);
+    if (size_ == kArity * nodes_) append_node();
+    size_++;
+    pull_up(b, std::move(t), size_ - 1);
+  }
+
+  // Constructs the mapped value from args and pushes it with key b.
+  template<class... Args>
+  void emplace_entry(key_type b, Args&&... args) {
+    if (size_ == kArity * nodes_) append_node();
     size_++;
-    pull_up(b, t, size_ - 1);
+    pull_up(b, mapped_type(std::forward<Args>(args)...), size_ - 1);
   }
 
   size_type top_index() const {
     assert(size_ > 0);
-    node const* n = nod(0);
-    minpos_type x = n->minpos();
+    const_node n = nod(0);
+    minpos_type x = n.minpos();
     return minpos_pos(x);
   }
 
   entry_type top_entry() const {
     assert(size_ > 0);
-    node const* n = nod(0);
-    minpos_type x = n->minpos();
-    return std::make_pair(minpos_min(x), n->shadows[minpos_pos(x)]);
+    const_node n = nod(0);
+    minpos_type x = n.minpos();
+    return std::make_pair(minpos_min(x), n.shadows[minpos_pos(x)]);
   }
 
   entry_type pop_entry() {
     assert(size_ > 0);
-    node* n = nod(0);
-    minpos_type x = n->minpos();
+    node n = nod(0);
+    minpos_type x = n.minpos();
     size_type q = minpos_pos(x);
-    entry_type e(minpos_min(x), n->shadows[q]);
+    entry_type e(minpos_min(x), std::move(n.shadows[q]));
     size_type p = size_ - 1;
-    node* m = nod(p);
+    node m = nod(p);
     size_type i = p % kArity;
-    key_type a = m->values.values[i];
-    m->values.values[i] = kMax;
+    key_type a = m.values->values[i];
+    m.values->values[i] = kMax;
     size_--;
-    if (q != size_) {
-      mapped_type s = m->shadows[i];
-      push_down(a, s, q);
-    }
+    if (q != size_) push_down(a, std::move(m.shadows[i]), q);
     return e;
   }
 
+  // Like Heap8Aux::sort: only a heap of one node with at least kArity / 2
+  // entries is sorted with argsort8 and permute8, larger heaps are drained
+  // with pops. The sorted nodes are released, so that the next append_node
+  // resets their keys to kMax.
   void sort() {
+    if (size_ <= kArity && size_ >= kArity / 2) {
+      sort_node();
+      size_ = 0;
+      nodes_ = 0;
+      return;
+    }
     v128 values = kV128Max;
     size_type x = size_;
     size_type i = x % kArity;
     x -= i;
     if (i != 0) {
-      node* n = nod(x);
+      node n = nod(x);
       do {
         --i;
         entry_type e = pop_entry();
         values.values[i] = e.first;
-        n->shadows[i] = e.second;
+        n.shadows[i] = std::move(e.second);
       } while (i > 0);
-      n->values = values;
+      *n.values = values;
     }
     while (x > 0) {
       x -= kArity;
-      node* n = nod(x);
+      node n = nod(x);
       for (size_type j = kArity; j > 0; --j) {
         entry_type e = pop_entry();
         values.values[j - 1] = e.first;
-        n->shadows[j - 1] = e.second;
+        n.shadows[j - 1] = std::move(e.second);
       }
-      n->values = values;
+      *n.values = values;
     }
+    nodes_ = 0;
   }
 
   bool is_sorted(size_type sz) const {
@@ -279,8 +332,9 @@ template<class S> class Heap8Embed {
   }
 
   void clear() {
-    nodes_.clear();
-    nodes_.shrink_to_fit(); // to match heap_clear(heap*)
+    blocks_.clear();
+    blocks_.shrink_to_fit(); // to match heap_clear(heap*)
+    nodes_ = 0;
     size_ = 0;
   }
 
@@ -290,11 +344,49 @@ template<class S> class Heap8Embed {
     throw exception;
   }
 
-  typedef std::vector<node> nodes_type;
+  // sort of the at most kArity entries of the first node in one go:
+  // argsort8 sorts them ascending, stably so the empty kMax lanes stay
+  // after the entries, and the first size_ are reversed into place. Pops
+  // are faster for fewer than kArity / 2 entries.
+  void sort_node() {
+    node n = nod(0);
+    Sorted8 s = argsort8(n.values->mm);
+    v128 keys = mm2v128(s.keys), lanes = mm2v128(s.lanes);
+    v128 v = kV128Max, descending = lanes;
+    for (size_type j = 0; j < size_; ++j) {
+      v.values[j] = keys.values[size_ - 1 - j];
+      descending.values[j] = lanes.values[size_ - 1 - j];
+    }
+    *n.values = v;
+    permute8<S>(n.shadows, descending.mm, size_);
+  }
 
-  node* nod(size_type q) { return &nodes_[q / kArity]; }
-  node const* nod(size_type q) const { return &nodes_[q / kArity]; }
+  typedef std::vector<block> blocks_type;
 
-  nodes_type nodes_;
+  node nod(size_type q) {
+    size_type k = q / kArity;
+    block& b = blocks_[k / kNodesPerBlock];
+    size_type j = k % kNodesPerBlock;
+    return node{&b.values[j], b.shadows[j].shadows.data()};
+  }
+  const_node nod(size_type q) const {
+    size_type k = q / kArity;
+    block const& b = blocks_[k / kNodesPerBlock];
+    size_type j = k % kNodesPerBlock;
+    return const_node{&b.values[j], b.shadows[j].shadows.data()};
+  }
+
+  // Appends a node with kMax keys, and a block if the blocks are full.
+  void append_node() {
+    if (nodes_ == kNodesPerBlock * blocks_.size()) blocks_.emplace_back();
+    ++nodes_;
+    *nod(kArity * nodes_ - 1).values = kV128Max;
+  }
+
+  blocks_type blocks_;
+  size_type nodes_; // nodes in use, the blocks may have room for more
   size_type size_;
 };
+
+// Heap8Embed with the keys of 4 nodes per cache line.
+template<class S> using Heap8EmbedBlock = Heap8Embed<S, Heap8EmbedLayout<4>>;
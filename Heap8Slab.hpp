@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Heap8Aux.hpp"
+#include "SlabArena.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+// Heap map for large mapped values. The underlying Heap, Heap8Aux or
+// Heap8Embed of std::uint32_t, maps keys to handles into a SlabArena and
+// the sifts move only the handles, while the mapped values stay in the arena.
+template<class S, class Heap = Heap8Aux<std::uint32_t>> class Heap8Slab {
+ public:
+  typedef std::uint16_t key_type;
+  typedef S mapped_type;
+  typedef std::pair<key_type, S> entry_type;
+  typedef std::size_t size_type;
+
+ private:
+  typedef SlabArena<S> arena_type;
+  typedef typename arena_type::handle_type handle_type;
+  typedef Heap heap_type;
+  typedef typename heap_type::entry_type handle_entry_type;
+
+  static constexpr key_type kMax = std::numeric_limits<key_type>::max();
+
+  static_assert(std::is_same<typename heap_type::mapped_type, handle_type>::value);
+
+ public:
+  Heap8Slab() : sorted_(0) { }
+  ~Heap8Slab() = default;
+  Heap8Slab(const Heap8Slab&) = delete;
+  Heap8Slab& operator=(const Heap8Slab&) = delete;
+
+  size_type size() const { return heap_.size(); }
+
+  key_type key(size_type index) const { return heap_.key(index); }
+
+  mapped_type const& mapped(size_type index) const {
+    return arena_[heap_.mapped(index)];
+  }
+
+  entry_type entry(size_type index) const {
+    return std::make_pair(heap_.key(index), mapped(index));
+  }
+
+  void set_entry(size_type index, entry_type a) {
+    handle_type h = heap_.mapped(index);
+    arena_[h] = std::move(a.second);
+    heap_.set_entry(index, handle_entry_type(a.first, h));
+  }
+
+  // The new entries have key kMax and default constructed mapped values.
+  void extend(size_type n) {
+    release_sorted();
+    size_type old_size = heap_.size();
+    heap_.extend(n);
+    for (size_type i = old_size; i < heap_.size(); ++i) {
+      heap_.set_entry(i, handle_entry_type(kMax, arena_.emplace()));
+    }
+  }
+
+  template<class InputIterator>
+  void append_entries(InputIterator begin, InputIterator end) {
+    release_sorted();
+    while (begin != end) {
+      auto&& e = *begin;
+      handle_entry_type a(e.first, arena_.emplace(std::forward<decltype(e)>(e).second));
+      heap_.append_entries(&a, &a + 1);
+      ++begin;
+    }
+  }
+
+  // The handle at q is reused for t: the entry at q is overwritten anyway.
+  void pull_up(key_type b, mapped_type t, size_type q) {
+    handle_type h = heap_.mapped(q);
+    arena_[h] = std::move(t);
+    heap_.pull_up(b, h, q);
+  }
+
+  void push_down(key_type a, mapped_type s, size_type p) {
+    handle_type h = heap_.mapped(p);
+    arena_[h] = std::move(s);
+    heap_.push_down(a, h, p);
+  }
+
+  void heapify() { heap_.heapify(); }
+
+  bool is_heap() const { return heap_.is_heap(); }
+
+  void push_entry(entry_type e) {
+    push_entry(e.first, std::move(e.second));
+  }
+
+  void push_entry(key_type b, mapped_type t) {
+    emplace_entry(b, std::move(t));
+  }
+
+  // Constructs the mapped value from args in the arena and pushes it with key b.
+  template<class... Args>
+  void emplace_entry(key_type b, Args&&... args) {
+    release_sorted();
+    heap_.push_entry(b, arena_.emplace(std::forward<Args>(args)...));
+  }
+
+  size_type top_index() const { return heap_.top_index(); }
+
+  entry_type top_entry() const { return entry(top_index()); }
+
+  entry_type pop_entry() {
+    handle_entry_type a = heap_.pop_entry();
+    entry_type e(a.first, std::move(arena_[a.second]));
+    arena_.erase(a.second);
+    return e;
+  }
+
+  // Leaves size() zero and the entries readable with entry() and mapped()
+  // in descending order until the next mutation, which erases their mapped
+  // values from the arena. heap_ drops their keys then too.
+  void sort() {
+    sorted_ = heap_.size();
+    heap_.sort();
+  }
+
+  bool is_sorted(size_type sz) const { return heap_.is_sorted(sz); }
+
+  void clear() {
+    heap_.clear();
+    arena_.clear();
+    sorted_ = 0;
+  }
+
+ private:
+  // Erases the mapped values that sort left behind.
+  void release_sorted() {
+    for (size_type i = 0; i < sorted_; ++i) arena_.erase(heap_.mapped(i));
+    sorted_ = 0;
+  }
+
+  heap_type heap_;
+  arena_type arena_;
+  size_type sorted_; // entries left behind by sort
+};
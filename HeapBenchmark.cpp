@@ -3,13 +3,19 @@
    gcc -g -std=c11 -msse4 -O2 -DNDEBUG -c h8.c &&
    g++ -g -std=c++17 -msse4 -O2 -DNDEBUG -lfollybenchmark -lgflags h8.o HeapBenchmark.cpp -o HeapBenchmark.out
 
+   # h8 rows with link time optimization across h8.c and HeapBenchmark.cpp
+   gcc -g -std=c11 -msse4 -O2 -DNDEBUG -flto -c h8.c -o h8.lto.o &&
+   g++ -g -std=c++17 -msse4 -O2 -DNDEBUG -flto -lfollybenchmark -lgflags h8.lto.o HeapBenchmark.cpp -o HeapBenchmarkLTO.out
+
    ./HeapBenchmark.out                                         # all
    ./HeapBenchmark.out --bm_regex push                         # only push
+   ./HeapBenchmark.out --bm_regex pushpop                      # 10M to 1B values, needs 4 GB
    ./HeapBenchmark.out --bm_regex std | awk '{print$1,$3,$4}'  # std w/o relative column
 */
 
 #include "H8.hpp"
 #include "Heap8.hpp"
+#include "SequenceHeap.hpp"
 #include "StdMinHeap.hpp"
 #include <cstddef>
 #include <cstdint>
@@ -119,6 +125,21 @@ void heapsort(uint32_t n, size_t sz, bool ascending) {
   }
 }
 
+// Pushes sz values and pops them all.
+template<class Heap>
+void pushpop(uint32_t n, size_t sz, bool ascending) {
+  Heap h;
+  for (int i = 0; i < n; ++i) {
+    push(h, sz, ascending);
+    while (h.size() > 0) doNotOptimizeAway(h.pop());
+  }
+}
+
+// H8 with the array in huge pages, see H8_HEAP_HUGETLB in h8.h.
+struct H8Huge : public H8 {
+  H8Huge() : H8(H8_HEAP_HUGETLB) { }
+};
+
 typedef uint16_t ValueType;
 
 // vector with added append() method
@@ -142,13 +163,23 @@ void sort(uint32_t n, size_t sz, bool ascending) {
 
 void push_h8_sorted(uint32_t n, size_t sz) { push<H8>(n, sz, true); }
 void push_h8_unsorted(uint32_t n, size_t sz) { push<H8>(n, sz, false); }
+void push_h8huge_sorted(uint32_t n, size_t sz) { push<H8Huge>(n, sz, true); }
+void push_h8inline_sorted(uint32_t n, size_t sz) { push<H8Inline>(n, sz, true); }
+void push_h8huge_unsorted(uint32_t n, size_t sz) { push<H8Huge>(n, sz, false); }
+void push_h8inline_unsorted(uint32_t n, size_t sz) { push<H8Inline>(n, sz, false); }
 void push_heap8_sorted(uint32_t n, size_t sz) { push<Heap8>(n, sz, true); }
 void push_heap8_unsorted(uint32_t n, size_t sz) { push<Heap8>(n, sz, false); }
+void push_seqheap_sorted(uint32_t n, size_t sz) { push<SequenceHeap>(n, sz, true); }
+void push_seqheap_unsorted(uint32_t n, size_t sz) { push<SequenceHeap>(n, sz, false); }
 void push_std_sorted(uint32_t n, size_t sz) { push<StdMinHeap<>>(n, sz, true); }
 void push_std_unsorted(uint32_t n, size_t sz) { push<StdMinHeap<>>(n, sz, false); }
 
 void heapify_h8_sorted(uint32_t n, size_t sz) { heapify<H8>(n, sz, true); }
 void heapify_h8_unsorted(uint32_t n, size_t sz) { heapify<H8>(n, sz, false); }
+void heapify_h8huge_sorted(uint32_t n, size_t sz) { heapify<H8Huge>(n, sz, true); }
+void heapify_h8inline_sorted(uint32_t n, size_t sz) { heapify<H8Inline>(n, sz, true); }
+void heapify_h8huge_unsorted(uint32_t n, size_t sz) { heapify<H8Huge>(n, sz, false); }
+void heapify_h8inline_unsorted(uint32_t n, size_t sz) { heapify<H8Inline>(n, sz, false); }
 void heapify_heap8_sorted(uint32_t n, size_t sz) { heapify<Heap8>(n, sz, true); }
 void heapify_heap8_unsorted(uint32_t n, size_t sz) { heapify<Heap8>(n, sz, false); }
 void heapify_std_sorted(uint32_t n, size_t sz) { heapify<StdMinHeap<>>(n, sz, true); }
@@ -156,78 +187,134 @@ void heapify_std_unsorted(uint32_t n, size_t sz) { heapify<StdMinHeap<>>(n, sz,
 
 void heapsort_h8_sorted(uint32_t n, size_t sz) { heapsort<H8>(n, sz, true); }
 void heapsort_h8_unsorted(uint32_t n, size_t sz) { heapsort<H8>(n, sz, false); }
+void heapsort_h8huge_sorted(uint32_t n, size_t sz) { heapsort<H8Huge>(n, sz, true); }
+void heapsort_h8inline_sorted(uint32_t n, size_t sz) { heapsort<H8Inline>(n, sz, true); }
+void heapsort_h8huge_unsorted(uint32_t n, size_t sz) { heapsort<H8Huge>(n, sz, false); }
+void heapsort_h8inline_unsorted(uint32_t n, size_t sz) { heapsort<H8Inline>(n, sz, false); }
 void heapsort_heap8_sorted(uint32_t n, size_t sz) { heapsort<Heap8>(n, sz, true); }
 void heapsort_heap8_unsorted(uint32_t n, size_t sz) { heapsort<Heap8>(n, sz, false); }
 void heapsort_std_sorted(uint32_t n, size_t sz) { heapsort<StdMinHeap<>>(n, sz, true); }
 void heapsort_std_unsorted(uint32_t n, size_t sz) { heapsort<StdMinHeap<>>(n, sz, false); }
 
+void pushpop_heap8_unsorted(uint32_t n, size_t sz) { pushpop<Heap8>(n, sz, false); }
+void pushpop_seqheap_unsorted(uint32_t n, size_t sz) { pushpop<SequenceHeap>(n, sz, false); }
+
 void sort_sorted(uint32_t n, size_t sz) { sort(n, sz, true); }
 void sort_unsorted(uint32_t n, size_t sz) { sort(n, sz, false); }
 
 } // namespace
 
 BENCHMARK_PARAM(push_h8_sorted, 1000)
+BENCHMARK_RELATIVE_PARAM(push_h8huge_sorted, 1000)
+BENCHMARK_RELATIVE_PARAM(push_h8inline_sorted, 1000)
 BENCHMARK_RELATIVE_PARAM(push_heap8_sorted, 1000)
+BENCHMARK_RELATIVE_PARAM(push_seqheap_sorted, 1000)
 BENCHMARK_RELATIVE_PARAM(push_std_sorted, 1000)
 BENCHMARK_PARAM(push_h8_sorted, 100000)
+BENCHMARK_RELATIVE_PARAM(push_h8huge_sorted, 100000)
+BENCHMARK_RELATIVE_PARAM(push_h8inline_sorted, 100000)
 BENCHMARK_RELATIVE_PARAM(push_heap8_sorted, 100000)
+BENCHMARK_RELATIVE_PARAM(push_seqheap_sorted, 100000)
 BENCHMARK_RELATIVE_PARAM(push_std_sorted, 100000)
 BENCHMARK_PARAM(push_h8_sorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(push_h8huge_sorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(push_h8inline_sorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(push_heap8_sorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(push_seqheap_sorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(push_std_sorted, 10000000)
 BENCHMARK_PARAM(push_h8_unsorted, 1000)
+BENCHMARK_RELATIVE_PARAM(push_h8huge_unsorted, 1000)
+BENCHMARK_RELATIVE_PARAM(push_h8inline_unsorted, 1000)
 BENCHMARK_RELATIVE_PARAM(push_heap8_unsorted, 1000)
+BENCHMARK_RELATIVE_PARAM(push_seqheap_unsorted, 1000)
 BENCHMARK_RELATIVE_PARAM(push_std_unsorted, 1000)
 BENCHMARK_PARAM(push_h8_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(push_h8huge_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(push_h8inline_unsorted, 100000)
 BENCHMARK_RELATIVE_PARAM(push_heap8_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(push_seqheap_unsorted, 100000)
 BENCHMARK_RELATIVE_PARAM(push_std_unsorted, 100000)
 BENCHMARK_PARAM(push_h8_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(push_h8huge_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(push_h8inline_unsorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(push_heap8_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(push_seqheap_unsorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(push_std_unsorted, 10000000)
 BENCHMARK_DRAW_LINE();
 BENCHMARK_PARAM(heapify_h8_sorted, 1000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8huge_sorted, 1000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8inline_sorted, 1000)
 BENCHMARK_RELATIVE_PARAM(heapify_heap8_sorted, 1000)
 BENCHMARK_RELATIVE_PARAM(heapify_std_sorted, 1000)
 BENCHMARK_PARAM(heapify_h8_sorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8huge_sorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8inline_sorted, 100000)
 BENCHMARK_RELATIVE_PARAM(heapify_heap8_sorted, 100000)
 BENCHMARK_RELATIVE_PARAM(heapify_std_sorted, 100000)
 BENCHMARK_PARAM(heapify_h8_sorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8huge_sorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8inline_sorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(heapify_heap8_sorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(heapify_std_sorted, 10000000)
 BENCHMARK_PARAM(heapify_h8_unsorted, 1000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8huge_unsorted, 1000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8inline_unsorted, 1000)
 BENCHMARK_RELATIVE_PARAM(heapify_heap8_unsorted, 1000)
 BENCHMARK_RELATIVE_PARAM(heapify_std_unsorted, 1000)
 BENCHMARK_PARAM(heapify_h8_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8huge_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8inline_unsorted, 100000)
 BENCHMARK_RELATIVE_PARAM(heapify_heap8_unsorted, 100000)
 BENCHMARK_RELATIVE_PARAM(heapify_std_unsorted, 100000)
 BENCHMARK_PARAM(heapify_h8_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8huge_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8inline_unsorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(heapify_heap8_unsorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(heapify_std_unsorted, 10000000)
 BENCHMARK_DRAW_LINE();
 BENCHMARK_PARAM(heapsort_h8_sorted, 1000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8huge_sorted, 1000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8inline_sorted, 1000)
 BENCHMARK_RELATIVE_PARAM(heapsort_heap8_sorted, 1000)
 BENCHMARK_RELATIVE_PARAM(heapsort_std_sorted, 1000)
 BENCHMARK_RELATIVE_PARAM(sort_sorted, 1000)
 BENCHMARK_PARAM(heapsort_h8_sorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8huge_sorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8inline_sorted, 100000)
 BENCHMARK_RELATIVE_PARAM(heapsort_heap8_sorted, 100000)
 BENCHMARK_RELATIVE_PARAM(heapsort_std_sorted, 100000)
 BENCHMARK_RELATIVE_PARAM(sort_sorted, 100000)
 BENCHMARK_PARAM(heapsort_h8_sorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8huge_sorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8inline_sorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(heapsort_heap8_sorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(heapsort_std_sorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(sort_sorted, 10000000)
 BENCHMARK_PARAM(heapsort_h8_unsorted, 1000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8huge_unsorted, 1000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8inline_unsorted, 1000)
 BENCHMARK_RELATIVE_PARAM(heapsort_heap8_unsorted, 1000)
 BENCHMARK_RELATIVE_PARAM(heapsort_std_unsorted, 1000)
 BENCHMARK_RELATIVE_PARAM(sort_unsorted, 1000)
 BENCHMARK_PARAM(heapsort_h8_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8huge_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8inline_unsorted, 100000)
 BENCHMARK_RELATIVE_PARAM(heapsort_heap8_unsorted, 100000)
 BENCHMARK_RELATIVE_PARAM(heapsort_std_unsorted, 100000)
 BENCHMARK_RELATIVE_PARAM(sort_unsorted, 100000)
 BENCHMARK_PARAM(heapsort_h8_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8huge_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8inline_unsorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(heapsort_heap8_unsorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(heapsort_std_unsorted, 10000000)
 BENCHMARK_RELATIVE_PARAM(sort_unsorted, 10000000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(pushpop_heap8_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(pushpop_seqheap_unsorted, 10000000)
+BENCHMARK_PARAM(pushpop_heap8_unsorted, 100000000)
+BENCHMARK_RELATIVE_PARAM(pushpop_seqheap_unsorted, 100000000)
+BENCHMARK_PARAM(pushpop_heap8_unsorted, 1000000000)
+BENCHMARK_RELATIVE_PARAM(pushpop_seqheap_unsorted, 1000000000)
 
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
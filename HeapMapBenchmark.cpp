@@ -1,13 +1,20 @@
+#include "H8Map.hpp"
 #include "Heap8Aux.hpp"
 #include "Heap8Embed.hpp"
+#include "Heap8Slab.hpp"
 #include "StdMinHeapMap.hpp"
 #include "U48.hpp"
 #include "FirstCompare.hpp"
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <random>
+#include <string>
 #include <utility>
+#include <vector>
 #include <boost/iterator/counting_iterator.hpp>
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/numeric/conversion/cast.hpp>
@@ -123,6 +130,35 @@ void heapsort(uint32_t n, size_t sz, bool ascending) {
   }
 }
 
+// Pushes sz random keys with mapped values from make(key) and pops them all.
+// For mapped values that are move-only or expensive to copy.
+template<class Heap, class Make>
+void pushpop(uint32_t n, size_t sz, Make make) {
+  Heap h;
+  std::vector<uint16_t> keys;
+  BENCHMARK_SUSPEND {
+    for (size_t i = 0; i < sz; ++i) keys.push_back(Random<uint16_t>::distr(gen));
+  }
+  for (int i = 0; i < n; ++i) {
+    for (uint16_t k : keys) h.emplace_entry(k, make(k));
+    while (h.size() > 0) doNotOptimizeAway(h.pop_entry().first);
+  }
+}
+
+std::string makeString(uint16_t k) { return std::string(32, 'a' + k % 26); }
+std::unique_ptr<uint64_t> makeUnique(uint16_t k) { return std::make_unique<uint64_t>(k); }
+
+// N byte mapped value.
+template<std::size_t N>
+struct Payload {
+  std::array<uint64_t, N / 8> words;
+  Payload() = default;
+  explicit Payload(uint16_t k) { words.fill(k); }
+};
+
+template<std::size_t N>
+Payload<N> makePayload(uint16_t k) { return Payload<N>(k); }
+
 typedef uint16_t KeyType;
 typedef U48 MappedType;
 
@@ -151,10 +187,87 @@ void sort(uint32_t n, size_t sz, bool ascending) {
 }
 
 typedef Heap8Aux<MappedType> Aux;
+typedef Heap8AuxSmall<MappedType> AuxSmall;
 typedef Heap8Embed<MappedType> Embed;
 typedef StdMinHeapMap<MappedType> Std;
 
+// Mapped value widths: 64 bits unpacked against 48 and 40 bits packed.
+typedef Heap8Aux<uint64_t> Aux64;
+typedef Heap8AuxPacked<48> Packed48;
+typedef Heap8AuxPacked<40> Packed40;
+
+// The h8_map C library against Heap8Aux with the same mapped type.
+typedef H8Map<uint64_t> CMap64;
+
+void push_h8map64_unsorted(uint32_t n, size_t sz) { push<CMap64>(n, sz, false); }
+void heapify_h8map64_unsorted(uint32_t n, size_t sz) { heapify<CMap64>(n, sz, false); }
+void heapsort_h8map64_unsorted(uint32_t n, size_t sz) { heapsort<CMap64>(n, sz, false); }
+
+void push_heap8aux64_unsorted(uint32_t n, size_t sz) { push<Aux64>(n, sz, false); }
+void push_heap8auxpacked48_unsorted(uint32_t n, size_t sz) { push<Packed48>(n, sz, false); }
+void push_heap8auxpacked40_unsorted(uint32_t n, size_t sz) { push<Packed40>(n, sz, false); }
+void heapify_heap8aux64_unsorted(uint32_t n, size_t sz) { heapify<Aux64>(n, sz, false); }
+void heapify_heap8auxpacked48_unsorted(uint32_t n, size_t sz) { heapify<Packed48>(n, sz, false); }
+void heapify_heap8auxpacked40_unsorted(uint32_t n, size_t sz) { heapify<Packed40>(n, sz, false); }
+void heapsort_heap8aux64_unsorted(uint32_t n, size_t sz) { heapsort<Aux64>(n, sz, false); }
+void heapsort_heap8auxpacked48_unsorted(uint32_t n, size_t sz) { heapsort<Packed48>(n, sz, false); }
+void heapsort_heap8auxpacked40_unsorted(uint32_t n, size_t sz) { heapsort<Packed40>(n, sz, false); }
+
+typedef std::unique_ptr<uint64_t> Unique;
+
+void pushpop_heap8aux_string(uint32_t n, size_t sz) { pushpop<Heap8Aux<std::string>>(n, sz, makeString); }
+void pushpop_heap8embed_string(uint32_t n, size_t sz) { pushpop<Heap8Embed<std::string>>(n, sz, makeString); }
+void pushpop_stdheapmap_string(uint32_t n, size_t sz) { pushpop<StdMinHeapMap<std::string>>(n, sz, makeString); }
+void pushpop_heap8aux_unique(uint32_t n, size_t sz) { pushpop<Heap8Aux<Unique>>(n, sz, makeUnique); }
+void pushpop_heap8embed_unique(uint32_t n, size_t sz) { pushpop<Heap8Embed<Unique>>(n, sz, makeUnique); }
+void pushpop_stdheapmap_unique(uint32_t n, size_t sz) { pushpop<StdMinHeapMap<Unique>>(n, sz, makeUnique); }
+
+template<std::size_t N>
+void pushpop_payload_heap8aux(uint32_t n, size_t sz) {
+  pushpop<Heap8Aux<Payload<N>>>(n, sz, makePayload<N>);
+}
+template<std::size_t N>
+void pushpop_payload_heap8embed(uint32_t n, size_t sz) {
+  pushpop<Heap8Embed<Payload<N>>>(n, sz, makePayload<N>);
+}
+template<std::size_t N>
+void pushpop_payload_heap8slab(uint32_t n, size_t sz) {
+  pushpop<Heap8Slab<Payload<N>>>(n, sz, makePayload<N>);
+}
+template<std::size_t N>
+void pushpop_payload_heap8slabembed(uint32_t n, size_t sz) {
+  pushpop<Heap8Slab<Payload<N>, Heap8Embed<uint32_t>>>(n, sz, makePayload<N>);
+}
+template<std::size_t N>
+void pushpop_payload_stdheapmap(uint32_t n, size_t sz) {
+  pushpop<StdMinHeapMap<Payload<N>>>(n, sz, makePayload<N>);
+}
+
+template<std::size_t N>
+void pushpop_payload_h8map(uint32_t n, size_t sz) {
+  pushpop<H8Map<Payload<N>>>(n, sz, makePayload<N>);
+}
+
+void pushpop_heap8aux_payload32(uint32_t n, size_t sz) { pushpop_payload_heap8aux<32>(n, sz); }
+void pushpop_heap8embed_payload32(uint32_t n, size_t sz) { pushpop_payload_heap8embed<32>(n, sz); }
+void pushpop_heap8slab_payload32(uint32_t n, size_t sz) { pushpop_payload_heap8slab<32>(n, sz); }
+void pushpop_heap8slabembed_payload32(uint32_t n, size_t sz) { pushpop_payload_heap8slabembed<32>(n, sz); }
+void pushpop_stdheapmap_payload32(uint32_t n, size_t sz) { pushpop_payload_stdheapmap<32>(n, sz); }
+void pushpop_heap8aux_payload64(uint32_t n, size_t sz) { pushpop_payload_heap8aux<64>(n, sz); }
+void pushpop_heap8embed_payload64(uint32_t n, size_t sz) { pushpop_payload_heap8embed<64>(n, sz); }
+void pushpop_heap8slab_payload64(uint32_t n, size_t sz) { pushpop_payload_heap8slab<64>(n, sz); }
+void pushpop_heap8slabembed_payload64(uint32_t n, size_t sz) { pushpop_payload_heap8slabembed<64>(n, sz); }
+void pushpop_stdheapmap_payload64(uint32_t n, size_t sz) { pushpop_payload_stdheapmap<64>(n, sz); }
+void pushpop_heap8aux_payload256(uint32_t n, size_t sz) { pushpop_payload_heap8aux<256>(n, sz); }
+void pushpop_heap8embed_payload256(uint32_t n, size_t sz) { pushpop_payload_heap8embed<256>(n, sz); }
+void pushpop_heap8slab_payload256(uint32_t n, size_t sz) { pushpop_payload_heap8slab<256>(n, sz); }
+void pushpop_heap8slabembed_payload256(uint32_t n, size_t sz) { pushpop_payload_heap8slabembed<256>(n, sz); }
+void pushpop_stdheapmap_payload256(uint32_t n, size_t sz) { pushpop_payload_stdheapmap<256>(n, sz); }
+void pushpop_h8map_payload32(uint32_t n, size_t sz) { pushpop_payload_h8map<32>(n, sz); }
+void pushpop_h8map_payload256(uint32_t n, size_t sz) { pushpop_payload_h8map<256>(n, sz); }
+
 void push_heap8aux_sorted(uint32_t n, size_t sz) { push<Aux>(n, sz, true); }
+void push_heap8auxsmall_sorted(uint32_t n, size_t sz) { push<AuxSmall>(n, sz, true); }
 void push_heap8embed_sorted(uint32_t n, size_t sz) { push<Embed>(n, sz, true); }
 void push_stdheapmap_sorted(uint32_t n, size_t sz) { push<Std>(n, sz, true); }
 void push_heap8aux_unsorted(uint32_t n, size_t sz) { push<Aux>(n, sz, true); }
@@ -175,6 +288,10 @@ void heapsort_stdheapmap_unsorted(uint32_t n, size_t sz) { heapsort<Std>(n, sz,
 
 } // namespace
 
+BENCHMARK_PARAM(push_heap8aux_sorted, 8)
+BENCHMARK_PARAM(push_heap8auxsmall_sorted, 8)
+BENCHMARK_PARAM(push_heap8embed_sorted, 8)
+BENCHMARK_PARAM(push_stdheapmap_sorted, 8)
 BENCHMARK_PARAM(push_heap8aux_sorted, 1000)
 BENCHMARK_PARAM(push_heap8embed_sorted, 1000)
 BENCHMARK_PARAM(push_stdheapmap_sorted, 1000)
@@ -231,6 +348,86 @@ BENCHMARK_PARAM(heapsort_stdheapmap_unsorted, 100000)
 BENCHMARK_PARAM(heapsort_heap8aux_unsorted, 10000000)
 BENCHMARK_PARAM(heapsort_heap8embed_unsorted, 10000000)
 BENCHMARK_PARAM(heapsort_stdheapmap_unsorted, 10000000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(pushpop_heap8aux_string, 1000)
+BENCHMARK_PARAM(pushpop_heap8embed_string, 1000)
+BENCHMARK_PARAM(pushpop_stdheapmap_string, 1000)
+BENCHMARK_PARAM(pushpop_heap8aux_string, 100000)
+BENCHMARK_PARAM(pushpop_heap8embed_string, 100000)
+BENCHMARK_PARAM(pushpop_stdheapmap_string, 100000)
+BENCHMARK_PARAM(pushpop_heap8aux_unique, 1000)
+BENCHMARK_PARAM(pushpop_heap8embed_unique, 1000)
+BENCHMARK_PARAM(pushpop_stdheapmap_unique, 1000)
+BENCHMARK_PARAM(pushpop_heap8aux_unique, 100000)
+BENCHMARK_PARAM(pushpop_heap8embed_unique, 100000)
+BENCHMARK_PARAM(pushpop_stdheapmap_unique, 100000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(pushpop_heap8aux_payload32, 1000)
+BENCHMARK_PARAM(pushpop_heap8embed_payload32, 1000)
+BENCHMARK_PARAM(pushpop_heap8slab_payload32, 1000)
+BENCHMARK_PARAM(pushpop_heap8slabembed_payload32, 1000)
+BENCHMARK_PARAM(pushpop_stdheapmap_payload32, 1000)
+BENCHMARK_PARAM(pushpop_heap8aux_payload32, 100000)
+BENCHMARK_PARAM(pushpop_heap8embed_payload32, 100000)
+BENCHMARK_PARAM(pushpop_heap8slab_payload32, 100000)
+BENCHMARK_PARAM(pushpop_heap8slabembed_payload32, 100000)
+BENCHMARK_PARAM(pushpop_stdheapmap_payload32, 100000)
+BENCHMARK_PARAM(pushpop_heap8aux_payload64, 1000)
+BENCHMARK_PARAM(pushpop_heap8embed_payload64, 1000)
+BENCHMARK_PARAM(pushpop_heap8slab_payload64, 1000)
+BENCHMARK_PARAM(pushpop_heap8slabembed_payload64, 1000)
+BENCHMARK_PARAM(pushpop_stdheapmap_payload64, 1000)
+BENCHMARK_PARAM(pushpop_heap8aux_payload64, 100000)
+BENCHMARK_PARAM(pushpop_heap8embed_payload64, 100000)
+BENCHMARK_PARAM(pushpop_heap8slab_payload64, 100000)
+BENCHMARK_PARAM(pushpop_heap8slabembed_payload64, 100000)
+BENCHMARK_PARAM(pushpop_stdheapmap_payload64, 100000)
+BENCHMARK_PARAM(pushpop_heap8aux_payload256, 1000)
+BENCHMARK_PARAM(pushpop_heap8embed_payload256, 1000)
+BENCHMARK_PARAM(pushpop_heap8slab_payload256, 1000)
+BENCHMARK_PARAM(pushpop_heap8slabembed_payload256, 1000)
+BENCHMARK_PARAM(pushpop_stdheapmap_payload256, 1000)
+BENCHMARK_PARAM(pushpop_heap8aux_payload256, 100000)
+BENCHMARK_PARAM(pushpop_heap8embed_payload256, 100000)
+BENCHMARK_PARAM(pushpop_heap8slab_payload256, 100000)
+BENCHMARK_PARAM(pushpop_heap8slabembed_payload256, 100000)
+BENCHMARK_PARAM(pushpop_stdheapmap_payload256, 100000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(push_heap8aux64_unsorted, 100000)
+BENCHMARK_PARAM(push_heap8auxpacked48_unsorted, 100000)
+BENCHMARK_PARAM(push_heap8auxpacked40_unsorted, 100000)
+BENCHMARK_PARAM(push_heap8aux64_unsorted, 10000000)
+BENCHMARK_PARAM(push_heap8auxpacked48_unsorted, 10000000)
+BENCHMARK_PARAM(push_heap8auxpacked40_unsorted, 10000000)
+BENCHMARK_PARAM(heapify_heap8aux64_unsorted, 100000)
+BENCHMARK_PARAM(heapify_heap8auxpacked48_unsorted, 100000)
+BENCHMARK_PARAM(heapify_heap8auxpacked40_unsorted, 100000)
+BENCHMARK_PARAM(heapify_heap8aux64_unsorted, 10000000)
+BENCHMARK_PARAM(heapify_heap8auxpacked48_unsorted, 10000000)
+BENCHMARK_PARAM(heapify_heap8auxpacked40_unsorted, 10000000)
+BENCHMARK_PARAM(heapsort_heap8aux64_unsorted, 100000)
+BENCHMARK_PARAM(heapsort_heap8auxpacked48_unsorted, 100000)
+BENCHMARK_PARAM(heapsort_heap8auxpacked40_unsorted, 100000)
+BENCHMARK_PARAM(heapsort_heap8aux64_unsorted, 10000000)
+BENCHMARK_PARAM(heapsort_heap8auxpacked48_unsorted, 10000000)
+BENCHMARK_PARAM(heapsort_heap8auxpacked40_unsorted, 10000000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(push_heap8aux64_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(push_h8map64_unsorted, 100000)
+BENCHMARK_PARAM(push_heap8aux64_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(push_h8map64_unsorted, 10000000)
+BENCHMARK_PARAM(heapify_heap8aux64_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8map64_unsorted, 100000)
+BENCHMARK_PARAM(heapify_heap8aux64_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapify_h8map64_unsorted, 10000000)
+BENCHMARK_PARAM(heapsort_heap8aux64_unsorted, 100000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8map64_unsorted, 100000)
+BENCHMARK_PARAM(heapsort_heap8aux64_unsorted, 10000000)
+BENCHMARK_RELATIVE_PARAM(heapsort_h8map64_unsorted, 10000000)
+BENCHMARK_PARAM(pushpop_heap8aux_payload32, 100000)
+BENCHMARK_RELATIVE_PARAM(pushpop_h8map_payload32, 100000)
+BENCHMARK_PARAM(pushpop_heap8aux_payload256, 100000)
+BENCHMARK_RELATIVE_PARAM(pushpop_h8map_payload256, 100000)
 
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
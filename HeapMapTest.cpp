@@ -1,14 +1,21 @@
 /*
    # first install gtest as described in h8Test.cpp
    brew install boost
-   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main HeapMapTest.cpp
+   gcc -g -std=c11 -msse4 -c h8.c h8map.c &&
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main h8.o h8map.o HeapMapTest.cpp
    ./a.out
 */
 
+#include "H8Map.hpp"
 #include "Heap8Aux.hpp"
 #include "Heap8Embed.hpp"
+#include "Heap8Slab.hpp"
 #include "StdMinHeapMap.hpp"
 #include "U48.hpp"
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 #include <boost/iterator/counting_iterator.hpp>
 #include <boost/iterator/transform_iterator.hpp>
@@ -27,8 +34,16 @@ class HeapMapTest : public testing::Test {
 
 typedef testing::Types<
   Heap8Aux<U48>,
+  Heap8AuxSmall<U48>,
+  Heap8AuxPacked<48>,
+  Heap8AuxPacked<61>,
   Heap8Embed<U48>,
-  StdMinHeapMap<U48>
+  Heap8EmbedBlock<U48>,
+  Heap8Embed<U48, Heap8EmbedLayout<2, 16>>,
+  Heap8Slab<U48>,
+  Heap8Slab<U48, Heap8Embed<uint32_t>>,
+  StdMinHeapMap<U48>,
+  H8Map<U48>
 > Implementations;
 
 TYPED_TEST_SUITE(HeapMapTest, Implementations);
@@ -86,6 +101,32 @@ TYPED_TEST(HeapMapTest, Sort3) {
   EXPECT_TRUE(this->heap_.is_sorted(entries.size()));
 }
 
+// Heaps of up to one node, with duplicate keys and keys equal to the kMax
+// of empty lanes.
+TYPED_TEST(HeapMapTest, SortSmall) {
+  typedef typename TypeParam::key_type key_type;
+  typedef typename TypeParam::entry_type entry_type;
+  key_type const max = std::numeric_limits<key_type>::max();
+  for (size_t n = 0; n <= 9; ++n) {
+    std::vector<entry_type> entries;
+    for (size_t i = 0; i < n; ++i) {
+      entries.emplace_back(i % 3 == 2 ? max : key_type(i * 5 % 4), 40 + i);
+    }
+    TypeParam heap;
+    heap.append_entries(entries.begin(), entries.end());
+    heap.heapify();
+    heap.sort();
+    EXPECT_EQ(0, heap.size());
+    EXPECT_TRUE(heap.is_sorted(n)) << n;
+    std::vector<entry_type> sorted;
+    for (size_t i = 0; i < n; ++i) sorted.push_back(heap.entry(i));
+    // Equal keys may come in any order.
+    std::sort(entries.begin(), entries.end());
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ(entries, sorted) << n;
+  }
+}
+
 TYPED_TEST(HeapMapTest, Heapify100) {
   typedef typename TypeParam::key_type key_type;
   typedef typename TypeParam::entry_type entry_type;
@@ -108,4 +149,214 @@ TYPED_TEST(HeapMapTest, Heapify100) {
   }
 }
 
+// Move-only mapped type that counts live instances to check that the heaps
+// destroy every value they construct.
+struct Tracked {
+  static int live;
+  std::unique_ptr<int> ptr;
+  Tracked() { ++live; }
+  explicit Tracked(int i) : ptr(new int(i)) { ++live; }
+  Tracked(Tracked&& t) : ptr(std::move(t.ptr)) { ++live; }
+  Tracked& operator=(Tracked&& t) = default;
+  ~Tracked() { --live; }
+};
+
+int Tracked::live = 0;
+
+template <class T>
+class HeapMapMoveTest : public testing::Test {
+ protected:
+  void TearDown() override { EXPECT_EQ(0, Tracked::live); }
+};
+
+template<class Tracking, class String>
+struct MoveTypes {
+  typedef Tracking tracked;
+  typedef String string;
+};
+
+typedef testing::Types<
+  MoveTypes<Heap8Aux<Tracked>, Heap8Aux<std::string>>,
+  MoveTypes<Heap8AuxSmall<Tracked>, Heap8AuxSmall<std::string>>,
+  MoveTypes<Heap8Embed<Tracked>, Heap8Embed<std::string>>,
+  MoveTypes<Heap8EmbedBlock<Tracked>, Heap8EmbedBlock<std::string>>,
+  MoveTypes<Heap8Slab<Tracked>, Heap8Slab<std::string>>,
+  MoveTypes<StdMinHeapMap<Tracked>, StdMinHeapMap<std::string>>
+> MoveImplementations;
+
+TYPED_TEST_SUITE(HeapMapMoveTest, MoveImplementations);
+
+TYPED_TEST(HeapMapMoveTest, PushPop) {
+  typename TypeParam::tracked heap;
+  uint16_t const count = 100;
+  for (uint16_t i = count; i > 0; --i) heap.push_entry(i - 1, Tracked(i - 1));
+  EXPECT_TRUE(heap.is_heap());
+  EXPECT_EQ(0, *heap.mapped(heap.top_index()).ptr);
+  for (uint16_t i = 0; i < count; ++i) {
+    auto e = heap.pop_entry();
+    EXPECT_EQ(i, e.first);
+    ASSERT_TRUE(e.second.ptr);
+    EXPECT_EQ(i, *e.second.ptr);
+  }
+  heap.clear();
+}
+
+TYPED_TEST(HeapMapMoveTest, AppendHeapify) {
+  typedef typename TypeParam::tracked heap_type;
+  typedef typename heap_type::entry_type entry_type;
+  uint16_t const count = 100;
+  {
+    std::vector<entry_type> entries;
+    for (uint16_t i = count; i > 0; --i) entries.emplace_back(i - 1, Tracked(i - 1));
+    heap_type heap;
+    heap.append_entries(std::make_move_iterator(entries.begin()),
+                        std::make_move_iterator(entries.end()));
+    heap.heapify();
+    EXPECT_TRUE(heap.is_heap());
+    for (uint16_t i = 0; i < count / 2; ++i) {
+      auto e = heap.pop_entry();
+      EXPECT_EQ(i, e.first);
+      EXPECT_EQ(i, *e.second.ptr);
+    }
+    // heap is destroyed with the remaining entries
+  }
+}
+
+TYPED_TEST(HeapMapMoveTest, EmplaceStrings) {
+  typename TypeParam::string heap;
+  uint16_t const count = 100;
+  // Long enough to defeat the small string optimization.
+  for (uint16_t i = count; i > 0; --i) heap.emplace_entry(i - 1, 40, 'a' + (i - 1) % 26);
+  for (uint16_t i = 0; i < count; ++i) {
+    auto e = heap.pop_entry();
+    EXPECT_EQ(i, e.first);
+    EXPECT_EQ(std::string(40, 'a' + i % 26), e.second);
+  }
+}
+
+template<class Heap>
+void sortStrings() {
+  Heap heap;
+  uint16_t const count = 100;
+  for (uint16_t i = 0; i < count; ++i) heap.push_entry(i, std::string(40, 'a' + i % 26));
+  heap.sort();
+  EXPECT_TRUE(heap.is_sorted(count));
+  for (uint16_t i = 0; i < count; ++i) {
+    uint16_t k = count - 1 - i;
+    EXPECT_EQ(k, heap.key(i));
+    EXPECT_EQ(std::string(40, 'a' + k % 26), heap.mapped(i));
+  }
+  // The sorted keys are gone: a key above all of them is the top.
+  heap.push_entry(200, "x");
+  EXPECT_EQ(1, heap.size());
+  EXPECT_TRUE(heap.is_heap());
+  EXPECT_EQ(std::make_pair(uint16_t(200), std::string("x")), heap.top_entry());
+  heap.push_entry(7, "seven");
+  EXPECT_EQ("seven", heap.pop_entry().second);
+  EXPECT_EQ("x", heap.pop_entry().second);
+}
+
+TEST(Heap8AuxTest, SortStrings) {
+  sortStrings<Heap8Aux<std::string>>();
+  sortStrings<Heap8AuxSmall<std::string>>();
+}
+
+TEST(Heap8EmbedTest, SortStrings) {
+  sortStrings<Heap8Embed<std::string>>();
+  sortStrings<Heap8EmbedBlock<std::string>>();
+  sortStrings<Heap8Embed<std::string, Heap8EmbedLayout<1, 64>>>();
+}
+
+TEST(Heap8EmbedTest, Extend) {
+  Heap8EmbedBlock<U48> heap;
+  heap.extend(20);
+  for (uint16_t i = 0; i < 20; ++i) heap.set_entry(i, std::make_pair(20 - i, i));
+  heap.heapify();
+  heap.extend(50);
+  for (uint16_t i = 20; i < 70; ++i) heap.set_entry(i, std::make_pair(i + 1, i));
+  heap.heapify();
+  EXPECT_TRUE(heap.is_heap());
+  for (uint16_t i = 1; i <= 70; ++i) EXPECT_EQ(i, heap.pop_entry().first);
+}
+
+TEST(Heap8SlabTest, SortStrings) {
+  sortStrings<Heap8Slab<std::string>>();
+  sortStrings<Heap8Slab<std::string, Heap8Embed<uint32_t>>>();
+}
+
+// sort() erases the sorted mapped values from the arena on the next
+// mutation, so none of their keys may survive in the heap.
+template<class Heap>
+void pushAfterSort() {
+  Heap heap;
+  for (uint16_t i = 0; i < 100; ++i) heap.push_entry(i, std::to_string(i));
+  heap.sort();
+  for (uint16_t i = 0; i < 20; ++i) heap.push_entry(200 + i, std::to_string(200 + i));
+  EXPECT_EQ(20, heap.size());
+  EXPECT_TRUE(heap.is_heap());
+  EXPECT_EQ(std::make_pair(uint16_t(200), std::string("200")), heap.top_entry());
+  for (uint16_t i = 0; i < 20; ++i) EXPECT_EQ(std::to_string(200 + i), heap.pop_entry().second);
+}
+
+TEST(Heap8SlabTest, PushAfterSort) {
+  pushAfterSort<Heap8Slab<std::string>>();
+  pushAfterSort<Heap8Slab<std::string, Heap8Embed<uint32_t>>>();
+}
+
+TEST(Heap8SlabTest, PullUpPushDown) {
+  Heap8Slab<std::string> heap;
+  for (uint16_t i = 0; i < 20; ++i) heap.push_entry(10 * i, std::to_string(10 * i));
+  // Replace the top and the last entry in place.
+  heap.push_down(55, "55", heap.top_index());
+  heap.pull_up(5, "5", heap.size() - 1);
+  EXPECT_TRUE(heap.is_heap());
+  EXPECT_EQ("5", heap.pop_entry().second);
+  EXPECT_EQ("10", heap.pop_entry().second);
+  heap.extend(1);
+  heap.pull_up(1, "1", heap.size() - 1);
+  EXPECT_EQ(std::make_pair(uint16_t(1), std::string("1")), heap.pop_entry());
+  EXPECT_EQ("20", heap.pop_entry().second);
+}
+
+TEST(Heap8AuxSmallTest, Footprint) {
+  Heap8AuxSmall<U48> small;
+  Heap8Aux<U48> large;
+  for (uint16_t i = 0; i < 8; ++i) {
+    small.push_entry(i, i);
+    large.push_entry(i, i);
+  }
+  EXPECT_EQ(0, small.allocated_bytes());
+  EXPECT_EQ(sizeof(small), small.footprint());
+  EXPECT_LT(0, large.allocated_bytes());
+  EXPECT_EQ(sizeof(large) + large.allocated_bytes(), large.footprint());
+  small.push_entry(8, 8);
+  EXPECT_LT(0, small.allocated_bytes());
+  EXPECT_EQ(0, small.pop_entry().first);
+  small.clear();
+  EXPECT_EQ(0, small.allocated_bytes());
+}
+
+TEST(Heap8AuxPackedTest, Footprint) {
+  Heap8AuxPacked<40> packed;
+  Heap8Aux<uint64_t> unpacked;
+  uint64_t const big = uint64_t(1) << 39;
+  for (uint16_t i = 0; i < 1000; ++i) {
+    packed.push_entry(1000 - i, big + i);
+    unpacked.push_entry(1000 - i, big + i);
+  }
+  packed.clear();
+  unpacked.clear();
+  for (uint16_t i = 0; i < 1000; ++i) {
+    packed.push_entry(1000 - i, big + i);
+    unpacked.push_entry(1000 - i, big + i);
+  }
+  // 2 + 5 bytes per entry instead of 2 + 8, give or take slack capacity
+  EXPECT_LT(packed.allocated_bytes() * 10, unpacked.allocated_bytes() * 8);
+  for (uint16_t i = 1000; i > 0; --i) {
+    auto e = packed.pop_entry();
+    EXPECT_EQ(1001 - i, e.first);
+    EXPECT_EQ(big + i - 1, e.second);
+  }
+}
+
 } // namespace
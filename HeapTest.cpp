@@ -12,6 +12,7 @@
 #include "StdMinHeapMap.hpp"
 #include "U48.hpp"
 #include <vector>
+#include <sys/mman.h> // munmap
 #include <boost/iterator/counting_iterator.hpp>
 #include <boost/iterator/transform_iterator.hpp>
 #include <gtest/gtest.h>
@@ -27,6 +28,11 @@ class HeapTest : public testing::Test {
   T heap_;
 };
 
+// H8 with the array in an mmap'ed memory block.
+struct H8Mmap : public H8 {
+  H8Mmap() : H8(H8_HEAP_MMAP) { }
+};
+
 template<class HeapMap>
 class HeapFrom : public HeapMap {
  public:
@@ -47,9 +53,12 @@ class HeapFrom : public HeapMap {
 
 typedef testing::Types<
   H8,
+  H8Mmap,
+  H8Inline,
   Heap8,
   StdMinHeap<>,
   HeapFrom<Heap8Aux<int>>,
+  HeapFrom<Heap8AuxSmall<int>>,
   HeapFrom<Heap8Embed<U48>>,
   HeapFrom<StdMinHeapMap<int>>
 > Implementations;
@@ -123,4 +132,18 @@ TYPED_TEST(HeapTest, Heapify100) {
   }
 }
 
+TEST(H8Test, ReleaseMmap) {
+  H8Mmap heap;
+  EXPECT_EQ(0, heap.capacity());
+  heap.reserve(100);
+  EXPECT_LE(100, heap.capacity());
+  heap.push(42);
+  H8::size_type capacity = heap.capacity();
+  H8::value_type* array = heap.release();
+  EXPECT_EQ(0, heap.size());
+  EXPECT_EQ(0, heap.capacity());
+  EXPECT_EQ(42, array[0]);
+  EXPECT_EQ(0, munmap(array, capacity * sizeof(H8::value_type)));
+}
+
 } // namespace
@@ -0,0 +1,319 @@
+#pragma once
+
+#include "Heap8Aux.hpp"
+#include "Heap8Embed.hpp"
+#include "TournamentTree8.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// K-way merge of sorted inputs with a heap map from the head key of each
+// input to its index.
+//
+// The inputs are cursors with:
+//
+//   typedef ... value_type;
+//   bool empty() const;
+//   key_type key() const;        // key of the head, precondition !empty()
+//   ... value() const;           // the head, e.g. a key with a payload
+//   void next();                 // advances past the head
+//   void prefetch() const;       // hint that the next heads will be read
+//
+// IteratorCursor below is a cursor over an iterator range, e.g. a vector
+// or an std::istream_iterator stream. Empty inputs are allowed.
+//
+// Heap is the heap map from keys to std::uint32_t input indices, Heap8Aux
+// or Heap8Embed (see KWayMergerEmbed), or StdMinHeapMap for comparison,
+// or the TournamentTree8 (see KWayMergerTournament).
+//
+// merge_reduce and next_reduced_block merge and compact in one pass, as in
+// LSM compaction: the values with equal keys are folded into one with a
+// combiner, in input order, and the result is dropped if it's a tombstone.
+
+// Key of a value that is its own key.
+struct KeyIdentity {
+  template<class T> std::uint16_t operator()(T const& x) const { return x; }
+};
+
+// Key of a pair with the key first and a payload second.
+struct KeyFirst {
+  template<class T> std::uint16_t operator()(T const& x) const { return x.first; }
+};
+
+// Combiner that keeps the value from the last input, e.g. the newest run
+// if the inputs are ordered from oldest to newest.
+struct KeepLast {
+  template<class T> T operator()(T const&, T newer) const { return newer; }
+};
+
+// Tombstone predicate for inputs without tombstones.
+struct NoTombstones {
+  template<class T> bool operator()(T const&) const { return false; }
+};
+
+template<class Iterator, class KeyOf = KeyIdentity> class IteratorCursor {
+ public:
+  typedef typename std::iterator_traits<Iterator>::value_type value_type;
+  typedef typename std::iterator_traits<Iterator>::reference reference;
+
+  IteratorCursor() = default;
+  IteratorCursor(Iterator begin, Iterator end, KeyOf key_of = KeyOf())
+    : begin_(begin), end_(end), key_of_(key_of) { }
+
+  bool empty() const { return begin_ == end_; }
+  std::uint16_t key() const { return key_of_(*begin_); }
+  reference value() const { return *begin_; }
+  void next() { ++begin_; }
+
+  // Prefetches a few cache lines ahead if the input is an array.
+  void prefetch() const {
+    if constexpr (std::is_pointer<Iterator>::value) {
+      constexpr std::ptrdiff_t kDistance = 256 / sizeof(value_type) + 1;
+      if (end_ - begin_ > kDistance) __builtin_prefetch(begin_ + kDistance);
+    }
+  }
+
+ private:
+  Iterator begin_;
+  Iterator end_;
+  KeyOf key_of_;
+};
+
+template<class Iterator, class KeyOf = KeyIdentity>
+IteratorCursor<Iterator, KeyOf> makeCursor(Iterator begin, Iterator end, KeyOf key_of = KeyOf()) {
+  return IteratorCursor<Iterator, KeyOf>(begin, end, key_of);
+}
+
+template<class Cursor, class Heap = Heap8Aux<std::uint32_t>> class KWayMerger {
+ public:
+  typedef Cursor cursor_type;
+  typedef typename Cursor::value_type value_type;
+  typedef typename Heap::key_type key_type;
+  typedef std::size_t size_type;
+
+ private:
+  typedef std::uint32_t index_type;
+
+  static_assert(std::is_same<typename Heap::mapped_type, index_type>::value);
+
+ public:
+  KWayMerger() = default;
+  KWayMerger(const KWayMerger&) = delete;
+  KWayMerger& operator=(const KWayMerger&) = delete;
+
+  template<class InputIterator>
+  KWayMerger(InputIterator begin, InputIterator end) { reset(begin, end); }
+
+  // Starts a new merge of the cursors in [begin, end).
+  template<class InputIterator>
+  void reset(InputIterator begin, InputIterator end) {
+    heap_.clear();
+    cursors_.assign(begin, end);
+    size_type active = 0;
+    for (cursor_type const& c : cursors_) active += !c.empty();
+    heap_.extend(active);
+    size_type i = 0;
+    for (index_type j = 0; j < cursors_.size(); ++j) {
+      cursor_type const& c = cursors_[j];
+      if (c.empty()) continue;
+      c.prefetch();
+      heap_.set_entry(i++, {c.key(), j});
+    }
+    heap_.heapify();
+  }
+
+  // True when every input is exhausted.
+  bool empty() const { return heap_.size() == 0; }
+
+  // The number of inputs that aren't exhausted.
+  size_type active_inputs() const { return heap_.size(); }
+
+  // The cursor with the smallest head, of inputs with equal keys the one
+  // that comes first in heap order.
+  // Precondition: !empty().
+  cursor_type const& top_cursor() const {
+    return cursors_[heap_.mapped(heap_.top_index())];
+  }
+
+  key_type top_key() const { return top_cursor().key(); }
+
+  decltype(auto) top() const { return top_cursor().value(); }
+
+  // Advances past top().
+  void pop() { advance(heap_.top_index()); }
+
+  // Writes the next up to n merged values to out and returns how many,
+  // zero when the merge is done.
+  template<class OutputIterator>
+  size_type next_block(OutputIterator out, size_type n) {
+    size_type count = 0;
+    while (count < n && !empty()) {
+      size_type index = heap_.top_index();
+      *out++ = cursors_[heap_.mapped(index)].value();
+      advance(index);
+      ++count;
+    }
+    return count;
+  }
+
+  // Writes all the remaining merged values to out.
+  template<class OutputIterator>
+  OutputIterator merge(OutputIterator out) {
+    while (!empty()) {
+      size_type index = heap_.top_index();
+      *out++ = cursors_[heap_.mapped(index)].value();
+      advance(index);
+    }
+    return out;
+  }
+
+  // Like next_block, but folds the values with equal keys into one with
+  // the associative combine(older, newer), older values being those from
+  // earlier inputs in [begin, end) or earlier in the same input. Results
+  // for which is_tombstone is true are skipped. Returns the number of
+  // values written, zero when the merge is done.
+  template<class OutputIterator, class Combine = KeepLast, class IsTombstone = NoTombstones>
+  size_type next_reduced_block(OutputIterator out, size_type n,
+                               Combine combine = Combine(), IsTombstone is_tombstone = IsTombstone()) {
+    size_type count = 0;
+    while (count < n && !empty()) {
+      value_type v = reduce_top(combine);
+      if (is_tombstone(v)) continue;
+      *out++ = std::move(v);
+      ++count;
+    }
+    return count;
+  }
+
+  // Like merge, but combines equal keys and drops tombstones like
+  // next_reduced_block.
+  template<class OutputIterator, class Combine = KeepLast, class IsTombstone = NoTombstones>
+  OutputIterator merge_reduce(OutputIterator out,
+                              Combine combine = Combine(), IsTombstone is_tombstone = IsTombstone()) {
+    while (!empty()) {
+      value_type v = reduce_top(combine);
+      if (!is_tombstone(v)) *out++ = std::move(v);
+    }
+    return out;
+  }
+
+ private:
+  // Folds the values with the smallest key and advances past them. The
+  // values of each input are folded as they're read, without going through
+  // the heap, so combine must be associative for the result to be the same
+  // as folding all the values in order.
+  template<class Combine>
+  value_type reduce_top(Combine& combine) {
+    key_type k = top_key();
+    index_type j;
+    value_type v = reduce_input(combine, k, &j);
+    // Most keys are unique.
+    if (empty() || top_key() != k) return v;
+    // The heap yields the inputs with equal keys in no particular order.
+    group_.clear();
+    group_.emplace_back(j, std::move(v));
+    do {
+      value_type w = reduce_input(combine, k, &j);
+      group_.emplace_back(j, std::move(w));
+    } while (!empty() && top_key() == k);
+    fold_group(combine, &v);
+    return v;
+  }
+
+  // Folds group_ in input order into *v. Sorts by input index, or if the
+  // inputs in the group are dense enough, visits them in order with a
+  // bitmap of the inputs.
+  template<class Combine>
+  void fold_group(Combine& combine, value_type* v) {
+    index_type lo = group_[0].first, hi = lo;
+    for (group_entry const& e : group_) {
+      lo = std::min(lo, e.first);
+      hi = std::max(hi, e.first);
+    }
+    size_type lo_word = lo / 64, hi_word = hi / 64;
+    if (hi_word - lo_word >= 2 * group_.size()) {
+      std::sort(group_.begin(), group_.end(),
+        [](group_entry const& a, group_entry const& b) { return a.first < b.first; });
+      *v = std::move(group_[0].second);
+      for (size_type i = 1; i < group_.size(); ++i) {
+        *v = combine(std::move(*v), std::move(group_[i].second));
+      }
+      return;
+    }
+    if (group_slots_.size() < cursors_.size()) {
+      group_slots_.resize(cursors_.size());
+      group_bits_.resize((cursors_.size() + 63) / 64);
+    }
+    for (index_type i = 0; i < group_.size(); ++i) {
+      index_type j = group_[i].first;
+      group_slots_[j] = i;
+      group_bits_[j / 64] |= std::uint64_t(1) << (j % 64);
+    }
+    bool first = true;
+    for (size_type w = lo_word; w <= hi_word; ++w) {
+      for (std::uint64_t bits = group_bits_[w]; bits != 0; bits &= bits - 1) {
+        index_type j = w * 64 + __builtin_ctzll(bits);
+        value_type& x = group_[group_slots_[j]].second;
+        if (first) {
+          *v = std::move(x);
+          first = false;
+        } else {
+          *v = combine(std::move(*v), std::move(x));
+        }
+      }
+      group_bits_[w] = 0;
+    }
+  }
+
+  // Folds the top cursor's values with key k, sets *j to its index, and
+  // advances past them.
+  template<class Combine>
+  value_type reduce_input(Combine& combine, key_type k, index_type* j) {
+    size_type index = heap_.top_index();
+    *j = heap_.mapped(index);
+    cursor_type& c = cursors_[*j];
+    value_type v = c.value();
+    for (c.next(); !c.empty() && c.key() == k; c.next()) v = combine(std::move(v), c.value());
+    settle(index);
+    return v;
+  }
+
+  // Advances the cursor of the heap entry at index.
+  void advance(size_type index) {
+    cursors_[heap_.mapped(index)].next();
+    settle(index);
+  }
+
+  // Updates the heap entry at index after its cursor advanced.
+  void settle(size_type index) {
+    index_type j = heap_.mapped(index);
+    cursor_type& c = cursors_[j];
+    if (c.empty()) {
+      heap_.pop_entry();
+    } else {
+      c.prefetch();
+      // Faster than pop_entry followed by push_entry.
+      heap_.push_down(c.key(), j, index);
+    }
+  }
+
+  typedef std::pair<index_type, value_type> group_entry;
+
+  Heap heap_;
+  std::vector<cursor_type> cursors_;
+  // reduce_top scratch space
+  std::vector<group_entry> group_;
+  std::vector<index_type> group_slots_;
+  std::vector<std::uint64_t> group_bits_;
+};
+
+template<class Cursor>
+using KWayMergerEmbed = KWayMerger<Cursor, Heap8Embed<std::uint32_t>>;
+
+template<class Cursor>
+using KWayMergerTournament = KWayMerger<Cursor, TournamentTree8>;
@@ -0,0 +1,266 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main KWayMergeTest.cpp
+   ./a.out
+*/
+
+#include "KWayMerge.hpp"
+#include "StdMinHeapMap.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+typedef std::uint16_t Key;
+
+std::vector<std::vector<Key>> randomTable(int seed, size_t count, size_t max_size) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<size_t> sizes(0, max_size);
+  std::uniform_int_distribution<Key> keys(0, 1000);
+  std::vector<std::vector<Key>> table(count);
+  for (auto& list : table) {
+    list.resize(sizes(gen));
+    for (Key& k : list) k = keys(gen);
+    std::sort(list.begin(), list.end());
+  }
+  return table;
+}
+
+template<class Table>
+std::vector<Key> flatSorted(Table const& table) {
+  std::vector<Key> all;
+  for (auto const& list : table) all.insert(all.end(), list.begin(), list.end());
+  std::sort(all.begin(), all.end());
+  return all;
+}
+
+typedef IteratorCursor<Key const*> ArrayCursor;
+
+template<class Table>
+std::vector<ArrayCursor> cursors(Table const& table) {
+  std::vector<ArrayCursor> v;
+  for (auto const& list : table) v.emplace_back(list.data(), list.data() + list.size());
+  return v;
+}
+
+template <class T>
+class KWayMergeTest : public testing::Test {
+ protected:
+  typedef KWayMerger<ArrayCursor, T> merger_type;
+};
+
+typedef testing::Types<
+  Heap8Aux<std::uint32_t>,
+  Heap8Embed<std::uint32_t>,
+  StdMinHeapMap<std::uint32_t>,
+  TournamentTree8
+> Implementations;
+
+TYPED_TEST_SUITE(KWayMergeTest, Implementations);
+
+TYPED_TEST(KWayMergeTest, NoInputs) {
+  typename TestFixture::merger_type merger;
+  std::vector<ArrayCursor> none;
+  merger.reset(none.begin(), none.end());
+  EXPECT_TRUE(merger.empty());
+  std::vector<Key> out;
+  merger.merge(std::back_inserter(out));
+  EXPECT_TRUE(out.empty());
+}
+
+TYPED_TEST(KWayMergeTest, EmptyInputs) {
+  std::vector<std::vector<Key>> table{{}, {3, 5}, {}, {}, {1, 4, 9}, {}};
+  auto cs = cursors(table);
+  typename TestFixture::merger_type merger(cs.begin(), cs.end());
+  EXPECT_EQ(2, merger.active_inputs());
+  EXPECT_EQ(1, merger.top_key());
+  std::vector<Key> out;
+  merger.merge(std::back_inserter(out));
+  EXPECT_EQ(std::vector<Key>({1, 3, 4, 5, 9}), out);
+  EXPECT_TRUE(merger.empty());
+}
+
+TYPED_TEST(KWayMergeTest, Random) {
+  for (size_t count : {1, 7, 8, 9, 100}) {
+    auto table = randomTable(count, count, 300);
+    auto cs = cursors(table);
+    typename TestFixture::merger_type merger(cs.begin(), cs.end());
+    std::vector<Key> out;
+    merger.merge(std::back_inserter(out));
+    EXPECT_EQ(flatSorted(table), out);
+  }
+}
+
+TYPED_TEST(KWayMergeTest, Blocks) {
+  auto table = randomTable(1, 20, 100);
+  auto cs = cursors(table);
+  typename TestFixture::merger_type merger;
+  // The merger can be reused.
+  for (size_t n : {1, 7, 64, 5000}) {
+    merger.reset(cs.begin(), cs.end());
+    std::vector<Key> out;
+    std::vector<Key> block(n);
+    while (size_t m = merger.next_block(block.data(), n)) {
+      EXPECT_TRUE(m == n || merger.empty());
+      out.insert(out.end(), block.begin(), block.begin() + m);
+    }
+    EXPECT_EQ(flatSorted(table), out);
+  }
+}
+
+// Inputs that run out while others still have kMax keys.
+TYPED_TEST(KWayMergeTest, MaxKeys) {
+  constexpr Key M = 65535;
+  std::vector<std::vector<Key>> table{{M, M}, {1}, {}, {M}, {0, 2}, {M, M, M}};
+  for (int i = 0; i < 10; ++i) table.push_back({Key(i), M});
+  auto cs = cursors(table);
+  typename TestFixture::merger_type merger(cs.begin(), cs.end());
+  std::vector<Key> out;
+  merger.merge(std::back_inserter(out));
+  EXPECT_EQ(flatSorted(table), out);
+}
+
+TYPED_TEST(KWayMergeTest, TopPop) {
+  std::vector<std::vector<Key>> table{{2, 2, 7}, {1, 2}};
+  auto cs = cursors(table);
+  typename TestFixture::merger_type merger(cs.begin(), cs.end());
+  std::vector<Key> out;
+  while (!merger.empty()) {
+    out.push_back(merger.top());
+    merger.pop();
+  }
+  EXPECT_EQ(std::vector<Key>({1, 2, 2, 2, 7}), out);
+}
+
+TYPED_TEST(KWayMergeTest, ReduceUnique) {
+  auto table = randomTable(2, 30, 100);
+  auto cs = cursors(table);
+  typename TestFixture::merger_type merger(cs.begin(), cs.end());
+  std::vector<Key> out;
+  merger.merge_reduce(std::back_inserter(out));
+  std::vector<Key> expected = flatSorted(table);
+  expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+  EXPECT_EQ(expected, out);
+}
+
+TYPED_TEST(KWayMergeTest, ReducedBlocks) {
+  auto table = randomTable(3, 30, 100);
+  auto cs = cursors(table);
+  typename TestFixture::merger_type merger(cs.begin(), cs.end());
+  std::vector<Key> expected;
+  merger.merge_reduce(std::back_inserter(expected));
+  // Drops the odd keys.
+  auto odd = [](Key k) { return k % 2 == 1; };
+  expected.erase(std::remove_if(expected.begin(), expected.end(), odd), expected.end());
+  for (size_t n : {1, 7, 5000}) {
+    merger.reset(cs.begin(), cs.end());
+    std::vector<Key> out;
+    std::vector<Key> block(n);
+    while (size_t m = merger.next_reduced_block(block.data(), n, KeepLast(), odd)) {
+      EXPECT_TRUE(m == n || merger.empty());
+      out.insert(out.end(), block.begin(), block.begin() + m);
+    }
+    EXPECT_EQ(expected, out);
+  }
+}
+
+TEST(KWayMergePayloadTest, Pairs) {
+  typedef std::pair<Key, std::string> Record;
+  std::vector<std::vector<Record>> table{
+    {{1, "a1"}, {4, "a4"}},
+    {},
+    {{2, "c2"}, {3, "c3"}, {5, "c5"}},
+  };
+  typedef IteratorCursor<Record const*, KeyFirst> Cursor;
+  std::vector<Cursor> cs;
+  for (auto const& list : table) cs.emplace_back(list.data(), list.data() + list.size());
+  KWayMergerEmbed<Cursor> merger(cs.begin(), cs.end());
+  std::vector<Record> out;
+  merger.merge(std::back_inserter(out));
+  std::vector<Record> expected{{1, "a1"}, {2, "c2"}, {3, "c3"}, {4, "a4"}, {5, "c5"}};
+  EXPECT_EQ(expected, out);
+}
+
+typedef std::pair<Key, int> Entry;
+typedef IteratorCursor<Entry const*, KeyFirst> EntryCursor;
+
+std::vector<EntryCursor> entryCursors(std::vector<std::vector<Entry>> const& runs) {
+  std::vector<EntryCursor> cs;
+  for (auto const& run : runs) cs.emplace_back(run.data(), run.data() + run.size());
+  return cs;
+}
+
+// Runs from oldest to newest with puts and deletes (value -1) of keys, a
+// key at most once per run, compacted with the newest value winning.
+TEST(KWayMergeReduceTest, Compaction) {
+  struct Shape { size_t runs, run_size; Key max_key; };
+  // Many duplicates per key in few inputs, and few in many.
+  for (Shape shape : {Shape{20, 100, 300}, Shape{2000, 10, 60000}}) {
+    std::default_random_engine gen(0);
+    std::uniform_int_distribution<Key> keys(0, shape.max_key);
+    std::uniform_int_distribution<int> values(-1, 5);
+    std::vector<std::vector<Entry>> runs(shape.runs);
+    std::map<Key, int> expected;
+    for (auto& run : runs) {
+      std::map<Key, int> m;
+      while (m.size() < shape.run_size) m[keys(gen)] = values(gen);
+      run.assign(m.begin(), m.end());
+      for (Entry e : run) {
+        if (e.second == -1) expected.erase(e.first);
+        else expected[e.first] = e.second;
+      }
+    }
+    auto cs = entryCursors(runs);
+    KWayMerger<EntryCursor> merger(cs.begin(), cs.end());
+    std::vector<Entry> out;
+    auto tombstone = [](Entry const& e) { return e.second == -1; };
+    merger.merge_reduce(std::back_inserter(out), KeepLast(), tombstone);
+    EXPECT_EQ(std::vector<Entry>(expected.begin(), expected.end()), out);
+  }
+}
+
+// Combines the values of duplicate keys across and within inputs, in
+// input order.
+TEST(KWayMergeReduceTest, Combine) {
+  typedef std::pair<Key, std::string> Record;
+  std::vector<std::vector<Record>> runs{
+    {{1, "a"}, {1, "b"}, {5, "c"}},
+    {},
+    {{1, "d"}, {2, "e"}, {5, "f"}, {5, "g"}},
+    {{0, "h"}, {1, "i"}},
+  };
+  typedef IteratorCursor<Record const*, KeyFirst> Cursor;
+  std::vector<Cursor> cs;
+  for (auto const& run : runs) cs.emplace_back(run.data(), run.data() + run.size());
+  KWayMergerEmbed<Cursor> merger(cs.begin(), cs.end());
+  auto concat = [](Record const& a, Record const& b) { return Record(a.first, a.second + b.second); };
+  std::vector<Record> out;
+  merger.merge_reduce(std::back_inserter(out), concat);
+  std::vector<Record> expected{{0, "h"}, {1, "abdi"}, {2, "e"}, {5, "cfg"}};
+  EXPECT_EQ(expected, out);
+}
+
+TEST(KWayMergeStreamTest, Streams) {
+  std::istringstream s0("1 5 9"), s1(""), s2("2 3 10 11");
+  typedef std::istream_iterator<Key> Iterator;
+  typedef IteratorCursor<Iterator> Cursor;
+  std::vector<Cursor> cs{
+    makeCursor(Iterator(s0), Iterator()),
+    makeCursor(Iterator(s1), Iterator()),
+    makeCursor(Iterator(s2), Iterator()),
+  };
+  KWayMerger<Cursor> merger(cs.begin(), cs.end());
+  std::vector<Key> out;
+  merger.merge(std::back_inserter(out));
+  EXPECT_EQ(std::vector<Key>({1, 2, 3, 5, 9, 10, 11}), out);
+}
+
+} // namespace
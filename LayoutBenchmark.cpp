@@ -0,0 +1,100 @@
+/*
+   brew install google-benchmark
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -lbenchmark -lbenchmark_main LayoutBenchmark.cpp
+   ./a.out
+
+   # one payload size
+   ./a.out --benchmark_filter='Payload<16>'
+*/
+
+#include "Heap8Aux.hpp"
+#include "Heap8Embed.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+// Matrix of heap map layouts over payload sizes and heap sizes:
+//   Heap8Aux: keys and mapped values in separate arrays (SoA)
+//   Heap8Embed: 8 keys followed by their 8 mapped values per node (AoS)
+//   Heap8EmbedBlock: the keys of 4 nodes followed by their mapped values (AoSoA)
+//   Heap8EmbedLayout<1, 16> and <4, 64>: aligned and padded mapped values
+
+namespace {
+
+// N byte mapped value.
+template<std::size_t N>
+struct Payload {
+  std::array<uint8_t, N> bytes;
+  Payload() = default;
+  explicit Payload(uint16_t k) { bytes.fill(uint8_t(k)); }
+};
+
+std::vector<uint16_t> randomKeys(size_t size) {
+  std::default_random_engine gen(size);
+  std::uniform_int_distribution<uint16_t> distr;
+  std::vector<uint16_t> keys(size);
+  for (auto& k : keys) k = distr(gen);
+  return keys;
+}
+
+// Pushes all keys and pops them all.
+template<class HeapMap>
+void bm_pushpop(benchmark::State& state) {
+  std::vector<uint16_t> keys = randomKeys(state.range(0));
+  HeapMap heap_map;
+  for (auto _ : state) {
+    for (uint16_t k : keys) heap_map.emplace_entry(k, k);
+    while (heap_map.size() > 0) {
+      benchmark::DoNotOptimize(heap_map.pop_entry().second.bytes[0]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Heapifies the keys and pops them all.
+template<class HeapMap>
+void bm_heapsort(benchmark::State& state) {
+  typedef typename HeapMap::entry_type entry_type;
+  typedef typename HeapMap::mapped_type mapped_type;
+  std::vector<uint16_t> keys = randomKeys(state.range(0));
+  std::vector<entry_type> entries;
+  for (uint16_t k : keys) entries.emplace_back(k, mapped_type(k));
+  HeapMap heap_map;
+  for (auto _ : state) {
+    heap_map.append_entries(entries.begin(), entries.end());
+    heap_map.heapify();
+    while (heap_map.size() > 0) {
+      benchmark::DoNotOptimize(heap_map.pop_entry().second.bytes[0]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+void Arguments(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+}
+
+} // namespace
+
+#define LAYOUT_BENCHMARKS(bm, N) \
+  BENCHMARK_TEMPLATE(bm, Heap8Aux<Payload<N>>)->Apply(Arguments); \
+  BENCHMARK_TEMPLATE(bm, Heap8Embed<Payload<N>>)->Apply(Arguments); \
+  BENCHMARK_TEMPLATE(bm, Heap8EmbedBlock<Payload<N>>)->Apply(Arguments); \
+  BENCHMARK_TEMPLATE(bm, Heap8Embed<Payload<N>, Heap8EmbedLayout<1, 16>>)->Apply(Arguments); \
+  BENCHMARK_TEMPLATE(bm, Heap8Embed<Payload<N>, Heap8EmbedLayout<4, 64>>)->Apply(Arguments)
+
+LAYOUT_BENCHMARKS(bm_pushpop, 2);
+LAYOUT_BENCHMARKS(bm_pushpop, 4);
+LAYOUT_BENCHMARKS(bm_pushpop, 8);
+LAYOUT_BENCHMARKS(bm_pushpop, 16);
+LAYOUT_BENCHMARKS(bm_pushpop, 32);
+LAYOUT_BENCHMARKS(bm_pushpop, 64);
+LAYOUT_BENCHMARKS(bm_heapsort, 2);
+LAYOUT_BENCHMARKS(bm_heapsort, 4);
+LAYOUT_BENCHMARKS(bm_heapsort, 8);
+LAYOUT_BENCHMARKS(bm_heapsort, 16);
+LAYOUT_BENCHMARKS(bm_heapsort, 32);
+LAYOUT_BENCHMARKS(bm_heapsort, 64);
@@ -4,6 +4,7 @@
    ./a.out
 */
 
+#include "KWayMerge.hpp"
 #include "Heap8Aux.hpp"
 #include "Heap8Embed.hpp"
 #include "StdMinHeapMap.hpp"
@@ -18,51 +19,8 @@
 namespace {
 
 typedef uint16_t KeyType;
-typedef uint16_t MappedType;
 
-struct Record {
-  size_t size;
-  KeyType const* list;
-  size_t offset;
-};
-
-// Table must behave like vector<vector<KeyType>>.
-// OutputIterator type must be pair<KeyType, MappedType>.
-template<typename HeapMap, typename Table, typename OutputIterator>
-void merge(HeapMap& heap_map, Table table, OutputIterator out) {
-  assert(heap_map.size() == 0);
-
-  std::vector<Record> records;
-  records.reserve(table.size());
-  for (auto const& x : table) {
-    records.push_back({x.size(), x.data(), 0});
-  }
-  assert(table.size() == records.size());
-
-  heap_map.extend(records.size());
-  for (size_t i = 0; i < records.size(); ++i) {
-    auto const& r = records[i];
-    assert(r.size > 0); // for simplicity we assume every list is non-empty
-    heap_map.set_entry(i, {r.list[0], i});
-  }
-  heap_map.heapify();
-
-  while (heap_map.size() > 0) {
-    auto index = heap_map.top_index();
-    auto e = heap_map.entry(index);
-    *out++ = e;
-    auto &r = records[e.second];
-    assert(r.offset < r.size);
-    r.offset++;
-    if (r.offset == r.size) {
-      auto d = heap_map.pop_entry();
-      assert(d == e);
-    } else {
-      // Should be faster than pop_entry followed by push_entry.
-      heap_map.push_down(r.list[r.offset], e.second, index);
-    }
-  }
-}
+typedef IteratorCursor<KeyType const*> Cursor;
 
 template<typename OutputIterator>
 void initRandomArray(int seed, size_t sz, OutputIterator out) {
@@ -85,9 +43,19 @@ std::vector<KeyType> randomSortedVector(int seed, size_t sz) {
   return v;
 }
 
-template<typename Pair>
-void doNotOptimizeAway_pair(Pair const& pair) {
-  benchmark::DoNotOptimize(pair.first + pair.second);
+std::vector<std::vector<KeyType>> randomTable(size_t count, size_t size) {
+  std::vector<std::vector<KeyType>> table;
+  table.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    table.push_back(randomSortedVector(i, size));
+  }
+  return table;
+}
+
+std::vector<Cursor> cursors(std::vector<std::vector<KeyType>> const& table) {
+  std::vector<Cursor> v;
+  for (auto const& list : table) v.emplace_back(list.data(), list.data() + list.size());
+  return v;
 }
 
 template<class HeapMap>
@@ -96,23 +64,121 @@ void bm_merge(benchmark::State& state) {
     state.PauseTiming();
     auto count = state.range(0);
     auto size = state.range(1);
-    std::vector<std::vector<KeyType>> table;
-    table.reserve(count);
-    for (size_t i = 0; i < count; ++i) {
-      table.push_back(randomSortedVector(i, size));
-    }
-    HeapMap heap_map;
-    std::vector<typename HeapMap::entry_type> out;
+    auto table = randomTable(count, size);
+    auto cs = cursors(table);
+    std::vector<KeyType> out;
     out.reserve(count * size);
     state.ResumeTiming();
-    merge(heap_map, table, std::back_inserter(out));
-    doNotOptimizeAway_pair(out[0]);
+    KWayMerger<Cursor, HeapMap> merger(cs.begin(), cs.end());
+    merger.merge(std::back_inserter(out));
+    benchmark::DoNotOptimize(out[0]);
+  }
+}
+
+// Merges into a fixed size output block, like a consumer that streams the
+// merged output to a file or socket.
+template<class HeapMap>
+void bm_merge_blocks(benchmark::State& state) {
+  constexpr size_t kBlockSize = 1024;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto count = state.range(0);
+    auto size = state.range(1);
+    auto table = randomTable(count, size);
+    auto cs = cursors(table);
+    std::vector<KeyType> block(kBlockSize);
+    state.ResumeTiming();
+    KWayMerger<Cursor, HeapMap> merger(cs.begin(), cs.end());
+    while (merger.next_block(block.data(), kBlockSize) > 0) {
+      benchmark::DoNotOptimize(block[0]);
+    }
+  }
+}
+
+// Key and value, with value 0 for a tombstone.
+struct Entry {
+  KeyType key;
+  uint16_t value;
+};
+
+struct KeyOfEntry {
+  uint16_t operator()(Entry const& e) const { return e.key; }
+};
+
+bool isTombstone(Entry const& e) { return e.value == 0; }
+
+typedef IteratorCursor<Entry const*, KeyOfEntry> EntryCursor;
+
+// Runs of entries with random keys, about 1 in 16 of them tombstones.
+std::vector<std::vector<Entry>> randomEntryTable(size_t count, size_t size) {
+  std::vector<std::vector<Entry>> table(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::vector<KeyType> keys = randomSortedVector(i, size);
+    std::vector<KeyType> values = randomVector(count + i, size);
+    for (size_t j = 0; j < size; ++j) table[i].push_back({keys[j], uint16_t(values[j] & 15 ? values[j] : 0)});
+  }
+  return table;
+}
+
+std::vector<EntryCursor> entryCursors(std::vector<std::vector<Entry>> const& table) {
+  std::vector<EntryCursor> v;
+  for (auto const& list : table) v.emplace_back(list.data(), list.data() + list.size());
+  return v;
+}
+
+// Compaction in two passes, a merge and a pass over the merged output
+// that keeps the last of each key and drops tombstones. (It's wrong if the
+// merge doesn't emit equal keys in input order, which only the reduced
+// merge guarantees, but it costs the same as a correct second pass.)
+template<class HeapMap>
+void bm_compact_postprocess(benchmark::State& state) {
+  constexpr size_t kBlockSize = 1024;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto table = randomEntryTable(state.range(0), state.range(1));
+    auto cs = entryCursors(table);
+    std::vector<Entry> block(kBlockSize);
+    std::vector<Entry> out;
+    out.reserve(kBlockSize);
+    state.ResumeTiming();
+    KWayMerger<EntryCursor, HeapMap> merger(cs.begin(), cs.end());
+    bool pending = false;
+    Entry last;
+    while (size_t n = merger.next_block(block.data(), kBlockSize)) {
+      out.clear();
+      for (size_t i = 0; i < n; ++i) {
+        if (pending && block[i].key != last.key && !isTombstone(last)) out.push_back(last);
+        last = block[i];
+        pending = true;
+      }
+      benchmark::DoNotOptimize(out.data());
+    }
+    if (pending && !isTombstone(last)) out.push_back(last);
+    benchmark::DoNotOptimize(out.data());
   }
 }
 
-typedef Heap8Aux<MappedType> Aux;
-typedef Heap8Embed<MappedType> Embed;
-typedef StdMinHeapMap<MappedType> Std;
+// Compaction in the merge with next_reduced_block.
+template<class HeapMap>
+void bm_compact(benchmark::State& state) {
+  constexpr size_t kBlockSize = 1024;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto table = randomEntryTable(state.range(0), state.range(1));
+    auto cs = entryCursors(table);
+    std::vector<Entry> block(kBlockSize);
+    state.ResumeTiming();
+    KWayMerger<EntryCursor, HeapMap> merger(cs.begin(), cs.end());
+    while (merger.next_reduced_block(block.data(), kBlockSize, KeepLast(), isTombstone) > 0) {
+      benchmark::DoNotOptimize(block[0]);
+    }
+  }
+}
+
+typedef Heap8Aux<uint32_t> Aux;
+typedef Heap8Embed<uint32_t> Embed;
+typedef StdMinHeapMap<uint32_t> Std;
+typedef TournamentTree8 Tournament;
 
 // Parameters in ascending order.
 const std::vector<int64_t> kCounts = { 10, 100 };
@@ -123,8 +189,24 @@ void Arguments(benchmark::internal::Benchmark* b) {
       b->Args({c, s});
 }
 
+// Sweeps k with a fixed total number of keys.
+const std::vector<int64_t> kSweepCounts = { 8, 64, 512, 4096, 32768, 262144, 1048576 };
+const int64_t kSweepTotal = 1 << 22;
+void SweepArguments(benchmark::internal::Benchmark* b) {
+  for (int64_t c : kSweepCounts) b->Args({c, std::max<int64_t>(kSweepTotal / c, 1)});
+}
+
 } // namespace
 
 BENCHMARK_TEMPLATE(bm_merge, Aux)->Apply(Arguments);
 BENCHMARK_TEMPLATE(bm_merge, Embed)->Apply(Arguments);
 BENCHMARK_TEMPLATE(bm_merge, Std)->Apply(Arguments);
+BENCHMARK_TEMPLATE(bm_merge, Tournament)->Apply(Arguments);
+BENCHMARK_TEMPLATE(bm_merge_blocks, Aux)->Apply(Arguments);
+BENCHMARK_TEMPLATE(bm_merge_blocks, Embed)->Apply(Arguments);
+BENCHMARK_TEMPLATE(bm_compact_postprocess, Aux)->Apply(Arguments);
+BENCHMARK_TEMPLATE(bm_compact, Aux)->Apply(Arguments);
+BENCHMARK_TEMPLATE(bm_merge, Aux)->Apply(SweepArguments);
+BENCHMARK_TEMPLATE(bm_merge, Embed)->Apply(SweepArguments);
+BENCHMARK_TEMPLATE(bm_merge, Std)->Apply(SweepArguments);
+BENCHMARK_TEMPLATE(bm_merge, Tournament)->Apply(SweepArguments);
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "UInt.hpp"
+#include "align.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Vector of UInt<N> values bit-packed in blocks of 8 values, N bytes per
+// block, for Heap8Aux shadow storage with one block per node. Values are
+// read and written with unaligned 64 bit (128 bit for N > 57) loads and
+// stores and shifts, assuming little endian.
+//
+// Supports the subset of the std::vector interface used by Heap8Aux.
+// Non-const operator[] returns a proxy reference.
+template<unsigned N> class PackedVector {
+ public:
+  typedef UInt<N> value_type;
+  typedef std::size_t size_type;
+  typedef value_type const_reference;
+
+ private:
+  static constexpr size_type kBlock = 8; // values per block of N bytes
+  // Bytes after the last block so that loads at any value don't overrun.
+  static constexpr size_type kTail = N + 7 <= 64 ? 8 : 16;
+  static constexpr uint64_t kMask = value_type::kMask;
+
+  static size_type bytes_for(size_type n) {
+    return align_up(n, kBlock) / kBlock * N + kTail;
+  }
+
+ public:
+  class reference {
+   public:
+    reference(uint8_t* bytes, size_type index) : bytes_(bytes), index_(index) { }
+    operator value_type() const { return PackedVector::get(bytes_, index_); }
+    reference& operator=(value_type v) {
+      PackedVector::set(bytes_, index_, v);
+      return *this;
+    }
+    reference& operator=(reference const& r) { return *this = value_type(r); }
+   private:
+    uint8_t* bytes_;
+    size_type index_;
+  };
+
+  PackedVector() : size_(0) { }
+  ~PackedVector() = default;
+  PackedVector(const PackedVector&) = delete;
+  PackedVector& operator=(const PackedVector&) = delete;
+
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  value_type operator[](size_type index) const {
+    assert(index < size_);
+    return get(bytes_.data(), index);
+  }
+  reference operator[](size_type index) {
+    assert(index < size_);
+    return reference(bytes_.data(), index);
+  }
+
+  // Bytes allocated on the heap.
+  size_type allocated_bytes() const { return bytes_.capacity(); }
+
+  void reserve(size_type n) {
+    if (bytes_for(n) > bytes_.size()) bytes_.resize(bytes_for(n));
+  }
+
+  void push_back(value_type v) {
+    reserve(size_ + 1);
+    set(bytes_.data(), size_++, v);
+  }
+
+  template<class... Args>
+  void emplace_back(Args&&... args) {
+    push_back(value_type(std::forward<Args>(args)...));
+  }
+
+  void pop_back() {
+    assert(size_ > 0);
+    --size_;
+  }
+
+  void resize(size_type n, value_type v = value_type(0)) {
+    reserve(n);
+    while (size_ < n) set(bytes_.data(), size_++, v);
+    size_ = n;
+  }
+
+  void clear() { size_ = 0; }
+
+  void shrink_to_fit() {
+    if (size_ == 0) {
+      bytes_.clear();
+    } else {
+      bytes_.resize(bytes_for(size_));
+    }
+    bytes_.shrink_to_fit();
+  }
+
+ private:
+  typedef typename std::conditional<N + 7 <= 64, uint64_t, unsigned __int128>::type word_type;
+
+  static uint8_t const* address(uint8_t const* bytes, size_type index, unsigned* shift) {
+    size_type bit = (index % kBlock) * N;
+    *shift = bit % 8;
+    return bytes + (index / kBlock) * N + bit / 8;
+  }
+
+  static value_type get(uint8_t const* bytes, size_type index) {
+    unsigned shift;
+    uint8_t const* p = address(bytes, index, &shift);
+    word_type w;
+    std::memcpy(&w, p, sizeof(w));
+    return uint64_t(w >> shift) & kMask;
+  }
+
+  static void set(uint8_t* bytes, size_type index, value_type v) {
+    unsigned shift;
+    uint8_t* p = const_cast<uint8_t*>(address(bytes, index, &shift));
+    word_type w;
+    std::memcpy(&w, p, sizeof(w));
+    w &= ~(word_type(kMask) << shift);
+    w |= word_type(uint64_t(v)) << shift;
+    std::memcpy(p, &w, sizeof(w));
+  }
+
+  std::vector<uint8_t> bytes_;
+  size_type size_;
+};
@@ -0,0 +1,70 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main PackedVectorTest.cpp
+   ./a.out
+*/
+
+#include "PackedVector.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+template<unsigned N>
+void testRandom() {
+  constexpr uint64_t mask = (uint64_t(1) << N) - 1;
+  std::default_random_engine gen(N);
+  std::uniform_int_distribution<uint64_t> distr(0, mask);
+  std::vector<uint64_t> expected;
+  PackedVector<N> v;
+  for (int i = 0; i < 1000; ++i) {
+    expected.push_back(distr(gen));
+    v.push_back(expected.back());
+  }
+  // Overwrite and move values around through proxy references.
+  for (int i = 0; i < 1000; i += 3) {
+    expected[i] = distr(gen);
+    v[i] = expected[i];
+  }
+  for (int i = 1; i < 1000; i += 7) {
+    expected[i] = expected[i - 1];
+    v[i] = v[i - 1];
+  }
+  ASSERT_EQ(expected.size(), v.size());
+  PackedVector<N> const& c = v;
+  for (size_t i = 0; i < expected.size(); ++i) EXPECT_EQ(expected[i], c[i]) << i;
+  v[999] = mask;
+  EXPECT_EQ(mask, c[999]);
+  EXPECT_EQ(expected[998], c[998]);
+}
+
+TEST(PackedVector, random) {
+  testRandom<17>();
+  testRandom<33>();
+  testRandom<48>();
+  testRandom<57>();
+  testRandom<58>();
+  testRandom<63>();
+}
+
+TEST(PackedVector, resize) {
+  PackedVector<40> v;
+  PackedVector<40> const& c = v;
+  v.resize(10, 7);
+  EXPECT_EQ(10, v.size());
+  EXPECT_EQ(7, c[9]);
+  v.pop_back();
+  EXPECT_EQ(9, v.size());
+  v.resize(20);
+  EXPECT_EQ(0, c[19]);
+  EXPECT_EQ(7, c[8]);
+  // 3 blocks of 8 values in 40 bytes each, plus a tail
+  EXPECT_LE(3 * 40, v.allocated_bytes());
+  v.clear();
+  v.shrink_to_fit();
+  EXPECT_EQ(0, v.allocated_bytes());
+}
+
+} // namespace
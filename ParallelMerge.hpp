@@ -0,0 +1,110 @@
+#pragma once
+
+#include "KWayMerge.hpp"
+#include "Heap8Aux.hpp"
+#include "ThreadPool.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Parallel k-way merge of sorted arrays. Splitter keys cut the key space
+// into ranges with about equally many values, and each range of every
+// input is merged by its own KWayMerger on a ThreadPool, writing to its own
+// part of the output.
+//
+// The splitters are found by binary search over the 16 bit key space,
+// counting the values below a candidate key with a binary search in each
+// input. All values with the same key land in the same range, so heavily
+// duplicated keys can leave the ranges uneven.
+
+// A sorted input array [first, second).
+template<class T> using MergeList = std::pair<T const*, T const*>;
+
+// The first value in list with key >= key.
+template<class T, class KeyOf>
+T const* mergeLowerBound(MergeList<T> list, std::uint32_t key, KeyOf key_of) {
+  return std::lower_bound(list.first, list.second, key,
+    [key_of](T const& x, std::uint32_t k) { return key_of(x) < k; });
+}
+
+// Number of values with keys less than key.
+template<class T, class KeyOf>
+std::size_t mergeCountBelow(std::vector<MergeList<T>> const& lists, std::uint32_t key, KeyOf key_of) {
+  std::size_t count = 0;
+  for (MergeList<T> list : lists) count += mergeLowerBound(list, key, key_of) - list.first;
+  return count;
+}
+
+// Returns parts + 1 increasing keys from 0 to 65536 such that about
+// 1/parts of the values have keys in each range [splitters[p], splitters[p+1]).
+template<class T, class KeyOf = KeyIdentity>
+std::vector<std::uint32_t> mergeSplitters(std::vector<MergeList<T>> const& lists,
+                                          std::size_t parts, KeyOf key_of = KeyOf()) {
+  constexpr std::uint32_t kEnd = 1u << 16;
+  assert(parts > 0);
+  std::size_t total = 0;
+  for (MergeList<T> list : lists) total += list.second - list.first;
+  std::vector<std::uint32_t> splitters{0};
+  for (std::size_t p = 1; p < parts; ++p) {
+    std::size_t rank = total * p / parts;
+    // Smallest key with at least rank values below it.
+    std::uint32_t lo = splitters.back(), hi = kEnd;
+    while (lo < hi) {
+      std::uint32_t mid = lo + (hi - lo) / 2;
+      if (mergeCountBelow(lists, mid, key_of) < rank) lo = mid + 1;
+      else hi = mid;
+    }
+    splitters.push_back(lo);
+  }
+  splitters.push_back(kEnd);
+  return splitters;
+}
+
+// Merges the lists into out, which must have room for all their values,
+// in up to threads parts on the workers of pool and the calling thread, and
+// returns the end of the output.
+template<class Heap = Heap8Aux<std::uint32_t>, class T, class KeyOf = KeyIdentity>
+T* parallelMerge(ThreadPool& pool, std::vector<MergeList<T>> const& lists, T* out,
+                 std::size_t threads, KeyOf key_of = KeyOf()) {
+  typedef IteratorCursor<T const*, KeyOf> Cursor;
+  assert(threads > 0);
+  std::vector<std::uint32_t> splitters = mergeSplitters(lists, threads, key_of);
+  std::size_t parts = splitters.size() - 1;
+
+  // bounds[p][i] is where range p starts in list i.
+  std::vector<std::vector<T const*>> bounds(parts + 1);
+  for (std::size_t p = 0; p <= parts; ++p) {
+    for (MergeList<T> list : lists) {
+      bounds[p].push_back(p == parts ? list.second : mergeLowerBound(list, splitters[p], key_of));
+    }
+  }
+
+  // Where part p starts in the output.
+  std::vector<T*> outs{out};
+  for (std::size_t p = 0; p < parts; ++p) {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < lists.size(); ++i) n += bounds[p + 1][i] - bounds[p][i];
+    outs.push_back(outs.back() + n);
+  }
+
+  pool.forEach(parts, [&](std::size_t p) {
+    std::vector<Cursor> cursors;
+    cursors.reserve(lists.size());
+    for (std::size_t i = 0; i < lists.size(); ++i) {
+      cursors.emplace_back(bounds[p][i], bounds[p + 1][i], key_of);
+    }
+    KWayMerger<Cursor, Heap> merger(cursors.begin(), cursors.end());
+    merger.merge(outs[p]);
+  });
+  return outs[parts];
+}
+
+// parallelMerge on ThreadPool::shared().
+template<class Heap = Heap8Aux<std::uint32_t>, class T, class KeyOf = KeyIdentity>
+T* parallelMerge(std::vector<MergeList<T>> const& lists, T* out,
+                 std::size_t threads, KeyOf key_of = KeyOf()) {
+  return parallelMerge<Heap>(ThreadPool::shared(), lists, out, threads, key_of);
+}
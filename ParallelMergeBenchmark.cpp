@@ -0,0 +1,60 @@
+/*
+   brew install google-benchmark
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -pthread -lbenchmark -lbenchmark_main ParallelMergeBenchmark.cpp
+   ./a.out
+*/
+
+#include "ParallelMerge.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+typedef uint16_t KeyType;
+
+// Total number of keys, split evenly over the lists.
+constexpr int64_t kTotal = 1 << 23;
+
+std::vector<std::vector<KeyType>> randomTable(size_t count, size_t size) {
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<KeyType> distr(0, std::numeric_limits<KeyType>::max());
+  std::vector<std::vector<KeyType>> table(count);
+  for (auto& list : table) {
+    list.resize(size);
+    for (KeyType& k : list) k = distr(gen);
+    std::sort(list.begin(), list.end());
+  }
+  return table;
+}
+
+void bm_parallel_merge(benchmark::State& state) {
+  size_t count = state.range(0);
+  size_t threads = state.range(1);
+  auto table = randomTable(count, kTotal / count);
+  std::vector<MergeList<KeyType>> lists;
+  for (auto const& v : table) lists.emplace_back(v.data(), v.data() + v.size());
+  std::vector<KeyType> out(count * (kTotal / count));
+  for (auto _ : state) {
+    parallelMerge(lists, out.data(), threads);
+    benchmark::DoNotOptimize(out[0]);
+  }
+  state.SetItemsProcessed(state.iterations() * out.size());
+}
+
+// Lists from 10 to 10k, threads from 1 to the number of cores.
+void Arguments(benchmark::internal::Benchmark* b) {
+  int64_t cores = std::max(1u, std::thread::hardware_concurrency());
+  for (int64_t count : {10, 100, 1000, 10000}) {
+    for (int64_t threads = 1; threads < cores; threads *= 2) b->Args({count, threads});
+    b->Args({count, cores});
+  }
+}
+
+} // namespace
+
+BENCHMARK(bm_parallel_merge)->Apply(Arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
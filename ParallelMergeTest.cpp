@@ -0,0 +1,140 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main -pthread ParallelMergeTest.cpp
+   ./a.out
+*/
+
+#include "ParallelMerge.hpp"
+#include "Heap8Embed.hpp"
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+typedef std::uint16_t Key;
+
+std::vector<std::vector<Key>> randomTable(int seed, size_t count, size_t max_size, Key max_key) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<size_t> sizes(0, max_size);
+  std::uniform_int_distribution<Key> keys(0, max_key);
+  std::vector<std::vector<Key>> table(count);
+  for (auto& list : table) {
+    list.resize(sizes(gen));
+    for (Key& k : list) k = keys(gen);
+    std::sort(list.begin(), list.end());
+  }
+  return table;
+}
+
+template<class T>
+std::vector<MergeList<T>> mergeLists(std::vector<std::vector<T>> const& table) {
+  std::vector<MergeList<T>> lists;
+  for (auto const& v : table) lists.emplace_back(v.data(), v.data() + v.size());
+  return lists;
+}
+
+std::vector<Key> flatSorted(std::vector<std::vector<Key>> const& table) {
+  std::vector<Key> all;
+  for (auto const& list : table) all.insert(all.end(), list.begin(), list.end());
+  std::sort(all.begin(), all.end());
+  return all;
+}
+
+TEST(ParallelMergeTest, Splitters) {
+  std::vector<std::vector<Key>> table{{0, 1, 2, 3}, {4, 5, 6, 7}};
+  auto lists = mergeLists(table);
+  EXPECT_EQ(std::vector<uint32_t>({0, 65536}), mergeSplitters(lists, 1));
+  EXPECT_EQ(std::vector<uint32_t>({0, 4, 65536}), mergeSplitters(lists, 2));
+  EXPECT_EQ(std::vector<uint32_t>({0, 2, 4, 6, 65536}), mergeSplitters(lists, 4));
+}
+
+TEST(ParallelMergeTest, Random) {
+  for (size_t threads : {1, 2, 3, 8}) {
+    for (size_t count : {0, 1, 10, 100}) {
+      // Few distinct keys make uneven ranges.
+      for (Key max_key : {Key(3), Key(65535)}) {
+        auto table = randomTable(count, count, 500, max_key);
+        auto lists = mergeLists(table);
+        std::vector<Key> expected = flatSorted(table);
+        std::vector<Key> out(expected.size());
+        Key* end = parallelMerge(lists, out.data(), threads);
+        EXPECT_EQ(out.data() + out.size(), end);
+        EXPECT_EQ(expected, out);
+      }
+    }
+  }
+}
+
+// More parts than workers, on a pool of its own.
+TEST(ParallelMergeTest, Pool) {
+  ThreadPool pool(2);
+  auto table = randomTable(0, 50, 1000, 65535);
+  auto lists = mergeLists(table);
+  std::vector<Key> expected = flatSorted(table);
+  for (size_t threads : {1, 3, 8}) {
+    std::vector<Key> out(expected.size());
+    EXPECT_EQ(out.data() + out.size(), parallelMerge(pool, lists, out.data(), threads));
+    EXPECT_EQ(expected, out);
+  }
+}
+
+TEST(ParallelMergeTest, Payloads) {
+  typedef std::pair<Key, uint32_t> Record;
+  std::vector<std::vector<Record>> table(20);
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<Key> keys(0, 1000);
+  std::vector<Record> expected;
+  for (uint32_t i = 0; i < table.size(); ++i) {
+    for (uint32_t j = 0; j < 100; ++j) table[i].emplace_back(keys(gen), i * 1000 + j);
+    std::sort(table[i].begin(), table[i].end());
+    expected.insert(expected.end(), table[i].begin(), table[i].end());
+  }
+  std::sort(expected.begin(), expected.end());
+  auto lists = mergeLists(table);
+  std::vector<Record> out(expected.size());
+  parallelMerge<Heap8Embed<uint32_t>>(lists, out.data(), 4, KeyFirst());
+  EXPECT_TRUE(std::is_sorted(out.begin(), out.end(),
+    [](Record const& a, Record const& b) { return a.first < b.first; }));
+  // Equal keys may come out in any order of the inputs.
+  std::sort(out.begin(), out.end());
+  EXPECT_EQ(expected, out);
+}
+
+TEST(ThreadPoolTest, ForEach) {
+  for (size_t workers : {0, 1, 4}) {
+    ThreadPool pool(workers);
+    EXPECT_EQ(workers, pool.workers());
+    for (size_t parts : {0, 1, 2, 100}) {
+      std::vector<int> calls(parts);
+      pool.forEach(parts, [&](size_t p) { ++calls[p]; });
+      EXPECT_EQ(std::vector<int>(parts, 1), calls);
+    }
+  }
+}
+
+// Parts may run forEach on the same pool.
+TEST(ThreadPoolTest, Nested) {
+  ThreadPool pool(2);
+  std::atomic<int> count{0};
+  pool.forEach(4, [&](size_t) { pool.forEach(4, [&](size_t) { ++count; }); });
+  EXPECT_EQ(16, count);
+}
+
+TEST(ThreadPoolTest, Exception) {
+  ThreadPool pool(2);
+  std::atomic<int> count{0};
+  EXPECT_THROW(pool.forEach(10, [&](size_t p) {
+    ++count;
+    if (p % 3 == 0) throw std::runtime_error("part");
+  }), std::runtime_error);
+  // The other parts still ran.
+  EXPECT_EQ(10, count);
+}
+
+} // namespace
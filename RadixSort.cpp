@@ -0,0 +1,236 @@
+/*
+   Counting sort and LSD radix sort of uint16 keys, see RadixSort.hpp.
+*/
+
+#include "RadixSort.hpp"
+#include "ThreadPool.hpp"
+#include <emmintrin.h> // __m128i
+#include <cstddef> // size_t
+#include <cstdint> // uint16_t, uint32_t
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kKeys = size_t(1) << 16;
+constexpr size_t kBuckets = 256;
+constexpr size_t kSubHistograms = 4;
+constexpr size_t kArity = 8;
+
+// Below kSmall keys we insertion sort and from kCountingMin keys up
+// radixSort uses the counting sort rather than the radix sort.
+constexpr size_t kSmall = 32;
+constexpr size_t kCountingMin = size_t(1) << 15;
+
+// Fewer keys per part than this aren't worth handing to another thread.
+constexpr size_t kMinPerThread = size_t(1) << 16;
+
+typedef array<size_t, kBuckets> Histogram;
+
+void checkSize(size_t n) {
+  if (n > numeric_limits<uint32_t>::max()) throw length_error("radix sort of over 2^32 - 1 keys");
+}
+
+size_t partCount(size_t n, size_t threads) {
+  return max<size_t>(1, min(threads, n / kMinPerThread));
+}
+
+// Start of part p of [0, n) split into parts parts.
+size_t partBegin(size_t n, size_t p, size_t parts) {
+  return n * p / parts;
+}
+
+// Calls f(p) for p in [0, parts) on the shared thread pool. The last part
+// runs on the calling thread.
+template<class F>
+void forEachPart(size_t parts, F f) {
+  ThreadPool::shared().forEach(parts, f);
+}
+
+// Stable insertion sort of keys (and values if kPayload).
+template<bool kPayload>
+void insertionSort(uint16_t* keys, uint32_t* values, size_t n) {
+  for (size_t i = 1; i < n; ++i) {
+    uint16_t key = keys[i];
+    uint32_t value = kPayload ? values[i] : 0;
+    size_t j = i;
+    for (; j > 0 && keys[j - 1] > key; --j) {
+      keys[j] = keys[j - 1];
+      if (kPayload) values[j] = values[j - 1];
+    }
+    keys[j] = key;
+    if (kPayload) values[j] = value;
+  }
+}
+
+// Moves keys[begin, end) (and values) to dst_keys (and dst_values) at the
+// positions pos[digit], which are advanced.
+template<bool kPayload>
+void scatter(uint16_t const* keys, uint32_t const* values, uint16_t* dst_keys, uint32_t* dst_values,
+             size_t begin, size_t end, unsigned shift, Histogram& pos) {
+  for (size_t i = begin; i < end; ++i) {
+    uint16_t key = keys[i];
+    size_t q = pos[(key >> shift) & 0xff]++;
+    dst_keys[q] = key;
+    if (kPayload) dst_values[q] = values[i];
+  }
+}
+
+// LSD radix sort in two passes of 8 bits, through temporary arrays.
+template<bool kPayload>
+void lsdSort(uint16_t* keys, uint32_t* values, size_t n, size_t threads) {
+  size_t parts = partCount(n, threads);
+  vector<uint16_t> tmp_keys(n);
+  vector<uint32_t> tmp_values(kPayload ? n : 0);
+  uint16_t* src_keys = keys;
+  uint32_t* src_values = values;
+  uint16_t* dst_keys = tmp_keys.data();
+  uint32_t* dst_values = tmp_values.data();
+  // hists[p] counts the digits in part p of the source and then holds its
+  // output positions.
+  vector<Histogram> hists(parts);
+  for (unsigned shift : {0u, 8u}) {
+    forEachPart(parts, [&](size_t p) {
+      size_t begin = partBegin(n, p, parts);
+      radixHistogram(src_keys + begin, partBegin(n, p + 1, parts) - begin, shift, hists[p].data());
+    });
+    // Digit major, part minor positions keep the sort stable.
+    bool skip = false;
+    size_t sum = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+      size_t start = sum;
+      for (Histogram& hist : hists) {
+        size_t count = hist[b];
+        hist[b] = sum;
+        sum += count;
+      }
+      if (sum - start == n) skip = true;
+    }
+    if (skip) continue;
+    forEachPart(parts, [&](size_t p) {
+      scatter<kPayload>(src_keys, src_values, dst_keys, dst_values,
+                        partBegin(n, p, parts), partBegin(n, p + 1, parts), shift, hists[p]);
+    });
+    swap(src_keys, dst_keys);
+    swap(src_values, dst_values);
+  }
+  if (src_keys != keys) {
+    copy(src_keys, src_keys + n, keys);
+    if (kPayload) copy(src_values, src_values + n, values);
+  }
+}
+
+// Writes counts[key] copies of each key in [key_begin, key_end) to
+// [out, end), which must have room for exactly that many.
+void fillRuns(uint32_t const* counts, size_t key_begin, size_t key_end, uint16_t* out, uint16_t* end) {
+  for (size_t key = key_begin; key < key_end; ++key) {
+    uint16_t* run_end = out + counts[key];
+    if (end - run_end >= ptrdiff_t(kArity)) {
+      // The stores may go up to 8 keys past run_end, where the next runs
+      // write over them. The first store is unconditional so that sparse
+      // counts of 0 or 1 don't branch on the count.
+      __m128i v = _mm_set1_epi16(key);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+      for (out += kArity; out < run_end; out += kArity) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+      }
+    } else {
+      for (; out < run_end; ++out) *out = key;
+    }
+    out = run_end;
+  }
+}
+
+// Zeroed key counts of the calling thread. They're kept between calls
+// because allocating and faulting in a fresh 256KB costs more than counting
+// tens of thousands of keys.
+uint32_t* callerCounts() {
+  thread_local vector<uint32_t> counts(kKeys);
+  fill(counts.begin(), counts.end(), 0);
+  return counts.data();
+}
+
+void countingSort(uint16_t* keys, size_t n, size_t threads) {
+  size_t parts = partCount(n, threads);
+  // The last part runs on the calling thread and counts into total.
+  uint32_t* total = callerCounts();
+  vector<vector<uint32_t>> counts(parts - 1, vector<uint32_t>(kKeys));
+  forEachPart(parts, [&](size_t p) {
+    uint32_t* c = p + 1 < parts ? counts[p].data() : total;
+    for (size_t i = partBegin(n, p, parts), end = partBegin(n, p + 1, parts); i < end; ++i) {
+      ++c[keys[i]];
+    }
+  });
+  for (vector<uint32_t> const& c : counts) {
+    for (size_t key = 0; key < kKeys; ++key) total[key] += c[key];
+  }
+  // Split the key range into parts that each fill about n / parts keys.
+  vector<size_t> key_bounds{0}, out_bounds{0};
+  size_t sum = 0;
+  size_t next = partBegin(n, 1, parts);
+  for (size_t key = 0; key < kKeys && key_bounds.size() < parts; ++key) {
+    sum += total[key];
+    if (sum >= next) {
+      key_bounds.push_back(key + 1);
+      out_bounds.push_back(sum);
+      next = partBegin(n, key_bounds.size(), parts);
+    }
+  }
+  while (key_bounds.size() <= parts) {
+    key_bounds.push_back(kKeys);
+    out_bounds.push_back(n);
+  }
+  forEachPart(parts, [&](size_t p) {
+    fillRuns(total, key_bounds[p], key_bounds[p + 1], keys + out_bounds[p], keys + out_bounds[p + 1]);
+  });
+}
+
+} // namespace
+
+void radixHistogram(uint16_t const* keys, size_t n, unsigned shift, size_t* hist) {
+  // Round robin sub-histograms, so runs of equal digits don't serialize on
+  // the increments of one counter.
+  size_t sub[kSubHistograms][kBuckets] = {};
+  size_t i = 0;
+  for (; i + kSubHistograms <= n; i += kSubHistograms) {
+    for (size_t j = 0; j < kSubHistograms; ++j) ++sub[j][(keys[i + j] >> shift) & 0xff];
+  }
+  for (; i < n; ++i) ++sub[0][(keys[i] >> shift) & 0xff];
+  for (size_t b = 0; b < kBuckets; ++b) {
+    hist[b] = 0;
+    for (size_t j = 0; j < kSubHistograms; ++j) hist[b] += sub[j][b];
+  }
+}
+
+void radixSort(uint16_t* keys, size_t n, size_t threads) {
+  checkSize(n);
+  if (n <= kSmall) {
+    insertionSort<false>(keys, nullptr, n);
+  } else if (n < kCountingMin) {
+    lsdSort<false>(keys, nullptr, n, threads);
+  } else {
+    countingSort(keys, n, threads);
+  }
+}
+
+void radixSortPairs(uint16_t* keys, uint32_t* values, size_t n, size_t threads) {
+  checkSize(n);
+  if (n <= kSmall) {
+    insertionSort<true>(keys, values, n);
+  } else {
+    lsdSort<true>(keys, values, n, threads);
+  }
+}
+
+void radixArgsort(uint16_t const* keys, uint32_t* index, size_t n, size_t threads) {
+  checkSize(n);
+  vector<uint16_t> sorted(keys, keys + n);
+  iota(index, index + n, uint32_t(0));
+  radixSortPairs(sorted.data(), index, n, threads);
+}
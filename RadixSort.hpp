@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint16_t, uint32_t
+
+// Linear time sorts of uint16 keys, split into up to threads parts that
+// run on ThreadPool::shared().
+//
+// With 16 bit keys a counting sort needs a single histogram pass and a
+// fill pass, and a key+payload sort needs two LSD radix passes of 8 bits,
+// so both beat comparison sorts like std::sort and Heap8::sort on all but
+// small arrays. A radix pass is skipped when all keys have the same digit
+// in it.
+//
+// Throws std::length_error for more than 2^32 - 1 keys.
+
+// Overwrites hist[0, 256) with the counts of the digits
+// (keys[i] >> shift) & 0xff of keys[0, n), e.g. shift 8 for the high bytes.
+void radixHistogram(std::uint16_t const* keys, std::size_t n, unsigned shift, std::size_t* hist);
+
+// Sorts keys[0, n) in ascending order.
+void radixSort(std::uint16_t* keys, std::size_t n, std::size_t threads = 1);
+
+// Sorts keys[0, n) in ascending order and reorders values[0, n) the same
+// way. The sort is stable.
+void radixSortPairs(std::uint16_t* keys, std::uint32_t* values, std::size_t n,
+                    std::size_t threads = 1);
+
+// Writes to index[0, n) the stable sorting permutation of keys[0, n),
+// i.e. keys[index[0]] <= keys[index[1]] <= ... and equal keys keep their
+// order.
+void radixArgsort(std::uint16_t const* keys, std::uint32_t* index, std::size_t n,
+                  std::size_t threads = 1);
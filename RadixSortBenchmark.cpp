@@ -0,0 +1,111 @@
+/*
+   brew install google-benchmark
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -c RadixSort.cpp &&
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -pthread -lbenchmark -lbenchmark_main RadixSort.o RadixSortBenchmark.cpp
+   ./a.out
+*/
+
+#include "RadixSort.hpp"
+#include "Heap8.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+std::vector<uint16_t> randomKeys(size_t n) {
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<uint16_t> distr(0, std::numeric_limits<uint16_t>::max());
+  std::vector<uint16_t> keys(n);
+  for (uint16_t& k : keys) k = distr(gen);
+  return keys;
+}
+
+// Every iteration copies the unsorted keys before sorting them, which is
+// cheap next to any of the sorts.
+
+void bm_radix_sort(benchmark::State& state) {
+  std::vector<uint16_t> const input = randomKeys(state.range(0));
+  size_t threads = state.range(1);
+  std::vector<uint16_t> keys(input.size());
+  for (auto _ : state) {
+    std::copy(input.begin(), input.end(), keys.begin());
+    radixSort(keys.data(), keys.size(), threads);
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void bm_std_sort(benchmark::State& state) {
+  std::vector<uint16_t> const input = randomKeys(state.range(0));
+  std::vector<uint16_t> keys(input.size());
+  for (auto _ : state) {
+    std::copy(input.begin(), input.end(), keys.begin());
+    std::sort(keys.begin(), keys.end());
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+// heapify and sort, which leaves the keys in descending order.
+void bm_heap8_sort(benchmark::State& state) {
+  std::vector<uint16_t> const input = randomKeys(state.range(0));
+  Heap8 heap;
+  for (auto _ : state) {
+    heap.clear();
+    heap.append(input.begin(), input.end());
+    heap.heapify();
+    heap.sort();
+    benchmark::DoNotOptimize(heap[0]);
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void bm_radix_argsort(benchmark::State& state) {
+  std::vector<uint16_t> const keys = randomKeys(state.range(0));
+  size_t threads = state.range(1);
+  std::vector<uint32_t> index(keys.size());
+  for (auto _ : state) {
+    radixArgsort(keys.data(), index.data(), keys.size(), threads);
+    benchmark::DoNotOptimize(index.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+void bm_std_argsort(benchmark::State& state) {
+  std::vector<uint16_t> const keys = randomKeys(state.range(0));
+  std::vector<uint32_t> index(keys.size());
+  for (auto _ : state) {
+    std::iota(index.begin(), index.end(), 0);
+    std::stable_sort(index.begin(), index.end(),
+                     [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    benchmark::DoNotOptimize(index.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Sizes from 1K to 100M, radix sorts with 1 thread and all cores.
+void RadixArguments(benchmark::internal::Benchmark* b) {
+  int64_t cores = std::max(1u, std::thread::hardware_concurrency());
+  for (int64_t n = 1000; n <= 100000000; n *= 10) {
+    b->Args({n, 1});
+    if (cores > 1) b->Args({n, cores});
+  }
+}
+
+void SizeArguments(benchmark::internal::Benchmark* b) {
+  for (int64_t n = 1000; n <= 100000000; n *= 10) b->Args({n});
+}
+
+} // namespace
+
+BENCHMARK(bm_radix_sort)->Apply(RadixArguments)->UseRealTime();
+BENCHMARK(bm_std_sort)->Apply(SizeArguments);
+BENCHMARK(bm_heap8_sort)->Apply(SizeArguments);
+BENCHMARK(bm_radix_argsort)->Apply(RadixArguments)->UseRealTime();
+BENCHMARK(bm_std_argsort)->Apply(SizeArguments);
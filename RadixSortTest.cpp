@@ -0,0 +1,107 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -c RadixSort.cpp &&
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main -pthread RadixSort.o RadixSortTest.cpp
+   ./a.out
+*/
+
+#include "RadixSort.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace std;
+
+vector<uint16_t> randomKeys(size_t n, uint16_t max_key, int seed) {
+  default_random_engine gen(seed);
+  uniform_int_distribution<uint16_t> distr(0, max_key);
+  vector<uint16_t> keys(n);
+  for (uint16_t& k : keys) k = distr(gen);
+  return keys;
+}
+
+// Sizes around the insertion sort, radix sort and counting sort cutoffs and
+// the per-thread minimum.
+const vector<size_t> kSizes = {0, 1, 2, 31, 32, 33, 1000, 32767, 32768, 100000, 300001};
+const vector<uint16_t> kMaxKeys = {0, 1, 255, 256, 65535};
+
+TEST(RadixSortTest, Histogram) {
+  for (size_t n : {0, 3, 1001}) {
+    vector<uint16_t> keys = randomKeys(n, 65535, n);
+    for (unsigned shift : {0u, 8u}) {
+      vector<size_t> expected(256), hist(256, 7);
+      for (uint16_t k : keys) expected[(k >> shift) & 0xff]++;
+      radixHistogram(keys.data(), n, shift, hist.data());
+      EXPECT_EQ(expected, hist) << n << " " << shift;
+    }
+  }
+}
+
+TEST(RadixSortTest, Sort) {
+  for (size_t threads : {1, 3}) {
+    for (size_t n : kSizes) {
+      for (uint16_t max_key : kMaxKeys) {
+        vector<uint16_t> keys = randomKeys(n, max_key, n + max_key);
+        vector<uint16_t> expected = keys;
+        sort(expected.begin(), expected.end());
+        radixSort(keys.data(), n, threads);
+        ASSERT_EQ(expected, keys) << threads << " " << n << " " << max_key;
+      }
+    }
+  }
+}
+
+TEST(RadixSortTest, SortDescending) {
+  vector<uint16_t> keys(70000);
+  for (size_t i = 0; i < keys.size(); ++i) keys[i] = 65535 - i % 65536;
+  vector<uint16_t> expected = keys;
+  sort(expected.begin(), expected.end());
+  radixSort(keys.data(), keys.size(), 2);
+  EXPECT_EQ(expected, keys);
+}
+
+TEST(RadixSortTest, SortPairs) {
+  for (size_t threads : {1, 4}) {
+    for (size_t n : kSizes) {
+      for (uint16_t max_key : kMaxKeys) {
+        vector<uint16_t> keys = randomKeys(n, max_key, n * max_key);
+        vector<uint32_t> values(n);
+        iota(values.begin(), values.end(), 0);
+        vector<pair<uint16_t, uint32_t>> expected;
+        for (size_t i = 0; i < n; ++i) expected.emplace_back(keys[i], values[i]);
+        // Sorting by (key, original position) is the stable sort by key.
+        sort(expected.begin(), expected.end());
+        radixSortPairs(keys.data(), values.data(), n, threads);
+        vector<pair<uint16_t, uint32_t>> actual;
+        for (size_t i = 0; i < n; ++i) actual.emplace_back(keys[i], values[i]);
+        ASSERT_EQ(expected, actual) << threads << " " << n << " " << max_key;
+      }
+    }
+  }
+}
+
+TEST(RadixSortTest, Argsort) {
+  for (size_t threads : {1, 2}) {
+    for (size_t n : kSizes) {
+      vector<uint16_t> keys = randomKeys(n, 1000, n);
+      vector<uint16_t> const original = keys;
+      vector<uint32_t> index(n);
+      radixArgsort(keys.data(), index.data(), n, threads);
+      EXPECT_EQ(original, keys);
+      vector<uint32_t> expected(n);
+      iota(expected.begin(), expected.end(), 0);
+      stable_sort(expected.begin(), expected.end(),
+                  [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+      ASSERT_EQ(expected, index) << threads << " " << n;
+    }
+  }
+}
+
+} // namespace
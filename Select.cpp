@@ -0,0 +1,205 @@
+/*
+   Top k selection, nth element and partial sort of uint16 keys, see
+   Select.hpp.
+*/
+
+#include "Select.hpp"
+#include "Heap8.hpp"
+#include "Heap8Aux.hpp"
+#include "RadixSort.hpp"
+#include "Sort8.hpp"
+#include <emmintrin.h> // __m128i
+#include <cstddef> // size_t
+#include <cstdint> // uint16_t, uint32_t
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kBuckets = 256;
+constexpr size_t kArity = 8;
+
+// Selecting k < n / kHeapRatio keys goes through the bounded heap, more
+// through the histograms.
+constexpr size_t kHeapRatio = 256;
+
+// Below kSmall keys nthElement calls std::nth_element and from kRadixMin
+// keys up partialSort sorts with radixSort rather than sort8_mergesort.
+constexpr size_t kSmall = 1024;
+constexpr size_t kRadixMin = size_t(1) << 15;
+
+// Calls replace(i) for the i in [begin, n) with keys[i] below threshold(),
+// which replace lowers. A block of 8 keys with none below the threshold
+// costs one vector compare.
+template<class Threshold, class Replace>
+void scanBelow(uint16_t const* keys, size_t begin, size_t n, Threshold threshold, Replace replace) {
+  uint16_t t = threshold();
+  __m128i tv = _mm_set1_epi16(t);
+  size_t i = begin;
+  for (; i + kArity <= n; i += kArity) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(keys + i));
+    // t -sat key is zero where key >= t.
+    __m128i reject = _mm_cmpeq_epi16(_mm_subs_epu16(tv, block), _mm_setzero_si128());
+    unsigned mask = _mm_movemask_epi8(reject);
+    if (mask == 0xffff) continue;
+    // One bit per lane with a key below t, which may drop as we go.
+    for (unsigned lanes = ~mask & 0x5555; lanes != 0; lanes &= lanes - 1) {
+      size_t j = i + __builtin_ctz(lanes) / 2;
+      if (keys[j] < t) {
+        replace(j);
+        t = threshold();
+      }
+    }
+    tv = _mm_set1_epi16(t);
+  }
+  for (; i < n; ++i) {
+    if (keys[i] < t) {
+      replace(i);
+      t = threshold();
+    }
+  }
+}
+
+uint16_t complement(uint16_t key) { return ~key; }
+
+// A Heap8 of the complements of the k smallest of keys[0, n), 0 < k <= n.
+void heapSelect(uint16_t const* keys, size_t n, size_t k, Heap8& heap) {
+  uint16_t* array = heap.extend(k);
+  for (size_t i = 0; i < k; ++i) array[i] = complement(keys[i]);
+  heap.heapify();
+  scanBelow(keys, k, n,
+            [&heap] { return complement(heap.top()); },
+            [&heap, keys](size_t i) { heap.push_down(complement(keys[i]), heap.top_index()); });
+}
+
+// The bucket of the nth counted item, and the count of the buckets before.
+pair<size_t, size_t> findBucket(size_t const* hist, size_t nth) {
+  size_t b = 0, before = 0;
+  while (before + hist[b] <= nth) before += hist[b++];
+  return {b, before};
+}
+
+// The nth smallest of keys[0, n), nth < n.
+uint16_t selectKey(uint16_t const* keys, size_t n, size_t nth) {
+  if (nth < n / kHeapRatio) {
+    Heap8 heap;
+    heapSelect(keys, n, nth + 1, heap);
+    return complement(heap.top());
+  }
+  size_t hist[kBuckets];
+  radixHistogram(keys, n, 8, hist);
+  auto [high, before] = findBucket(hist, nth);
+  fill(hist, hist + kBuckets, 0);
+  // The keys in the high bucket, which most blocks of 8 keys have none of.
+  __m128i hv = _mm_set1_epi16(high);
+  size_t i = 0;
+  for (; i + kArity <= n; i += kArity) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(keys + i));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_srli_epi16(block, 8), hv));
+    for (unsigned lanes = mask & 0x5555; lanes != 0; lanes &= lanes - 1) {
+      ++hist[keys[i + __builtin_ctz(lanes) / 2] & 0xff];
+    }
+  }
+  for (; i < n; ++i) {
+    if ((keys[i] >> 8) == high) ++hist[keys[i] & 0xff];
+  }
+  size_t low = findBucket(hist, nth - before).first;
+  return uint16_t(high << 8 | low);
+}
+
+// Swaps the keys in [begin, end) below v, or equal to v if kEqual, to the
+// front until they fill [begin, stop), and returns the end of them. Blocks
+// of 8 keys without any of them cost one vector compare.
+template<bool kEqual>
+uint16_t* moveToFront(uint16_t* begin, uint16_t* end, uint16_t* stop, uint16_t v) {
+  __m128i vv = _mm_set1_epi16(v);
+  uint16_t* next = begin;
+  uint16_t* p = begin;
+  for (; p + kArity <= end && next < stop; p += kArity) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    unsigned mask = kEqual
+      ? _mm_movemask_epi8(_mm_cmpeq_epi16(block, vv))
+      : ~_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(vv, block), _mm_setzero_si128()));
+    // The swaps only write positions up to the lane, so the lanes after it
+    // still hold the keys in block.
+    for (unsigned lanes = mask & 0x5555; lanes != 0 && next < stop; lanes &= lanes - 1) {
+      swap(p[__builtin_ctz(lanes) / 2], *next++);
+    }
+  }
+  for (; p < end && next < stop; ++p) {
+    if (kEqual ? *p == v : *p < v) swap(*p, *next++);
+  }
+  return next;
+}
+
+void sortKeys(uint16_t* keys, size_t n) {
+  if (n < kRadixMin) {
+    sort8_mergesort(keys, n);
+  } else {
+    radixSort(keys, n);
+  }
+}
+
+} // namespace
+
+size_t topK(uint16_t const* keys, size_t n, size_t k, uint16_t* out) {
+  k = min(k, n);
+  if (k == 0) return 0;
+  if (k >= n / kHeapRatio) {
+    vector<uint16_t> copy(keys, keys + n);
+    partialSort(copy.data(), n, k);
+    std::copy(copy.begin(), copy.begin() + k, out);
+    return k;
+  }
+  Heap8 heap;
+  heapSelect(keys, n, k, heap);
+  // The complements in descending order are the keys in ascending order.
+  heap.sort();
+  for (size_t i = 0; i < k; ++i) out[i] = complement(heap[i]);
+  return k;
+}
+
+size_t topKIndices(uint16_t const* keys, size_t n, size_t k, uint32_t* index) {
+  if (n > numeric_limits<uint32_t>::max()) throw length_error("top k of over 2^32 - 1 keys");
+  k = min(k, n);
+  if (k == 0) return 0;
+  Heap8Aux<uint32_t> heap;
+  heap.extend(k);
+  for (size_t i = 0; i < k; ++i) heap.set_entry(i, {complement(keys[i]), uint32_t(i)});
+  heap.heapify();
+  scanBelow(keys, k, n,
+            [&heap] { return complement(heap.key(heap.top_index())); },
+            [&heap, keys](size_t i) {
+              heap.push_down(complement(keys[i]), uint32_t(i), heap.top_index());
+            });
+  heap.sort();
+  for (size_t i = 0; i < k; ++i) index[i] = heap.mapped(i);
+  return k;
+}
+
+void nthElement(uint16_t* keys, size_t n, size_t nth) {
+  if (nth >= n) return;
+  if (n < kSmall) {
+    std::nth_element(keys, keys + nth, keys + n);
+    return;
+  }
+  uint16_t v = selectKey(keys, n, nth);
+  uint16_t* less = moveToFront<false>(keys, keys + n, keys + n, v);
+  // Then the keys equal to v, as far as nth.
+  moveToFront<true>(less, keys + n, keys + nth + 1, v);
+}
+
+void partialSort(uint16_t* keys, size_t n, size_t k) {
+  if (k < n) {
+    // Leaves the k smallest in keys[0, k).
+    nthElement(keys, n, k);
+  } else {
+    k = n;
+  }
+  sortKeys(keys, k);
+}
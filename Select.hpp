@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint16_t, uint32_t
+
+// Selection of the smallest of n uint16 keys.
+//
+// topK and topKIndices keep the k smallest keys seen so far in a bounded
+// max-heap: a Heap8 (Heap8Aux for the indices) of complemented keys, so
+// the heap top is the largest key kept. Each block of 8 input keys is
+// compared with that threshold in one vector compare and skipped if no key
+// is below it, and only the keys below it replace the heap top. On random
+// input the threshold soon drops so low that most blocks cost a load and
+// a compare.
+//
+// nthElement and partialSort rearrange the keys in place like
+// std::nth_element and std::partial_sort. nthElement finds the nth key
+// with a histogram pass over the high bytes of all the keys and one over
+// the low bytes of the keys in its high byte bucket, then partitions the
+// keys around it.
+
+// Writes the min(k, n) smallest of keys[0, n) to out in ascending order
+// and returns how many it wrote.
+std::size_t topK(std::uint16_t const* keys, std::size_t n, std::size_t k,
+                 std::uint16_t* out);
+
+// Writes the positions of the min(k, n) smallest of keys[0, n) to index in
+// ascending order of their keys and returns how many it wrote. Which
+// positions of the kth smallest key make the cut is unspecified.
+// Throws std::length_error for more than 2^32 - 1 keys.
+std::size_t topKIndices(std::uint16_t const* keys, std::size_t n, std::size_t k,
+                        std::uint32_t* index);
+
+// Rearranges keys[0, n) so that keys[nth] is the key that would be there
+// if they were sorted, with no greater key before it and no lesser key
+// after it. Does nothing if nth >= n.
+void nthElement(std::uint16_t* keys, std::size_t n, std::size_t nth);
+
+// Rearranges keys[0, n) so that keys[0, k) are the k smallest in ascending
+// order, and the other keys follow in unspecified order.
+void partialSort(std::uint16_t* keys, std::size_t n, std::size_t k);
@@ -0,0 +1,132 @@
+/*
+   brew install google-benchmark
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -c Select.cpp Sort8.cpp RadixSort.cpp &&
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -pthread -lbenchmark -lbenchmark_main Select.o Sort8.o RadixSort.o SelectBenchmark.cpp
+   ./a.out
+*/
+
+#include "Select.hpp"
+#include "Heap8.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+std::vector<uint16_t> randomKeys(size_t n) {
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<uint16_t> distr(0, std::numeric_limits<uint16_t>::max());
+  std::vector<uint16_t> keys(n);
+  for (uint16_t& k : keys) k = distr(gen);
+  return keys;
+}
+
+// The top k benchmarks leave the keys alone, the others rearrange a copy
+// of the keys in every iteration, which is cheap next to the selections.
+
+void bm_top_k(benchmark::State& state) {
+  std::vector<uint16_t> const keys = randomKeys(state.range(0));
+  std::vector<uint16_t> out(state.range(1));
+  for (auto _ : state) {
+    topK(keys.data(), keys.size(), out.size(), out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+void bm_top_k_indices(benchmark::State& state) {
+  std::vector<uint16_t> const keys = randomKeys(state.range(0));
+  std::vector<uint32_t> index(state.range(1));
+  for (auto _ : state) {
+    topKIndices(keys.data(), keys.size(), index.size(), index.data());
+    benchmark::DoNotOptimize(index.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// heapify and pop the k smallest.
+void bm_heap8_pop(benchmark::State& state) {
+  std::vector<uint16_t> const keys = randomKeys(state.range(0));
+  size_t k = state.range(1);
+  std::vector<uint16_t> out(k);
+  Heap8 heap;
+  for (auto _ : state) {
+    heap.clear();
+    heap.append(keys.begin(), keys.end());
+    heap.heapify();
+    for (size_t i = 0; i < k; ++i) out[i] = heap.pop();
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+void bm_partial_sort(benchmark::State& state) {
+  std::vector<uint16_t> const input = randomKeys(state.range(0));
+  size_t k = state.range(1);
+  std::vector<uint16_t> keys(input.size());
+  for (auto _ : state) {
+    std::copy(input.begin(), input.end(), keys.begin());
+    partialSort(keys.data(), keys.size(), k);
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void bm_std_partial_sort(benchmark::State& state) {
+  std::vector<uint16_t> const input = randomKeys(state.range(0));
+  size_t k = state.range(1);
+  std::vector<uint16_t> keys(input.size());
+  for (auto _ : state) {
+    std::copy(input.begin(), input.end(), keys.begin());
+    std::partial_sort(keys.begin(), keys.begin() + k, keys.end());
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void bm_nth_element(benchmark::State& state) {
+  std::vector<uint16_t> const input = randomKeys(state.range(0));
+  size_t nth = state.range(1);
+  std::vector<uint16_t> keys(input.size());
+  for (auto _ : state) {
+    std::copy(input.begin(), input.end(), keys.begin());
+    nthElement(keys.data(), keys.size(), nth);
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void bm_std_nth_element(benchmark::State& state) {
+  std::vector<uint16_t> const input = randomKeys(state.range(0));
+  size_t nth = state.range(1);
+  std::vector<uint16_t> keys(input.size());
+  for (auto _ : state) {
+    std::copy(input.begin(), input.end(), keys.begin());
+    std::nth_element(keys.begin(), keys.begin() + nth, keys.end());
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+// k from 10 to 10,000 of 1M keys.
+void TopKArguments(benchmark::internal::Benchmark* b) {
+  for (int64_t k = 10; k <= 10000; k *= 10) b->Args({1000000, k});
+}
+
+// Small and large nth of 1M keys, and the median.
+void NthArguments(benchmark::internal::Benchmark* b) {
+  for (int64_t nth : {10, 10000, 500000}) b->Args({1000000, nth});
+}
+
+} // namespace
+
+BENCHMARK(bm_top_k)->Apply(TopKArguments);
+BENCHMARK(bm_top_k_indices)->Apply(TopKArguments);
+BENCHMARK(bm_heap8_pop)->Apply(TopKArguments);
+BENCHMARK(bm_partial_sort)->Apply(TopKArguments);
+BENCHMARK(bm_std_partial_sort)->Apply(TopKArguments);
+BENCHMARK(bm_nth_element)->Apply(NthArguments);
+BENCHMARK(bm_std_nth_element)->Apply(NthArguments);
@@ -0,0 +1,139 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -c Select.cpp Sort8.cpp RadixSort.cpp &&
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main -pthread Select.o Sort8.o RadixSort.o SelectTest.cpp
+   ./a.out
+*/
+
+#include "Select.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace std;
+
+vector<uint16_t> randomKeys(size_t n, uint16_t max_key, int seed) {
+  default_random_engine gen(seed);
+  uniform_int_distribution<uint16_t> distr(0, max_key);
+  vector<uint16_t> keys(n);
+  for (uint16_t& k : keys) k = distr(gen);
+  return keys;
+}
+
+// Sizes around the std::nth_element cutoff, and k around the heap and
+// histogram cutoff (n / 256) and the sizes.
+const vector<size_t> kSizes = {0, 1, 7, 8, 9, 100, 1023, 1024, 5000, 100000};
+const vector<uint16_t> kMaxKeys = {0, 3, 65535};
+
+vector<size_t> ks(size_t n) {
+  return {0, 1, 2, 8, 10, n / 256 - 1, n / 256, n / 2, n - 1, n, n + 1};
+}
+
+TEST(SelectTest, TopK) {
+  for (size_t n : kSizes) {
+    for (uint16_t max_key : kMaxKeys) {
+      vector<uint16_t> const keys = randomKeys(n, max_key, n + max_key);
+      vector<uint16_t> sorted = keys;
+      sort(sorted.begin(), sorted.end());
+      for (size_t k : ks(n)) {
+        if (k > n + 1) continue; // n / 256 - 1 wrapped around
+        size_t m = min(k, n);
+        vector<uint16_t> out(k + 1, 12345);
+        ASSERT_EQ(m, topK(keys.data(), n, k, out.data())) << n << " " << k;
+        EXPECT_TRUE(equal(sorted.begin(), sorted.begin() + m, out.begin()))
+          << n << " " << max_key << " " << k;
+        EXPECT_EQ(12345, out[m]);
+      }
+    }
+  }
+}
+
+TEST(SelectTest, TopKIndices) {
+  for (size_t n : kSizes) {
+    for (uint16_t max_key : kMaxKeys) {
+      vector<uint16_t> const keys = randomKeys(n, max_key, n * max_key);
+      vector<uint16_t> sorted = keys;
+      sort(sorted.begin(), sorted.end());
+      for (size_t k : ks(n)) {
+        if (k > n + 1) continue;
+        size_t m = min(k, n);
+        vector<uint32_t> index(k);
+        ASSERT_EQ(m, topKIndices(keys.data(), n, k, index.data()));
+        vector<uint16_t> selected;
+        for (size_t i = 0; i < m; ++i) {
+          ASSERT_LT(index[i], n);
+          selected.push_back(keys[index[i]]);
+        }
+        EXPECT_TRUE(equal(sorted.begin(), sorted.begin() + m, selected.begin()))
+          << n << " " << max_key << " " << k;
+        sort(index.begin(), index.begin() + m);
+        EXPECT_EQ(index.begin() + m, unique(index.begin(), index.begin() + m));
+      }
+    }
+  }
+}
+
+TEST(SelectTest, NthElement) {
+  for (size_t n : kSizes) {
+    for (uint16_t max_key : kMaxKeys) {
+      vector<uint16_t> const original = randomKeys(n, max_key, n + 7 * max_key);
+      vector<uint16_t> sorted = original;
+      sort(sorted.begin(), sorted.end());
+      for (size_t nth : ks(n)) {
+        if (nth > n + 1) continue;
+        vector<uint16_t> keys = original;
+        nthElement(keys.data(), n, nth);
+        vector<uint16_t> permuted = keys;
+        sort(permuted.begin(), permuted.end());
+        ASSERT_EQ(sorted, permuted) << n << " " << max_key << " " << nth;
+        if (nth >= n) continue;
+        EXPECT_EQ(sorted[nth], keys[nth]) << n << " " << max_key << " " << nth;
+        for (size_t i = 0; i < nth; ++i) ASSERT_LE(keys[i], keys[nth]);
+        for (size_t i = nth + 1; i < n; ++i) ASSERT_GE(keys[i], keys[nth]);
+      }
+    }
+  }
+}
+
+TEST(SelectTest, PartialSort) {
+  for (size_t n : kSizes) {
+    for (uint16_t max_key : kMaxKeys) {
+      vector<uint16_t> const original = randomKeys(n, max_key, 3 * n + max_key);
+      vector<uint16_t> sorted = original;
+      sort(sorted.begin(), sorted.end());
+      for (size_t k : ks(n)) {
+        if (k > n + 1) continue;
+        vector<uint16_t> keys = original;
+        partialSort(keys.data(), n, k);
+        size_t m = min(k, n);
+        EXPECT_TRUE(equal(sorted.begin(), sorted.begin() + m, keys.begin()))
+          << n << " " << max_key << " " << k;
+        sort(keys.begin() + m, keys.end());
+        ASSERT_EQ(sorted, keys) << n << " " << max_key << " " << k;
+      }
+    }
+  }
+}
+
+// Descending keys replace the heap top with every key.
+TEST(SelectTest, Descending) {
+  vector<uint16_t> keys(70000);
+  for (size_t i = 0; i < keys.size(); ++i) keys[i] = 65535 - i % 65536;
+  vector<uint16_t> sorted = keys;
+  sort(sorted.begin(), sorted.end());
+  vector<uint16_t> out(100);
+  topK(keys.data(), keys.size(), out.size(), out.data());
+  EXPECT_TRUE(equal(out.begin(), out.end(), sorted.begin()));
+  vector<uint32_t> index(1000);
+  topKIndices(keys.data(), keys.size(), index.size(), index.data());
+  for (size_t i = 0; i < index.size(); ++i) ASSERT_EQ(sorted[i], keys[index[i]]);
+  nthElement(keys.data(), keys.size(), 100);
+  EXPECT_EQ(sorted[100], keys[100]);
+}
+
+} // namespace
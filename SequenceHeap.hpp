@@ -0,0 +1,261 @@
+#pragma once
+
+#include "Heap8.hpp"
+#include "KWayMerge.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+// Sequence heap (Sanders, "Fast Priority Queues for Cached Memory") with a
+// Heap8 insertion heap, for priority queues much larger than the cache.
+//
+// Pushes go to a small insertion heap. When it fills up it's sorted into a
+// run in group 0. Group g holds up to group_arity runs and when a run is
+// added to a full group, the group's runs are merged into one run that is
+// added to group g + 1, so runs in group g are about group_arity^g times
+// the insertion heap capacity.
+//
+// Each group has a group buffer with the next smallest values of its runs,
+// refilled from a KWayMerger over the runs, and a small deletion buffer
+// holds the next smallest values of all the groups, refilled from a
+// KWayMerger over the group buffers. pop() takes the smaller of the top of
+// the insertion heap and the head of the deletion buffer. Apart from the
+// insertion heap, which stays in cache, all accesses are sequential scans of
+// runs and buffers.
+//
+// A new run in a group absorbs the group's buffer (and in group 0 also the
+// deletion buffer), so the buffers never hold values larger than the
+// unbuffered values of their runs.
+class SequenceHeap {
+ public:
+  typedef std::uint16_t value_type;
+  typedef std::size_t size_type;
+
+ private:
+  static constexpr size_type kDeletionBufferSize = 256;
+
+  // A sorted sequence read from pos. Runs are shared by pointer between
+  // their group and the group's merger cursors.
+  struct Run {
+    std::vector<value_type> values;
+    size_type pos = 0;
+
+    size_type remaining() const { return values.size() - pos; }
+    value_type const* begin() const { return values.data() + pos; }
+    value_type const* end() const { return values.data() + values.size(); }
+  };
+
+  class RunCursor {
+   public:
+    typedef SequenceHeap::value_type value_type;
+
+    RunCursor() = default;
+    explicit RunCursor(Run* run) : run_(run) { }
+
+    bool empty() const { return run_->pos == run_->values.size(); }
+    std::uint16_t key() const { return run_->values[run_->pos]; }
+    value_type value() const { return run_->values[run_->pos]; }
+    void next() {
+      if (++run_->pos == run_->values.size()) {
+        // Exhausted, release the memory.
+        std::vector<value_type>().swap(run_->values);
+        run_->pos = 0;
+      }
+    }
+    void prefetch() const {
+      constexpr size_type kDistance = 256 / sizeof(value_type);
+      if (run_->pos + kDistance < run_->values.size()) {
+        __builtin_prefetch(run_->values.data() + run_->pos + kDistance);
+      }
+    }
+
+   private:
+    Run* run_;
+  };
+
+  struct Group {
+    std::vector<std::unique_ptr<Run>> runs;
+    Run buffer;
+    KWayMerger<RunCursor> merger;
+
+    // Rebuilds the merger after a change to runs.
+    void reset() {
+      runs.erase(std::remove_if(runs.begin(), runs.end(),
+        [](std::unique_ptr<Run> const& r) { return r->remaining() == 0; }), runs.end());
+      std::vector<RunCursor> cursors;
+      for (std::unique_ptr<Run> const& r : runs) cursors.emplace_back(r.get());
+      merger.reset(cursors.begin(), cursors.end());
+    }
+
+    // Refills the exhausted buffer with up to n values from the runs.
+    void refill(size_type n) {
+      assert(buffer.remaining() == 0);
+      buffer.values.resize(n);
+      buffer.values.resize(merger.next_block(buffer.values.data(), n));
+      buffer.pos = 0;
+    }
+  };
+
+  // KWayMerger cursor over a group's values in order: its buffer, refilled
+  // from its runs whenever it runs out.
+  class GroupCursor {
+   public:
+    typedef SequenceHeap::value_type value_type;
+
+    GroupCursor() = default;
+    GroupCursor(Group* group, size_type buffer_size) : group_(group), buffer_size_(buffer_size) { }
+
+    bool empty() const { return group_->buffer.remaining() == 0; }
+    std::uint16_t key() const { return group_->buffer.values[group_->buffer.pos]; }
+    value_type value() const { return group_->buffer.values[group_->buffer.pos]; }
+    void next() {
+      if (++group_->buffer.pos == group_->buffer.values.size()) group_->refill(buffer_size_);
+    }
+    void prefetch() const { }
+
+   private:
+    Group* group_;
+    size_type buffer_size_;
+  };
+
+  typedef IteratorCursor<value_type const*> ArrayCursor;
+
+ public:
+  // The insertion heap holds up to insertion_capacity values, which is also
+  // the size of the group buffers. Each group holds up to group_arity runs.
+  explicit SequenceHeap(size_type insertion_capacity = 1 << 13, size_type group_arity = 64)
+    : insertion_capacity_(insertion_capacity), group_arity_(group_arity), size_(0) {
+    assert(insertion_capacity > 0);
+    assert(group_arity > 1);
+  }
+  ~SequenceHeap() = default;
+  SequenceHeap(const SequenceHeap&) = delete;
+  SequenceHeap& operator=(const SequenceHeap&) = delete;
+
+  size_type size() const { return size_; }
+
+  // Number of groups, for tests and benchmarks.
+  size_type groups() const { return groups_.size(); }
+
+  void push(value_type b) {
+    if (insertion_.size() == insertion_capacity_) flush_insertion_heap();
+    insertion_.push(b);
+    ++size_;
+  }
+
+  value_type top() {
+    assert(size_ > 0);
+    fill_deletion_buffer();
+    if (deletion_.remaining() == 0) return insertion_.top();
+    value_type d = deletion_.values[deletion_.pos];
+    return insertion_.size() > 0 ? std::min(insertion_.top(), d) : d;
+  }
+
+  value_type pop() {
+    assert(size_ > 0);
+    fill_deletion_buffer();
+    --size_;
+    if (deletion_.remaining() == 0) return insertion_.pop();
+    value_type d = deletion_.values[deletion_.pos];
+    if (insertion_.size() > 0 && insertion_.top() < d) return insertion_.pop();
+    ++deletion_.pos;
+    return d;
+  }
+
+  void clear() {
+    insertion_.clear();
+    deletion_ = Run();
+    groups_.clear();
+    group_merger_.reset(static_cast<GroupCursor*>(nullptr), static_cast<GroupCursor*>(nullptr));
+    size_ = 0;
+  }
+
+ private:
+  // Merges the sequences into one run.
+  static std::unique_ptr<Run> merge(std::vector<ArrayCursor> const& cursors, size_type total) {
+    std::unique_ptr<Run> run(new Run());
+    run->values.resize(total);
+    KWayMerger<ArrayCursor> merger(cursors.begin(), cursors.end());
+    merger.merge(run->values.data());
+    return run;
+  }
+
+  // Sorts the insertion heap into a new run in group 0, together with the
+  // deletion buffer.
+  void flush_insertion_heap() {
+    size_type n = insertion_.size();
+    insertion_.sort();
+    // sort() leaves the values in descending order.
+    std::vector<value_type> sorted(n);
+    for (size_type i = 0; i < n; ++i) sorted[i] = insertion_[n - 1 - i];
+    insertion_.clear();
+    std::vector<ArrayCursor> cursors{
+      ArrayCursor(sorted.data(), sorted.data() + n),
+      ArrayCursor(deletion_.begin(), deletion_.end()),
+    };
+    std::unique_ptr<Run> run = merge(cursors, n + deletion_.remaining());
+    deletion_ = Run();
+    add_run(0, std::move(run));
+  }
+
+  // Adds run to group g, merging the group into group g + 1 first if it's
+  // full. The run absorbs the group buffer.
+  void add_run(size_type g, std::unique_ptr<Run> run) {
+    if (g == groups_.size()) groups_.emplace_back(new Group());
+    if (groups_[g]->runs.size() == group_arity_) spill(g);
+    Group& group = *groups_[g];
+    std::vector<ArrayCursor> cursors{
+      ArrayCursor(run->begin(), run->end()),
+      ArrayCursor(group.buffer.begin(), group.buffer.end()),
+    };
+    group.runs.push_back(merge(cursors, run->remaining() + group.buffer.remaining()));
+    group.buffer = Run();
+    group.reset();
+  }
+
+  // Merges the runs and the buffer of group g into a run in group g + 1.
+  void spill(size_type g) {
+    Group& group = *groups_[g];
+    std::vector<ArrayCursor> cursors;
+    size_type total = group.buffer.remaining();
+    for (std::unique_ptr<Run> const& r : group.runs) {
+      cursors.emplace_back(r->begin(), r->end());
+      total += r->remaining();
+    }
+    cursors.emplace_back(group.buffer.begin(), group.buffer.end());
+    std::unique_ptr<Run> run = merge(cursors, total);
+    group.runs.clear();
+    group.buffer = Run();
+    group.reset();
+    add_run(g + 1, std::move(run));
+  }
+
+  // Refills the deletion buffer if it's empty and the groups aren't.
+  void fill_deletion_buffer() {
+    if (deletion_.remaining() == 0 && size_ > insertion_.size()) refill_deletion_buffer();
+  }
+
+  void refill_deletion_buffer() {
+    std::vector<GroupCursor> cursors;
+    for (std::unique_ptr<Group> const& group : groups_) {
+      if (group->buffer.remaining() == 0) group->refill(insertion_capacity_);
+      cursors.emplace_back(group.get(), insertion_capacity_);
+    }
+    group_merger_.reset(cursors.begin(), cursors.end());
+    deletion_.values.resize(kDeletionBufferSize);
+    deletion_.values.resize(group_merger_.next_block(deletion_.values.data(), kDeletionBufferSize));
+    deletion_.pos = 0;
+  }
+
+  size_type insertion_capacity_;
+  size_type group_arity_;
+  size_type size_;
+  Heap8 insertion_;
+  Run deletion_;
+  std::vector<std::unique_ptr<Group>> groups_;
+  KWayMerger<GroupCursor> group_merger_;
+};
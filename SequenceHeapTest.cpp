@@ -0,0 +1,127 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main SequenceHeapTest.cpp
+   ./a.out
+*/
+
+#include "SequenceHeap.hpp"
+#include "StdMinHeap.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+typedef SequenceHeap::value_type Value;
+
+TEST(SequenceHeapTest, Empty) {
+  SequenceHeap heap;
+  EXPECT_EQ(0, heap.size());
+  EXPECT_EQ(0, heap.groups());
+}
+
+TEST(SequenceHeapTest, Push3) {
+  SequenceHeap heap(2, 2);
+  heap.push(2);
+  EXPECT_EQ(2, heap.top());
+  heap.push(1);
+  EXPECT_EQ(1, heap.top());
+  heap.push(3);
+  EXPECT_EQ(1, heap.top());
+  EXPECT_EQ(3, heap.size());
+  EXPECT_EQ(1, heap.groups());
+  EXPECT_EQ(1, heap.pop());
+  EXPECT_EQ(2, heap.pop());
+  EXPECT_EQ(3, heap.pop());
+  EXPECT_EQ(0, heap.size());
+}
+
+TEST(SequenceHeapTest, Clear) {
+  SequenceHeap heap(4, 2);
+  for (Value i = 0; i < 100; ++i) heap.push(i);
+  EXPECT_EQ(0, heap.pop());
+  heap.clear();
+  EXPECT_EQ(0, heap.size());
+  EXPECT_EQ(0, heap.groups());
+  heap.push(7);
+  EXPECT_EQ(7, heap.pop());
+}
+
+// Pushes all, then pops all.
+TEST(SequenceHeapTest, Sort) {
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<Value> distr(0, 65535);
+  for (size_t n : {0, 1, 100, 10000}) {
+    SequenceHeap heap(16, 3);
+    std::vector<Value> values(n);
+    for (Value& v : values) v = distr(gen);
+    for (Value v : values) heap.push(v);
+    EXPECT_EQ(n, heap.size());
+    std::vector<Value> popped;
+    while (heap.size() > 0) popped.push_back(heap.pop());
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(values, popped);
+  }
+  SequenceHeap heap(16, 3);
+  for (int i = 0; i < 10000; ++i) heap.push(0);
+  EXPECT_LT(2, heap.groups());
+}
+
+TEST(SequenceHeapTest, Descending) {
+  SequenceHeap heap(8, 2);
+  for (Value i = 5000; i > 0; --i) heap.push(i);
+  for (Value i = 1; i <= 5000; ++i) EXPECT_EQ(i, heap.pop());
+}
+
+// Random interleaved pushes and pops, checked against StdMinHeap.
+TEST(SequenceHeapTest, Interleaved) {
+  for (size_t capacity : {1, 8, 100}) {
+    for (size_t arity : {2, 4, 64}) {
+      std::default_random_engine gen(capacity * arity);
+      std::uniform_int_distribution<Value> distr(0, 1000);
+      std::uniform_int_distribution<int> coin(0, 2);
+      SequenceHeap heap(capacity, arity);
+      StdMinHeap<> expected;
+      for (int i = 0; i < 10000; ++i) {
+        if (expected.size() > 0 && coin(gen) == 0) {
+          ASSERT_EQ(expected.top(), heap.top());
+          ASSERT_EQ(expected.pop(), heap.pop());
+        } else {
+          Value v = distr(gen);
+          heap.push(v);
+          expected.push(v);
+        }
+        ASSERT_EQ(expected.size(), heap.size());
+      }
+      while (expected.size() > 0) ASSERT_EQ(expected.pop(), heap.pop());
+    }
+  }
+}
+
+// Pops interleaved with pushes of values larger than the last pop, as in
+// event simulation.
+TEST(SequenceHeapTest, Monotone) {
+  std::default_random_engine gen(1);
+  std::uniform_int_distribution<Value> delta(0, 50);
+  SequenceHeap heap(32, 4);
+  StdMinHeap<> expected;
+  for (int i = 0; i < 200; ++i) {
+    Value v = delta(gen);
+    heap.push(v);
+    expected.push(v);
+  }
+  while (expected.size() > 0) {
+    Value v = heap.pop();
+    ASSERT_EQ(expected.pop(), v);
+    if (v < 10000) {
+      Value w = v + delta(gen);
+      heap.push(w);
+      expected.push(w);
+    }
+  }
+  EXPECT_EQ(0, heap.size());
+}
+
+} // namespace
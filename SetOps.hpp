@@ -0,0 +1,188 @@
+#pragma once
+
+#include "KWayMerge.hpp"
+#include "Heap8Aux.hpp"
+#include "minpos.h"
+#include "v128.h"
+#include "align.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// Multiway set operations on sorted std::uint16_t posting lists.
+//
+// setUnion and setUnionCounts merge the lists with a KWayMerger, by
+// default on a Heap8Aux, and fold each run of equal keys into one key
+// with merge_reduce.
+//
+// setIntersection keeps the heads of the lists 8 to a v128 frontier. Each
+// round takes the candidate as the largest head (a minpos of the
+// complemented frontier per 8 lists), and gallops every list whose head is
+// below the candidate to its first key >= candidate, starting over when a
+// list moves past the candidate. A round without a list below the
+// candidate found a key in all the lists. The shortest lists go first so
+// that their sparse keys drive the candidates, and if the two shortest
+// have similar lengths they're intersected with a linear merge first.
+
+// A sorted list [first, second).
+typedef std::pair<std::uint16_t const*, std::uint16_t const*> PostingList;
+
+// Cursor with a count of 1 per key, for setUnionCounts.
+class PostingCountCursor {
+ public:
+  typedef std::pair<std::uint16_t, std::uint32_t> value_type;
+
+  PostingCountCursor() = default;
+  explicit PostingCountCursor(PostingList list) : cursor_(list.first, list.second) { }
+
+  bool empty() const { return cursor_.empty(); }
+  std::uint16_t key() const { return cursor_.key(); }
+  value_type value() const { return value_type(cursor_.key(), 1); }
+  void next() { cursor_.next(); }
+  void prefetch() const { cursor_.prefetch(); }
+
+ private:
+  IteratorCursor<std::uint16_t const*> cursor_;
+};
+
+// Writes the keys in any of the lists to out, in order, each once.
+template<class Heap = Heap8Aux<std::uint32_t>, class OutputIterator>
+OutputIterator setUnion(std::vector<PostingList> const& lists, OutputIterator out) {
+  typedef IteratorCursor<std::uint16_t const*> Cursor;
+  std::vector<Cursor> cursors;
+  cursors.reserve(lists.size());
+  for (PostingList list : lists) cursors.emplace_back(list.first, list.second);
+  KWayMerger<Cursor, Heap> merger(cursors.begin(), cursors.end());
+  return merger.merge_reduce(out);
+}
+
+// Writes (key, count) pairs to out in key order, for the keys in any of
+// the lists with their number of occurrences in all the lists.
+template<class Heap = Heap8Aux<std::uint32_t>, class OutputIterator>
+OutputIterator setUnionCounts(std::vector<PostingList> const& lists, OutputIterator out) {
+  typedef PostingCountCursor::value_type Count;
+  std::vector<PostingCountCursor> cursors(lists.begin(), lists.end());
+  KWayMerger<PostingCountCursor, Heap> merger(cursors.begin(), cursors.end());
+  auto add = [](Count const& a, Count const& b) { return Count(a.first, a.second + b.second); };
+  return merger.merge_reduce(out, add);
+}
+
+// Returns the first position in [p, end) with a key >= key, searching
+// forward from p in exponentially growing steps.
+inline std::uint16_t const* postingGallop(std::uint16_t const* p, std::uint16_t const* end,
+                                          std::uint16_t key) {
+  std::size_t step = 1;
+  std::uint16_t const* lo = p;
+  while (step < std::size_t(end - lo) && lo[step] < key) {
+    lo += step;
+    step *= 2;
+  }
+  std::uint16_t const* hi = lo + std::min(step + 1, std::size_t(end - lo));
+  return std::lower_bound(lo, hi, key);
+}
+
+// Like postingGallop, but first compares the next 8 keys with key in a
+// v128, which is usually enough when the lists are dense.
+inline std::uint16_t const* postingAdvance(std::uint16_t const* p, std::uint16_t const* end,
+                                           std::uint16_t key) {
+  if (end - p >= 8) {
+    v128 keys, below;
+    keys.mm = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    below.values = (u16x8) (keys.values < (u16x8{0, 0, 0, 0, 0, 0, 0, 0} + key));
+    // The keys below key are a prefix, 2 mask bits each.
+    unsigned mask = _mm_movemask_epi8(below.mm);
+    if (mask != 0xffff) return p + __builtin_popcount(mask) / 2;
+    p += 8;
+  }
+  return postingGallop(p, end, key);
+}
+
+// The largest key in v.
+inline std::uint16_t postingMaxLane(v128 v) {
+  v128 complement;
+  complement.values = ~v.values;
+  return 0xffff - minpos_min(minpos(complement.mm));
+}
+
+// Writes the keys in all the lists to out, in order. The lists must be
+// strictly increasing. The intersection of no lists is empty.
+template<class OutputIterator>
+OutputIterator setIntersection(std::vector<PostingList> lists, OutputIterator out) {
+  constexpr std::size_t kArity = 8;
+  constexpr std::ptrdiff_t kMergeRatio = 16;
+  std::size_t k = lists.size();
+  if (k == 0) return out;
+  std::sort(lists.begin(), lists.end(), [](PostingList const& a, PostingList const& b) {
+    return a.second - a.first < b.second - b.first;
+  });
+  if (k == 1) return std::copy(lists[0].first, lists[0].second, out);
+  // A linear merge beats galloping when the two shortest lists have similar
+  // lengths, and its result drives the candidates for the other lists.
+  std::vector<std::uint16_t> first;
+  if (lists[1].second - lists[1].first < kMergeRatio * (lists[0].second - lists[0].first)) {
+    first.reserve(lists[0].second - lists[0].first);
+    std::set_intersection(lists[0].first, lists[0].second, lists[1].first, lists[1].second,
+                          std::back_inserter(first));
+    lists.erase(lists.begin());
+    lists[0] = PostingList(first.data(), first.data() + first.size());
+    if (--k == 1) return std::copy(first.begin(), first.end(), out);
+  }
+
+  // heads[i / 8] lane i % 8 is the key at lists[i].first, padding lanes
+  // are 0 so they never win the maximum and real masks them otherwise.
+  std::size_t chunks = align_up(k, kArity) / kArity;
+  std::vector<v128> heads(chunks);
+  std::vector<unsigned> real(chunks, 0xff);
+  for (std::size_t c = 0; c < chunks; ++c) {
+    heads[c].values = u16x8{0, 0, 0, 0, 0, 0, 0, 0};
+    if (c == chunks - 1 && k % kArity) real[c] = (1u << (k % kArity)) - 1;
+  }
+  // Returns the largest head.
+  auto maxHead = [&]() {
+    std::uint16_t m = 0;
+    for (v128 const& h : heads) m = std::max(m, postingMaxLane(h));
+    return m;
+  };
+
+  for (std::size_t i = 0; i < k; ++i) {
+    if (lists[i].first == lists[i].second) return out;
+    heads[i / kArity].values[i % kArity] = *lists[i].first;
+  }
+  // Invariant: candidate is the largest head. It's in the intersection if
+  // no head is below it.
+  std::uint16_t candidate = maxHead();
+  for (;;) {
+    bool found = true;
+    for (std::size_t c = 0; c < chunks && found; ++c) {
+      v128 below;
+      below.values = (u16x8) (heads[c].values < (u16x8{0, 0, 0, 0, 0, 0, 0, 0} + candidate));
+      unsigned mask = _mm_movemask_epi8(_mm_packs_epi16(below.mm, _mm_setzero_si128())) & real[c];
+      for (; mask != 0; mask &= mask - 1) {
+        std::size_t i = c * kArity + __builtin_ctz(mask);
+        PostingList& list = lists[i];
+        list.first = postingAdvance(list.first, list.second, candidate);
+        if (list.first == list.second) return out;
+        std::uint16_t head = *list.first;
+        heads[c].values[i % kArity] = head;
+        if (head > candidate) {
+          // Start over with the new candidate from the shortest lists.
+          candidate = head;
+          found = false;
+          break;
+        }
+      }
+    }
+    if (!found) continue;
+    *out++ = candidate;
+    for (std::size_t i = 0; i < k; ++i) {
+      PostingList& list = lists[i];
+      if (++list.first == list.second) return out;
+      heads[i / kArity].values[i % kArity] = *list.first;
+    }
+    candidate = maxHead();
+  }
+}
@@ -0,0 +1,127 @@
+/*
+   brew install google-benchmark
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -lbenchmark -lbenchmark_main SetOpsBenchmark.cpp
+   ./a.out
+*/
+
+#include "SetOps.hpp"
+#include "StdMinHeapMap.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <utility>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+typedef std::uint16_t Key;
+typedef std::vector<std::vector<Key>> Table;
+
+// A strictly increasing list of about size random keys.
+std::vector<Key> randomPostingList(int seed, size_t size) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<Key> distr(0, 65535);
+  std::vector<Key> v(size);
+  for (Key& k : v) k = distr(gen);
+  std::sort(v.begin(), v.end());
+  v.erase(std::unique(v.begin(), v.end()), v.end());
+  return v;
+}
+
+// count lists of size keys, the first short_size keys if short_size > 0.
+Table randomTable(size_t count, size_t size, size_t short_size) {
+  Table table;
+  for (size_t i = 0; i < count; ++i) {
+    table.push_back(randomPostingList(i, i == 0 && short_size > 0 ? short_size : size));
+  }
+  return table;
+}
+
+std::vector<PostingList> postingLists(Table const& table) {
+  std::vector<PostingList> lists;
+  for (auto const& list : table) lists.emplace_back(list.data(), list.data() + list.size());
+  return lists;
+}
+
+size_t totalSize(Table const& table) {
+  size_t n = 0;
+  for (auto const& list : table) n += list.size();
+  return n;
+}
+
+template<class HeapMap>
+void bm_union_counts(benchmark::State& state) {
+  Table table = randomTable(state.range(0), state.range(1), 0);
+  std::vector<PostingList> lists = postingLists(table);
+  std::vector<std::pair<Key, std::uint32_t>> out;
+  out.reserve(totalSize(table));
+  for (auto _ : state) {
+    out.clear();
+    setUnionCounts<HeapMap>(lists, std::back_inserter(out));
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * totalSize(table));
+}
+
+void bm_intersection(benchmark::State& state) {
+  Table table = randomTable(state.range(0), state.range(1), state.range(2));
+  std::vector<PostingList> lists = postingLists(table);
+  std::vector<Key> out;
+  out.reserve(65536);
+  for (auto _ : state) {
+    out.clear();
+    setIntersection(lists, std::back_inserter(out));
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.counters["result"] = out.size();
+  state.SetItemsProcessed(state.iterations() * totalSize(table));
+}
+
+// Pairwise std::set_intersection, shortest lists first.
+void bm_set_intersection_chain(benchmark::State& state) {
+  Table table = randomTable(state.range(0), state.range(1), state.range(2));
+  std::sort(table.begin(), table.end(),
+    [](std::vector<Key> const& a, std::vector<Key> const& b) { return a.size() < b.size(); });
+  std::vector<Key> result, next;
+  result.reserve(65536);
+  next.reserve(65536);
+  for (auto _ : state) {
+    result = table[0];
+    for (size_t i = 1; i < table.size() && !result.empty(); ++i) {
+      next.clear();
+      std::set_intersection(result.begin(), result.end(), table[i].begin(), table[i].end(),
+                            std::back_inserter(next));
+      result.swap(next);
+    }
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.counters["result"] = result.size();
+  state.SetItemsProcessed(state.iterations() * totalSize(table));
+}
+
+typedef Heap8Aux<std::uint32_t> Aux;
+typedef StdMinHeapMap<std::uint32_t> Std;
+
+void UnionArguments(benchmark::internal::Benchmark* b) {
+  for (int64_t c : {8, 64, 512})
+    for (int64_t s : {1000, 30000})
+      b->Args({c, s});
+}
+
+// {count, size, size of the first list or 0 if the same}
+void IntersectionArguments(benchmark::internal::Benchmark* b) {
+  for (int64_t c : {2, 8, 32}) {
+    b->Args({c, 30000, 0});   // dense lists, large result
+    b->Args({c, 5000, 0});    // sparse lists, small result
+    b->Args({c, 30000, 100}); // one short list
+  }
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(bm_union_counts, Aux)->Apply(UnionArguments);
+BENCHMARK_TEMPLATE(bm_union_counts, Std)->Apply(UnionArguments);
+BENCHMARK(bm_intersection)->Apply(IntersectionArguments);
+BENCHMARK(bm_set_intersection_chain)->Apply(IntersectionArguments);
@@ -0,0 +1,151 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main SetOpsTest.cpp
+   ./a.out
+*/
+
+#include "SetOps.hpp"
+#include "StdMinHeapMap.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+typedef std::uint16_t Key;
+typedef std::vector<std::vector<Key>> Table;
+
+// count strictly increasing lists of up to max_size keys in [0, max_key].
+Table randomTable(int seed, size_t count, size_t max_size, Key max_key) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<size_t> sizes(0, max_size);
+  std::uniform_int_distribution<Key> keys(0, max_key);
+  Table table(count);
+  for (auto& list : table) {
+    std::set<Key> s;
+    for (size_t n = sizes(gen); n > 0; --n) s.insert(keys(gen));
+    list.assign(s.begin(), s.end());
+  }
+  return table;
+}
+
+std::vector<PostingList> postingLists(Table const& table) {
+  std::vector<PostingList> lists;
+  for (auto const& list : table) lists.emplace_back(list.data(), list.data() + list.size());
+  return lists;
+}
+
+std::vector<Key> intersection(Table const& table) {
+  if (table.empty()) return {};
+  std::vector<Key> result = table[0];
+  for (size_t i = 1; i < table.size(); ++i) {
+    std::vector<Key> next;
+    std::set_intersection(result.begin(), result.end(), table[i].begin(), table[i].end(),
+                          std::back_inserter(next));
+    result.swap(next);
+  }
+  return result;
+}
+
+std::vector<std::pair<Key, std::uint32_t>> unionCounts(Table const& table) {
+  std::map<Key, std::uint32_t> counts;
+  for (auto const& list : table) {
+    for (Key k : list) ++counts[k];
+  }
+  return {counts.begin(), counts.end()};
+}
+
+std::vector<Key> intersect(Table const& table) {
+  std::vector<Key> out;
+  setIntersection(postingLists(table), std::back_inserter(out));
+  return out;
+}
+
+TEST(SetOpsTest, NoLists) {
+  Table table;
+  std::vector<Key> out;
+  setUnion(postingLists(table), std::back_inserter(out));
+  EXPECT_TRUE(out.empty());
+  EXPECT_TRUE(intersect(table).empty());
+}
+
+TEST(SetOpsTest, Small) {
+  Table table{{1, 3, 5, 7, 65535}, {0, 3, 7, 9, 65535}, {3, 4, 7, 65535}};
+  EXPECT_EQ(std::vector<Key>({3, 7, 65535}), intersect(table));
+  std::vector<Key> u;
+  setUnion(postingLists(table), std::back_inserter(u));
+  EXPECT_EQ(std::vector<Key>({0, 1, 3, 4, 5, 7, 9, 65535}), u);
+  std::vector<std::pair<Key, std::uint32_t>> counts;
+  setUnionCounts(postingLists(table), std::back_inserter(counts));
+  EXPECT_EQ(unionCounts(table), counts);
+}
+
+TEST(SetOpsTest, OneList) {
+  Table table{{2, 4, 6}};
+  EXPECT_EQ(table[0], intersect(table));
+}
+
+TEST(SetOpsTest, EmptyList) {
+  Table table{{2, 4, 6}, {}, {4}};
+  EXPECT_TRUE(intersect(table).empty());
+}
+
+TEST(SetOpsTest, Gallop) {
+  std::vector<Key> v;
+  for (Key k = 0; k < 1000; k += 3) v.push_back(k);
+  for (size_t start : {0, 1, 100, 333}) {
+    for (Key key : {0, 1, 2, 3, 4, 500, 997, 998, 999, 1000, 65535}) {
+      Key const* p = v.data() + start;
+      Key const* end = v.data() + v.size();
+      if (p < end && *p >= key) continue; // precondition *p < key
+      EXPECT_EQ(std::lower_bound(p, end, key), postingGallop(p, end, key)) << start << " " << key;
+    }
+  }
+}
+
+TEST(SetOpsTest, RandomIntersection) {
+  for (size_t count : {2, 3, 7, 8, 9, 16, 17, 40}) {
+    for (Key max_key : {20, 1000, 65535}) {
+      Table table = randomTable(count * max_key, count, 5000, max_key);
+      EXPECT_EQ(intersection(table), intersect(table)) << count << " " << max_key;
+    }
+  }
+}
+
+// A small list that every other list contains.
+TEST(SetOpsTest, Contained) {
+  Table table = randomTable(1, 12, 20000, 65535);
+  std::vector<Key> small{5, 500, 5000, 50000};
+  for (auto& list : table) {
+    std::set<Key> s(list.begin(), list.end());
+    s.insert(small.begin(), small.end());
+    list.assign(s.begin(), s.end());
+  }
+  table.push_back(small);
+  EXPECT_EQ(small, intersect(table));
+}
+
+TEST(SetOpsTest, RandomUnion) {
+  for (size_t count : {1, 9, 100}) {
+    Table table = randomTable(count, count, 300, 1000);
+    std::vector<std::pair<Key, std::uint32_t>> counts;
+    setUnionCounts(postingLists(table), std::back_inserter(counts));
+    EXPECT_EQ(unionCounts(table), counts);
+    std::vector<std::pair<Key, std::uint32_t>> std_counts;
+    setUnionCounts<StdMinHeapMap<std::uint32_t>>(postingLists(table), std::back_inserter(std_counts));
+    EXPECT_EQ(counts, std_counts);
+    std::vector<Key> keys;
+    setUnion(postingLists(table), std::back_inserter(keys));
+    std::vector<Key> expected;
+    for (auto const& e : counts) expected.push_back(e.first);
+    EXPECT_EQ(expected, keys);
+  }
+}
+
+} // namespace
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Stores values in fixed size slabs and hands out 32 bit handles to them.
+// Values never move once constructed, so a heap can sift the handles and
+// leave the values in place. Handles of erased values are reused.
+template<class T, std::size_t SlabBits = 10> class SlabArena {
+ public:
+  typedef T value_type;
+  typedef std::uint32_t handle_type;
+  typedef std::size_t size_type;
+
+ private:
+  static constexpr size_type kSlabSize = size_type(1) << SlabBits;
+  static constexpr size_type kHandleMax = std::numeric_limits<handle_type>::max();
+
+  struct slot {
+    alignas(T) unsigned char bytes[sizeof(T)];
+  };
+
+ public:
+  SlabArena() : handed_out_(0) { }
+  ~SlabArena() { clear(); }
+  SlabArena(const SlabArena&) = delete;
+  SlabArena& operator=(const SlabArena&) = delete;
+
+  // Number of live values.
+  size_type size() const { return handed_out_ - free_.size(); }
+
+  T& operator[](handle_type h) { return *ptr(h); }
+  T const& operator[](handle_type h) const { return *ptr(h); }
+
+  template<class... Args>
+  handle_type emplace(Args&&... args) {
+    handle_type h;
+    if (!free_.empty()) {
+      h = free_.back();
+      ::new (static_cast<void*>(ptr(h))) T(std::forward<Args>(args)...);
+      free_.pop_back();
+    } else {
+      if (handed_out_ == kHandleMax) throw_bad_alloc();
+      h = handle_type(handed_out_);
+      if (h % kSlabSize == 0) slabs_.emplace_back(new slot[kSlabSize]);
+      ::new (static_cast<void*>(ptr(h))) T(std::forward<Args>(args)...);
+      ++handed_out_;
+    }
+    return h;
+  }
+
+  void erase(handle_type h) {
+    assert(h < handed_out_);
+    ptr(h)->~T();
+    free_.push_back(h);
+  }
+
+  // Destroys all values and frees the slabs.
+  void clear() {
+    if (!std::is_trivially_destructible<T>::value) {
+      std::vector<bool> is_free(handed_out_);
+      for (handle_type h : free_) is_free[h] = true;
+      for (size_type h = 0; h < handed_out_; ++h) {
+        if (!is_free[h]) ptr(handle_type(h))->~T();
+      }
+    }
+    slabs_.clear();
+    slabs_.shrink_to_fit();
+    free_.clear();
+    free_.shrink_to_fit();
+    handed_out_ = 0;
+  }
+
+ private:
+  [[noreturn]] static void throw_bad_alloc() {
+    std::bad_alloc exception;
+    throw exception;
+  }
+
+  T* ptr(handle_type h) {
+    return reinterpret_cast<T*>(slabs_[h >> SlabBits][h % kSlabSize].bytes);
+  }
+  T const* ptr(handle_type h) const {
+    return reinterpret_cast<T const*>(slabs_[h >> SlabBits][h % kSlabSize].bytes);
+  }
+
+  std::vector<std::unique_ptr<slot[]>> slabs_;
+  std::vector<handle_type> free_; // erased handles, reused first
+  size_type handed_out_; // handles [0, handed_out_) have been used
+};
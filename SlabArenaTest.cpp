@@ -0,0 +1,71 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -lgtest -lgtest_main SlabArenaTest.cpp
+   ./a.out
+*/
+
+#include "SlabArena.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(SlabArenaTest, EmplaceErase) {
+  SlabArena<std::string> arena;
+  EXPECT_EQ(0, arena.size());
+  auto a = arena.emplace("a");
+  auto b = arena.emplace(3, 'b');
+  EXPECT_EQ(2, arena.size());
+  EXPECT_EQ("a", arena[a]);
+  EXPECT_EQ("bbb", arena[b]);
+  arena.erase(a);
+  EXPECT_EQ(1, arena.size());
+  auto c = arena.emplace("c");
+  EXPECT_EQ(a, c); // reused
+  EXPECT_EQ("c", arena[c]);
+  EXPECT_EQ("bbb", arena[b]);
+}
+
+TEST(SlabArenaTest, StableAcrossSlabs) {
+  SlabArena<uint64_t, 2> arena; // 4 values per slab
+  std::vector<uint32_t> handles;
+  std::vector<uint64_t const*> ptrs;
+  for (uint64_t i = 0; i < 100; ++i) {
+    handles.push_back(arena.emplace(i));
+    ptrs.push_back(&arena[handles.back()]);
+  }
+  for (uint64_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(ptrs[i], &arena[handles[i]]);
+    EXPECT_EQ(i, arena[handles[i]]);
+  }
+  arena.clear();
+  EXPECT_EQ(0, arena.size());
+}
+
+struct Counted {
+  static int live;
+  Counted() { ++live; }
+  ~Counted() { --live; }
+};
+
+int Counted::live = 0;
+
+TEST(SlabArenaTest, ClearDestroysLiveValues) {
+  {
+    SlabArena<Counted, 2> arena;
+    std::vector<uint32_t> handles;
+    for (int i = 0; i < 10; ++i) handles.push_back(arena.emplace());
+    arena.erase(handles[3]);
+    arena.erase(handles[7]);
+    EXPECT_EQ(8, Counted::live);
+    arena.clear();
+    EXPECT_EQ(0, Counted::live);
+    for (int i = 0; i < 5; ++i) arena.emplace();
+    EXPECT_EQ(5, Counted::live);
+  }
+  EXPECT_EQ(0, Counted::live);
+}
+
+} // namespace
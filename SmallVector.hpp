@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Vector with room for N elements inside the object itself. It allocates
+// on the heap only when it grows beyond N elements and moves back inside
+// on shrink_to_fit when the elements fit again.
+//
+// Supports the subset of the std::vector interface used by Heap8Aux.
+template<class T, std::size_t N> class SmallVector {
+  static_assert(N > 0, "use std::vector for no inline elements");
+
+ public:
+  typedef T value_type;
+  typedef std::size_t size_type;
+  typedef T& reference;
+  typedef T const& const_reference;
+  typedef T* iterator;
+  typedef T const* const_iterator;
+
+  SmallVector() : data_(inline_data()), size_(0), capacity_(N) { }
+  ~SmallVector() {
+    clear();
+    deallocate();
+  }
+  SmallVector(const SmallVector&) = delete;
+  SmallVector& operator=(const SmallVector&) = delete;
+
+  size_type size() const { return size_; }
+  size_type capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  T* data() { return data_; }
+  T const* data() const { return data_; }
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+  T& operator[](size_type index) { return data_[index]; }
+  T const& operator[](size_type index) const { return data_[index]; }
+  T& back() { assert(size_ > 0); return data_[size_ - 1]; }
+  T const& back() const { assert(size_ > 0); return data_[size_ - 1]; }
+
+  // True if the elements are stored inside the object.
+  bool is_inline() const { return data_ == inline_data(); }
+
+  // Bytes allocated on the heap, zero while the elements are inline.
+  size_type allocated_bytes() const {
+    return is_inline() ? 0 : capacity_ * sizeof(T);
+  }
+
+  void reserve(size_type n) {
+    if (n > capacity_) relocate(n);
+  }
+
+  template<class... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == capacity_) relocate(std::max(2 * capacity_, size_ + 1));
+    T* ptr = ::new (static_cast<void*>(data_ + size_)) T(std::forward<Args>(args)...);
+    ++size_;
+    return *ptr;
+  }
+
+  void push_back(T const& t) { emplace_back(t); }
+  void push_back(T&& t) { emplace_back(std::move(t)); }
+
+  void pop_back() {
+    assert(size_ > 0);
+    --size_;
+    data_[size_].~T();
+  }
+
+  void resize(size_type n) {
+    reserve(n);
+    while (size_ < n) emplace_back();
+    while (size_ > n) pop_back();
+  }
+
+  void resize(size_type n, T const& t) {
+    reserve(n);
+    while (size_ < n) emplace_back(t);
+    while (size_ > n) pop_back();
+  }
+
+  void clear() {
+    while (size_ > 0) pop_back();
+  }
+
+  void shrink_to_fit() {
+    if (!is_inline() && size_ < capacity_) relocate(size_);
+  }
+
+ private:
+  T* inline_data() { return reinterpret_cast<T*>(inline_); }
+  T const* inline_data() const { return reinterpret_cast<T const*>(inline_); }
+
+  // Moves the elements to inline storage if n <= N, otherwise to a new heap
+  // block with capacity n. Precondition: n >= size_.
+  void relocate(size_type n) {
+    assert(n >= size_);
+    T* new_data = n <= N ? inline_data() : allocate(n);
+    if (new_data == data_) return;
+    std::uninitialized_move(data_, data_ + size_, new_data);
+    std::destroy(data_, data_ + size_);
+    deallocate();
+    data_ = new_data;
+    capacity_ = n <= N ? N : n;
+  }
+
+  static T* allocate(size_type n) {
+    if (n > std::numeric_limits<size_type>::max() / sizeof(T)) throw std::bad_alloc();
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  void deallocate() {
+    if (!is_inline()) ::operator delete(data_, std::align_val_t(alignof(T)));
+  }
+
+  alignas(T) unsigned char inline_[N * sizeof(T)];
+  T* data_;
+  size_type size_;
+  size_type capacity_;
+};
@@ -0,0 +1,59 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main SmallVectorTest.cpp
+   ./a.out
+*/
+
+#include "SmallVector.hpp"
+#include "v128.h"
+#include <cstdint>
+#include <memory>
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(SmallVector, inline) {
+  SmallVector<int, 4> v;
+  EXPECT_TRUE(v.is_inline());
+  EXPECT_EQ(4, v.capacity());
+  for (int i = 0; i < 4; ++i) v.push_back(i);
+  EXPECT_TRUE(v.is_inline());
+  EXPECT_EQ(0, v.allocated_bytes());
+  EXPECT_EQ(4, v.size());
+  EXPECT_EQ(3, v.back());
+}
+
+TEST(SmallVector, spill_and_shrink) {
+  SmallVector<int, 4> v;
+  for (int i = 0; i < 100; ++i) v.push_back(i);
+  EXPECT_FALSE(v.is_inline());
+  EXPECT_EQ(v.capacity() * sizeof(int), v.allocated_bytes());
+  for (int i = 0; i < 100; ++i) EXPECT_EQ(i, v[i]);
+  v.resize(3);
+  v.shrink_to_fit();
+  EXPECT_TRUE(v.is_inline());
+  EXPECT_EQ(0, v[0]);
+  EXPECT_EQ(2, v[2]);
+  v.clear();
+  EXPECT_EQ(0, v.size());
+}
+
+TEST(SmallVector, aligned) {
+  SmallVector<v128, 1> v;
+  v.resize(3, kV128Max);
+  EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(v.data()) % alignof(v128));
+  EXPECT_EQ(kV128Max, v[2]);
+}
+
+TEST(SmallVector, move_only) {
+  SmallVector<std::unique_ptr<int>, 2> v;
+  for (int i = 0; i < 5; ++i) v.push_back(std::make_unique<int>(i));
+  EXPECT_EQ(4, *v.back());
+  v.pop_back();
+  v.resize(2);
+  v.shrink_to_fit();
+  EXPECT_TRUE(v.is_inline());
+  EXPECT_EQ(1, *v[1]);
+}
+
+} // namespace
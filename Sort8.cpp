@@ -1,13 +1,25 @@
 /*
-   Branch free sorting of 8 uint16 numbers with _mm_minpos_epu16.
+   Branch free sorting of 8 uint16 numbers, with minpos (_mm_minpos_epu16 or
+   SWAR, see minpos.h) or with a bitonic sorting network, and bitonic merges
+   of sorted vectors on top of the network.
 */
 
+#include "Sort8.hpp"
 #include "minpos.h"
 #include "v128.h"
 #include <cstddef> // size_t
 #include <cstdint> // uint16_t
+#include <cstring> // memcpy
+#include <algorithm>
 #include <limits>
+#include <utility> // index_sequence
+#include <vector>
 #include <emmintrin.h> // __m128i
+#if defined(__SSE4_1__)
+#include <smmintrin.h> // _mm_min_epu16, _mm_max_epu16, _mm_blend_epi16
+#elif defined(__SSSE3__)
+#include <tmmintrin.h> // _mm_shuffle_epi8
+#endif
 
 using namespace std;
 
@@ -29,11 +41,204 @@ constexpr v128 kMasks[8] = {
   { { 0, 0, 0, 0, 0, 0, 0, kMax } },
 };
 
+// Blocks sorted together by sort8_blocks.
+constexpr size_t kInterleave = 4;
+
+// Lane i swapped with lane i ^ kDistance.
+template<int kDistance>
+inline __m128i partner(__m128i v) {
+  if constexpr (kDistance == 1) {
+#if defined(__SSSE3__)
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+#else
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+#endif
+  } else if constexpr (kDistance == 2) {
+    return _mm_shuffle_epi32(v, 0xb1);
+  } else {
+    static_assert(kDistance == 4);
+    return _mm_shuffle_epi32(v, 0x4e);
+  }
+}
+
+// Lane-wise unsigned minimum and maximum.
+inline void minmax(__m128i a, __m128i b, __m128i& lo, __m128i& hi) {
+#if defined(__SSE4_1__)
+  lo = _mm_min_epu16(a, b);
+  hi = _mm_max_epu16(a, b);
+#else
+  // SSE2 only has signed 16 bit min and max, but with d = a -sat b,
+  // min(a, b) = a - d and max(a, b) = b + d.
+  __m128i d = _mm_subs_epu16(a, b);
+  lo = _mm_sub_epi16(a, d);
+  hi = _mm_add_epi16(b, d);
+#endif
+}
+
+// Lanes i with bit i of kLoLanes set from lo, the others from hi.
+template<int kLoLanes>
+inline __m128i select(__m128i lo, __m128i hi) {
+#if defined(__SSE4_1__)
+  return _mm_blend_epi16(hi, lo, kLoLanes);
+#else
+  auto lane = [](int i) -> short { return (kLoLanes >> i) & 1 ? -1 : 0; };
+  __m128i mask = _mm_setr_epi16(lane(0), lane(1), lane(2), lane(3),
+                                lane(4), lane(5), lane(6), lane(7));
+  return _mm_or_si128(_mm_and_si128(mask, lo), _mm_andnot_si128(mask, hi));
+#endif
+}
+
+// The lanes that keep the minimum of a compare-exchange at distance j in
+// the bitonic merge of runs of length k: the lower lane of each pair in an
+// ascending run and the upper lane in a descending run.
+constexpr int loLanes(int k, int j) {
+  int lanes = 0;
+  for (int i = 0; i < int(kArity); ++i) {
+    if (((i & j) == 0) == ((i & k) == 0)) lanes |= 1 << i;
+  }
+  return lanes;
+}
+
+template<int k, int j>
+inline __m128i layer(__m128i v) {
+  __m128i lo, hi;
+  minmax(v, partner<j>(v), lo, hi);
+  return select<loLanes(k, j)>(lo, hi);
+}
+
+// The layer on each of v[I...], unrolled with a fold so the vectors stay
+// in registers.
+template<int k, int j, size_t... I>
+inline void layers(__m128i* v, index_sequence<I...>) {
+  ((v[I] = layer<k, j>(v[I])), ...);
+}
+
+// Sorts each of v[0, kCount) with the bitonic network, layer by layer so
+// the independent vectors overlap in the pipeline.
+template<size_t kCount>
+inline void network(__m128i* v) {
+  make_index_sequence<kCount> each;
+  layers<2, 1>(v, each);
+  layers<4, 2>(v, each);
+  layers<4, 1>(v, each);
+  layers<8, 4>(v, each);
+  layers<8, 2>(v, each);
+  layers<8, 1>(v, each);
+}
+
+// Lanes in reverse order.
+inline __m128i reverse(__m128i v) {
+#if defined(__SSSE3__)
+  return _mm_shuffle_epi8(v, _mm_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1));
+#else
+  v = _mm_shuffle_epi32(v, 0x1b);
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+#endif
+}
+
+// Compare-exchange of v[i] and v[i + d] if i is the lower of the pair.
+template<size_t d, size_t i>
+inline void exchange(__m128i* v) {
+  if constexpr ((i & d) == 0) minmax(v[i], v[i + d], v[i], v[i + d]);
+}
+
+template<size_t d, size_t... I>
+inline void exchanges(__m128i* v, index_sequence<I...>) {
+  (exchange<d, I>(v), ...);
+}
+
+// Sorts the bitonic sequence v[0, kCount) of kCount * 8 values: the
+// vectors at distance kDistance, then half the distance, and so on, and
+// last the lanes within each vector.
+template<size_t kCount, size_t kDistance = kCount / 2>
+inline void bitonicMerge(__m128i* v) {
+  if constexpr (kDistance > 0) {
+    exchanges<kDistance>(v, make_index_sequence<kCount>());
+    bitonicMerge<kCount, kDistance / 2>(v);
+  } else {
+    make_index_sequence<kCount> each;
+    layers<8, 4>(v, each);
+    layers<8, 2>(v, each);
+    layers<8, 1>(v, each);
+  }
+}
+
+// Reverses the second half of v[0, kCount) as a sequence of values.
+template<size_t kCount, size_t... I>
+inline void reverseHalf(__m128i* v, index_sequence<I...>) {
+  constexpr size_t kHalf = kCount / 2;
+  __m128i r[kHalf] = {reverse(v[kCount - 1 - I])...};
+  ((v[kHalf + I] = r[I]), ...);
+}
+
+// Merges the sorted halves of v[0, kCount) into one sorted sequence. With
+// the second half reversed the whole is bitonic, and one exchange between
+// the halves splits it into two bitonic halves, the lower 8 * kCount / 2
+// values in the first.
+template<size_t kCount>
+inline void mergeHalves(__m128i* v) {
+  constexpr size_t kHalf = kCount / 2;
+  reverseHalf<kCount>(v, make_index_sequence<kHalf>());
+  exchanges<kHalf>(v, make_index_sequence<kCount>());
+  bitonicMerge<kHalf>(v);
+  bitonicMerge<kHalf>(v + kHalf);
+}
+
+template<size_t kRun, size_t... G>
+inline void mergeRuns(__m128i* v, index_sequence<G...>) {
+  (mergeHalves<kRun>(v + G * kRun), ...);
+}
+
+// Sorts the 8 * kCount values of v[0, kCount), in ascending order across
+// the vectors: each vector with the network, then runs of 1, 2, 4, ...
+// vectors merged pairwise.
+template<size_t kCount, size_t kRun = 2>
+inline void sortVectors(__m128i* v) {
+  if constexpr (kRun == 2) network<kCount>(v);
+  if constexpr (kRun <= kCount) {
+    mergeRuns<kRun>(v, make_index_sequence<kCount / kRun>());
+    sortVectors<kCount, kRun * 2>(v);
+  }
+}
+
+inline uint32_t head(__m128i const* v) {
+  return _mm_extract_epi16(*v, 0);
+}
+
+// Merges the sorted runs [a, a_end) and [b, b_end) of vectors into out,
+// keeping the 8 largest values so far in a register: each step merges the
+// next vector of the run with the smaller head into them and writes out the
+// lower 8.
+inline void mergeVectorRuns(__m128i const* a, __m128i const* a_end,
+                            __m128i const* b, __m128i const* b_end, __m128i* out) {
+  // Heads past the end of a run compare above all keys.
+  constexpr uint32_t kEnd = uint32_t(kMax) + 1;
+  __m128i v[2];
+  size_t steps = (a_end - a) + (b_end - b) - 1;
+  v[0] = *a++;
+  for (size_t i = 0; i < steps; ++i) {
+    uint32_t head_a = a < a_end ? head(a) : kEnd;
+    uint32_t head_b = b < b_end ? head(b) : kEnd;
+    bool take_a = head_a <= head_b;
+    v[1] = take_a ? *a : *b;
+    a += take_a;
+    b += !take_a;
+    mergeHalves<2>(v);
+    *out++ = v[0];
+    v[0] = v[1];
+  }
+  *out = v[0];
+}
+
 } // namespace
 
 __m128i sort8(__m128i mm) {
+  return sort8_network(mm);
+}
+
+__m128i sort8_minpos(__m128i mm) {
   v128 r;
-  for (int i = 0; i < kArity; ++i) {
+  for (size_t i = 0; i < kArity; ++i) {
     minpos_type x = minpos(mm);
     uint16_t m = minpos_min(x);
     r.values[i] = m;
@@ -41,3 +246,99 @@ __m128i sort8(__m128i mm) {
   }
   return r.mm;
 }
+
+__m128i sort8_network(__m128i mm) {
+  __m128i v[1] = {mm};
+  network<1>(v);
+  return v[0];
+}
+
+void sort8_blocks(uint16_t* values, size_t n) {
+  size_t i = 0;
+  for (; i + kInterleave * kArity <= n; i += kInterleave * kArity) {
+    __m128i* p = reinterpret_cast<__m128i*>(values + i);
+    __m128i v[kInterleave];
+    for (size_t j = 0; j < kInterleave; ++j) v[j] = _mm_loadu_si128(p + j);
+    network<kInterleave>(v);
+    for (size_t j = 0; j < kInterleave; ++j) _mm_storeu_si128(p + j, v[j]);
+  }
+  for (; i + kArity <= n; i += kArity) {
+    __m128i* p = reinterpret_cast<__m128i*>(values + i);
+    _mm_storeu_si128(p, sort8_network(_mm_loadu_si128(p)));
+  }
+  if (i < n) {
+    // Pad the short last block with maximums, which sort to its end.
+    v128 v = kV128Max;
+    memcpy(&v, values + i, (n - i) * sizeof(uint16_t));
+    v.mm = sort8_network(v.mm);
+    memcpy(values + i, &v, (n - i) * sizeof(uint16_t));
+  }
+}
+
+void merge16(__m128i& a, __m128i& b) {
+  __m128i v[2] = {a, b};
+  mergeHalves<2>(v);
+  a = v[0];
+  b = v[1];
+}
+
+void sort16(__m128i* v) {
+  sortVectors<2>(v);
+}
+
+void sort32(__m128i* v) {
+  sortVectors<4>(v);
+}
+
+void sort64(__m128i* v) {
+  sortVectors<8>(v);
+}
+
+void sort8_mergesort(uint16_t* values, size_t n) {
+  // Sorted in blocks of kBlock vectors in registers, then merged in passes
+  // between two buffers. The values are padded with maximums to whole
+  // blocks, which sort to the end.
+  constexpr size_t kBlock = 8;
+  if (n <= kArity) {
+    sort8_blocks(values, n);
+    return;
+  }
+  if (n <= kBlock * kArity) {
+    v128 v[kBlock];
+    fill(v, v + kBlock, kV128Max);
+    memcpy(v, values, n * sizeof(uint16_t));
+    if (n <= 2 * kArity) {
+      sortVectors<2>(&v[0].mm);
+    } else if (n <= 4 * kArity) {
+      sortVectors<4>(&v[0].mm);
+    } else {
+      sortVectors<8>(&v[0].mm);
+    }
+    memcpy(values, v, n * sizeof(uint16_t));
+    return;
+  }
+  size_t vectors = (n + kBlock * kArity - 1) / (kBlock * kArity) * kBlock;
+  vector<v128> buffer(2 * vectors);
+  __m128i* src = &buffer[0].mm;
+  __m128i* dst = src + vectors;
+  fill(reinterpret_cast<uint16_t*>(src) + n, reinterpret_cast<uint16_t*>(dst), kMax);
+  memcpy(src, values, n * sizeof(uint16_t));
+  for (size_t i = 0; i < vectors; i += kBlock) {
+    __m128i v[kBlock];
+    for (size_t j = 0; j < kBlock; ++j) v[j] = src[i + j];
+    sortVectors<kBlock>(v);
+    for (size_t j = 0; j < kBlock; ++j) src[i + j] = v[j];
+  }
+  for (size_t run = kBlock; run < vectors; run *= 2) {
+    for (size_t i = 0; i < vectors; i += 2 * run) {
+      size_t mid = min(i + run, vectors), end = min(i + 2 * run, vectors);
+      if (mid == end) {
+        copy(src + i, src + end, dst + i);
+      } else {
+        mergeVectorRuns(src + i, src + mid, src + mid, src + end, dst + i);
+      }
+    }
+    swap(src, dst);
+  }
+  memcpy(values, src, n * sizeof(uint16_t));
+}
@@ -1,5 +1,34 @@
 #pragma once
 
+#include <cstddef> // size_t
+#include <cstdint> // uint16_t
 #include <emmintrin.h> // __m128i
 
+// Sorts the 8 uint16 lanes of mm in ascending order with sort8_network,
+// which is faster than sort8_minpos.
 __m128i sort8(__m128i mm);
+
+// 8 serial rounds of minpos, each masking out the minimum it found.
+__m128i sort8_minpos(__m128i mm);
+
+// Bitonic sorting network of 6 min/max + shuffle layers.
+__m128i sort8_network(__m128i mm);
+
+// Sorts each block of 8 values in values[0, n), and the last n % 8 values
+// as a shorter block, interleaving blocks for instruction level parallelism.
+void sort8_blocks(uint16_t* values, size_t n);
+
+// Merges the sorted a and b into 16 sorted values, the lower 8 in a and the
+// upper 8 in b.
+void merge16(__m128i& a, __m128i& b);
+
+// Sort the values of v[0, 2), v[0, 4) and v[0, 8) in registers, in
+// ascending order across the vectors.
+void sort16(__m128i* v);
+void sort32(__m128i* v);
+void sort64(__m128i* v);
+
+// Sorts values[0, n) in ascending order: sort64 on blocks of 64 values and
+// then passes of pairwise merges with merge16. Allocates a buffer of about
+// 2n values.
+void sort8_mergesort(uint16_t* values, size_t n);
@@ -5,12 +5,15 @@
 */
 
 #include "Sort8.hpp"
+#include "Argsort8.hpp"
 #include <emmintrin.h>
 #include <cstddef>
 #include <cstdint>
 #include <algorithm>
 #include <limits>
 #include <random>
+#include <utility>
+#include <vector>
 #include <folly/Benchmark.h>
 #include <gflags/gflags.h>
 
@@ -22,20 +25,62 @@ namespace {
 constexpr size_t kArity = 8;
 constexpr size_t kCount = 10000;
 __m128i mms[kCount];
+__m128i tmps[kCount];
+__m128i payloads[2 * kCount]; // 8 uint32 per block of mms
+__m128i tmpPayloads[2 * kCount];
 
 void initData() {
   default_random_engine gen(0);
   uniform_int_distribution<uint16_t> distr(0, numeric_limits<uint16_t>::max());
   uint16_t* vs = reinterpret_cast<uint16_t*>(mms);
   for (size_t i = 0; i < kCount * kArity; ++i) vs[i] = distr(gen);
+  uint32_t* ps = reinterpret_cast<uint32_t*>(payloads);
+  for (size_t i = 0; i < kCount * kArity; ++i) ps[i] = i;
+}
+
+// Sorts each block in place, kCount blocks in all.
+void sortBlocks(uint16_t* vs) {
+  for (size_t j = 0; j < kCount; ++j) std::sort(vs + j * kArity, vs + (j + 1) * kArity);
+}
+
+// Sorts a copy of random values in the array with sort, n times.
+template<class Sort>
+void sortArray(uint32_t n, size_t sz, Sort sort) {
+  vector<uint16_t> values;
+  for (uint32_t i = 0; i < n; ++i) {
+    BENCHMARK_SUSPEND {
+      uint16_t const* vs = reinterpret_cast<uint16_t const*>(mms);
+      values.assign(vs, vs + sz);
+    }
+    sort(values.data(), sz);
+    doNotOptimizeAway(values[0]);
+  }
+}
+
+void array_std_sort(uint32_t n, size_t sz) {
+  sortArray(n, sz, [](uint16_t* vs, size_t sz) { std::sort(vs, vs + sz); });
+}
+
+void array_sort8_mergesort(uint32_t n, size_t sz) {
+  sortArray(n, sz, sort8_mergesort);
 }
 
 } // namespace
 
-BENCHMARK(sort8) {
+// Independent sorts, which measure throughput.
+
+BENCHMARK(sort8_minpos) {
+  __m128i x = _mm_set1_epi16(0);
+  for (size_t j = 0; j < kCount; ++j) {
+    x ^= sort8_minpos(mms[j]);
+  }
+  doNotOptimizeAway(x);
+}
+
+BENCHMARK_RELATIVE(sort8_network) {
   __m128i x = _mm_set1_epi16(0);
   for (size_t j = 0; j < kCount; ++j) {
-    x ^= sort8(mms[j]);
+    x ^= sort8_network(mms[j]);
   }
   doNotOptimizeAway(x);
 }
@@ -51,6 +96,107 @@ BENCHMARK_RELATIVE(std_sort) {
   doNotOptimizeAway(x);
 }
 
+BENCHMARK_DRAW_LINE();
+
+// Each sort depends on the previous one, which measures latency.
+
+BENCHMARK(chain_sort8_minpos) {
+  __m128i x = _mm_set1_epi16(0);
+  for (size_t j = 0; j < kCount; ++j) {
+    x = sort8_minpos(x ^ mms[j]);
+  }
+  doNotOptimizeAway(x);
+}
+
+BENCHMARK_RELATIVE(chain_sort8_network) {
+  __m128i x = _mm_set1_epi16(0);
+  for (size_t j = 0; j < kCount; ++j) {
+    x = sort8_network(x ^ mms[j]);
+  }
+  doNotOptimizeAway(x);
+}
+
+BENCHMARK_DRAW_LINE();
+
+// Sorting the 8 value blocks of an array in place.
+
+BENCHMARK(blocks_sort8_minpos) {
+  BENCHMARK_SUSPEND {
+    std::copy(mms, mms + kCount, tmps);
+  }
+  for (size_t j = 0; j < kCount; ++j) tmps[j] = sort8_minpos(tmps[j]);
+  doNotOptimizeAway(tmps[0]);
+}
+
+BENCHMARK_RELATIVE(blocks_sort8_network) {
+  BENCHMARK_SUSPEND {
+    std::copy(mms, mms + kCount, tmps);
+  }
+  for (size_t j = 0; j < kCount; ++j) tmps[j] = sort8_network(tmps[j]);
+  doNotOptimizeAway(tmps[0]);
+}
+
+BENCHMARK_RELATIVE(blocks_sort8_blocks) {
+  BENCHMARK_SUSPEND {
+    std::copy(mms, mms + kCount, tmps);
+  }
+  sort8_blocks(reinterpret_cast<uint16_t*>(tmps), kCount * kArity);
+  doNotOptimizeAway(tmps[0]);
+}
+
+BENCHMARK_RELATIVE(blocks_std_sort) {
+  BENCHMARK_SUSPEND {
+    std::copy(mms, mms + kCount, tmps);
+  }
+  sortBlocks(reinterpret_cast<uint16_t*>(tmps));
+  doNotOptimizeAway(tmps[0]);
+}
+
+BENCHMARK_DRAW_LINE();
+
+// Sorting the 8 value blocks of an array together with 32 bit payloads.
+
+BENCHMARK(pairs_std_stable_sort) {
+  uint16_t const* vs = reinterpret_cast<uint16_t const*>(mms);
+  uint32_t const* ps = reinterpret_cast<uint32_t const*>(payloads);
+  pair<uint16_t, uint32_t> block[kArity];
+  uint32_t x = 0;
+  for (size_t j = 0; j < kCount; ++j) {
+    for (size_t i = 0; i < kArity; ++i) block[i] = {vs[j * kArity + i], ps[j * kArity + i]};
+    std::stable_sort(block, block + kArity,
+                     [](auto const& a, auto const& b) { return a.first < b.first; });
+    x ^= block[0].second;
+  }
+  doNotOptimizeAway(x);
+}
+
+BENCHMARK_RELATIVE(pairs_argsort8) {
+  BENCHMARK_SUSPEND {
+    std::copy(payloads, payloads + 2 * kCount, tmpPayloads);
+  }
+  __m128i x = _mm_set1_epi16(0);
+  for (size_t j = 0; j < kCount; ++j) {
+    Sorted8 s = argsort8(mms[j]);
+    permute8Epi32(tmpPayloads + 2 * j, s.lanes);
+    x ^= s.keys;
+  }
+  doNotOptimizeAway(x);
+  doNotOptimizeAway(tmpPayloads[0]);
+}
+
+BENCHMARK_DRAW_LINE();
+
+// Sorting arrays of up to kCount * kArity values.
+
+BENCHMARK_PARAM(array_std_sort, 16)
+BENCHMARK_RELATIVE_PARAM(array_sort8_mergesort, 16)
+BENCHMARK_PARAM(array_std_sort, 64)
+BENCHMARK_RELATIVE_PARAM(array_sort8_mergesort, 64)
+BENCHMARK_PARAM(array_std_sort, 1000)
+BENCHMARK_RELATIVE_PARAM(array_sort8_mergesort, 1000)
+BENCHMARK_PARAM(array_std_sort, 80000)
+BENCHMARK_RELATIVE_PARAM(array_sort8_mergesort, 80000)
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   initData();
@@ -5,8 +5,13 @@
 
 #include "Sort8.hpp"
 #include "v128.h"
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <limits>
+#include <random>
+#include <vector>
 #include <gtest/gtest.h>
 
 namespace {
@@ -15,11 +20,116 @@ using namespace std;
 
 constexpr uint16_t kMax = numeric_limits<uint16_t>::max();
 
+typedef __m128i (*Sort8)(__m128i);
+
+const Sort8 kSorts[] = {sort8, sort8_minpos, sort8_network};
+
+v128 stdSort(v128 v) {
+  uint16_t* vs = reinterpret_cast<uint16_t*>(&v);
+  std::sort(vs, vs + 8);
+  return v;
+}
+
 TEST(sort8, sort8) {
   v128 unsorted = { { kMax - 7, 0, kMax - 13, 3, 2, 3, 2, 3 } };
   v128 sorted = { { 0, 2, 2, 3, 3, 3, kMax - 13, kMax - 7 } };
-  EXPECT_EQ(sorted, mm2v128(sort8(unsorted.mm)));
-  EXPECT_EQ(sorted, mm2v128(sort8(sorted.mm)));
+  for (Sort8 sort : kSorts) {
+    EXPECT_EQ(sorted, mm2v128(sort(unsorted.mm)));
+    EXPECT_EQ(sorted, mm2v128(sort(sorted.mm)));
+  }
+}
+
+// A comparator network sorts all inputs if it sorts all 0/1 inputs.
+TEST(sort8, zeroOne) {
+  for (unsigned bits = 0; bits < 256; ++bits) {
+    v128 v;
+    for (int i = 0; i < 8; ++i) v.values[i] = (bits >> i) & 1 ? kMax : 0;
+    for (Sort8 sort : kSorts) EXPECT_EQ(stdSort(v), mm2v128(sort(v.mm))) << bits;
+  }
+}
+
+TEST(sort8, random) {
+  default_random_engine gen(0);
+  for (uint16_t max : {uint16_t(3), kMax}) {
+    uniform_int_distribution<uint16_t> distr(0, max);
+    for (int n = 0; n < 1000; ++n) {
+      v128 v;
+      for (int i = 0; i < 8; ++i) v.values[i] = distr(gen);
+      for (Sort8 sort : kSorts) EXPECT_EQ(stdSort(v), mm2v128(sort(v.mm))) << v;
+    }
+  }
+}
+
+TEST(sort8, blocks) {
+  default_random_engine gen(1);
+  uniform_int_distribution<uint16_t> distr(0, kMax);
+  for (size_t n : {0, 1, 7, 8, 9, 31, 32, 33, 40, 1001}) {
+    vector<uint16_t> values(n);
+    for (uint16_t& x : values) x = distr(gen);
+    vector<uint16_t> expected = values;
+    for (size_t i = 0; i < n; i += 8) {
+      std::sort(expected.begin() + i, expected.begin() + min(i + 8, n));
+    }
+    sort8_blocks(values.data(), n);
+    EXPECT_EQ(expected, values) << n;
+  }
+}
+
+vector<uint16_t> randomValues(size_t n, uint16_t max, int seed) {
+  default_random_engine gen(seed);
+  uniform_int_distribution<uint16_t> distr(0, max);
+  vector<uint16_t> values(n);
+  for (uint16_t& x : values) x = distr(gen);
+  return values;
+}
+
+TEST(sort8, merge16) {
+  for (int seed = 0; seed < 1000; ++seed) {
+    vector<uint16_t> values = randomValues(16, seed % 2 ? 5 : kMax, seed);
+    std::sort(values.begin(), values.begin() + 8);
+    std::sort(values.begin() + 8, values.end());
+    __m128i v[2];
+    memcpy(v, values.data(), sizeof(v));
+    merge16(v[0], v[1]);
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(0, memcmp(values.data(), v, sizeof(v))) << seed;
+  }
+}
+
+TEST(sort8, sort64) {
+  struct {
+    void (*sort)(__m128i*);
+    size_t count;
+  } const sorts[] = {{sort16, 2}, {sort32, 4}, {sort64, 8}};
+  for (auto [sort, count] : sorts) {
+    for (int seed = 0; seed < 300; ++seed) {
+      vector<uint16_t> values = randomValues(8 * count, seed % 2 ? 5 : kMax, seed);
+      __m128i v[8];
+      memcpy(v, values.data(), 16 * count);
+      sort(v);
+      std::sort(values.begin(), values.end());
+      EXPECT_EQ(0, memcmp(values.data(), v, 16 * count)) << count << " " << seed;
+    }
+  }
+}
+
+TEST(sort8, mergesort) {
+  for (size_t n : {0, 1, 7, 8, 9, 16, 17, 32, 33, 63, 64, 65, 128, 200, 1000, 4096, 10001}) {
+    for (uint16_t max : {uint16_t(0), uint16_t(3), kMax}) {
+      vector<uint16_t> values = randomValues(n, max, n);
+      vector<uint16_t> expected = values;
+      std::sort(expected.begin(), expected.end());
+      sort8_mergesort(values.data(), n);
+      EXPECT_EQ(expected, values) << n << " " << max;
+    }
+  }
+  // Sorted and reverse sorted runs.
+  vector<uint16_t> values(5000);
+  for (size_t i = 0; i < values.size(); ++i) values[i] = i % 1000 < 500 ? i : 5000 - i;
+  vector<uint16_t> expected = values;
+  std::sort(expected.begin(), expected.end());
+  sort8_mergesort(values.data(), values.size());
+  EXPECT_EQ(expected, values);
 }
 
 } // namespace
@@ -7,6 +7,7 @@
 #include <functional>
 #include <limits>
 #include <new>
+#include <utility>
 #include <vector>
 
 template<class V = uint16_t, class Compare = std::greater<V>>
@@ -33,7 +34,7 @@ class StdMinHeap {
     size_type old_size = array_.size();
     if (n > std::numeric_limits<size_type>::max() - old_size) throw_bad_alloc();
     array_.resize(old_size + n);
-    return &array_[old_size];
+    return array_.data() + old_size;
   }
 
   template<class InputIterator>
@@ -45,12 +46,11 @@ class StdMinHeap {
     assert(q < size());
     while (q > 0) {
       size_type p = parent(q);
-      value_type a = array_[p];
-      if (!cmp_(a, b)) break;
-      array_[q] = a;
+      if (!cmp_(array_[p], b)) break;
+      array_[q] = std::move(array_[p]);
       q = p;
     }
-    array_[q] = b;
+    array_[q] = std::move(b);
   }
 
   void push_down(value_type a, size_type p) {
@@ -59,19 +59,12 @@ class StdMinHeap {
     while (true) {
       size_type q = children(p);
       if (q + 1 > sz) break;
-      value_type b = array_[q];
-      if (q + 1 < sz) {
-        value_type c = array_[q + 1];
-        if (cmp_(b, c)) {
-          q += 1;
-          b = c;
-        }
-      }
-      if (!cmp_(a, b)) break;
-      array_[p] = b;
+      if (q + 1 < sz && cmp_(array_[q], array_[q + 1])) q += 1;
+      if (!cmp_(a, array_[q])) break;
+      array_[p] = std::move(array_[q]);
       p = q;
     }
-    array_[p] = a;
+    array_[p] = std::move(a);
   }
 
   void heapify() {
@@ -83,29 +76,32 @@ class StdMinHeap {
   }
 
   void push(value_type b) {
-    array_.push_back(b);
 #ifdef STD_PUSH_HEAP
+    array_.push_back(std::move(b));
     std::push_heap(array_.begin(), array_.end(), cmp_);
 #else
-    pull_up(b, size() - 1);
+    array_.emplace_back(); // pull_up overwrites the value
+    pull_up(std::move(b), size() - 1);
 #endif
   }
 
-  value_type top() const {
+  value_type const& top() const {
     assert(size() > 0);
     return array_[0];
   }
 
   value_type pop() {
-    value_type a = top();
+    assert(size() > 0);
 #ifdef STD_POP_HEAP
     std::pop_heap(array_.begin(), array_.end(), cmp_);
+    value_type a = std::move(array_.back());
     array_.pop_back();
 #else
-    value_type b = array_.back();
+    value_type a = std::move(array_[0]);
+    value_type b = std::move(array_.back());
     array_.pop_back();
     if (size() > 0) {
-      push_down(b, 0);
+      push_down(std::move(b), 0);
     }
 #endif
     return a;
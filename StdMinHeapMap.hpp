@@ -9,6 +9,7 @@
 #include <functional>
 #include <limits>
 #include <new>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -35,9 +36,11 @@ class StdMinHeapMap {
 
   key_type key(size_type index) const { return entry(index).first; }
 
+  mapped_type const& mapped(size_type index) const { return heap_[index].second; }
+
   entry_type entry(size_type index) const { return heap_[index]; }
 
-  void set_entry(size_type index, entry_type a) { heap_[index] = a; }
+  void set_entry(size_type index, entry_type a) { heap_[index] = std::move(a); }
 
   void extend(size_type n) { heap_.extend(n); }
 
@@ -47,20 +50,28 @@ class StdMinHeapMap {
   }
 
   void pull_up(key_type b, mapped_type t, size_type q) {
-    heap_.pull_up(entry_type(b, t), q);
+    heap_.pull_up(entry_type(b, std::move(t)), q);
   }
 
   void push_down(key_type a, mapped_type s, size_type p) {
-    heap_.push_down(entry_type(a, s), p);
+    heap_.push_down(entry_type(a, std::move(s)), p);
   }
 
   void heapify() { heap_.heapify(); }
 
   bool is_heap() const { return heap_.is_heap(); }
 
-  void push_entry(entry_type e) { heap_.push(e); }
+  void push_entry(entry_type e) { heap_.push(std::move(e)); }
+
+  void push_entry(key_type b, mapped_type t) {
+    heap_.push(entry_type(b, std::move(t)));
+  }
 
-  void push_entry(key_type b, mapped_type t) { heap_.push(entry_type(b, t)); }
+  template<class... Args>
+  void emplace_entry(key_type b, Args&&... args) {
+    heap_.push(entry_type(std::piecewise_construct, std::forward_as_tuple(b),
+                          std::forward_as_tuple(std::forward<Args>(args)...)));
+  }
 
   size_type top_index() const { return 0; }
 
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for the parts of parallel loops, so that
+// parallel algorithms like parallelMerge don't start threads on every call.
+//
+// forEach(parts, f) queues f(p) for p < parts - 1 and calls f(parts - 1)
+// on the calling thread, which then runs queued calls too until all its
+// parts are done. So it makes progress without workers, and a part may
+// itself call forEach on the same pool. The first exception thrown by a
+// part is rethrown from forEach after all the parts have returned.
+class ThreadPool {
+ public:
+  explicit ThreadPool(std::size_t workers) {
+    threads_.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) threads_.emplace_back([this] { work(); });
+  }
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_all();
+    for (std::thread& t : threads_) t.join();
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // A pool with a worker for every core but the calling thread's, started
+  // on first use.
+  static ThreadPool& shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+  }
+
+  std::size_t workers() const { return threads_.size(); }
+
+  template<class F>
+  void forEach(std::size_t parts, F&& f) {
+    if (parts == 0) return;
+    Batch batch{parts, nullptr};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (std::size_t p = 0; p + 1 < parts; ++p) {
+        tasks_.emplace_back([this, &batch, &f, p] { run(batch, f, p); });
+      }
+    }
+    if (parts > 1) ready_.notify_all();
+    run(batch, f, parts - 1);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (batch.pending > 0) {
+      if (tasks_.empty()) {
+        done_.wait(lock);
+        continue;
+      }
+      std::function<void()> task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+    if (batch.error) std::rethrow_exception(batch.error);
+  }
+
+ private:
+  struct Batch {
+    std::size_t pending; // parts not returned yet
+    std::exception_ptr error;
+  };
+
+  template<class F>
+  void run(Batch& batch, F& f, std::size_t p) {
+    std::exception_ptr error;
+    try {
+      f(p);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error && !batch.error) batch.error = error;
+    // Under the lock, so forEach can't return and destroy batch before.
+    if (--batch.pending == 0) done_.notify_all();
+  }
+
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      ready_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      std::function<void()> task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable ready_; // tasks_ nonempty or stop_
+  std::condition_variable done_; // some batch finished
+  std::deque<std::function<void()>> tasks_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Argsort8.hpp"
+#include "v128.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <emmintrin.h> // __m128i
+
+// Streaming selection of the 8 or 16 smallest uint16 keys, kept sorted in
+// one or two registers, for many short rows where even a Heap8 costs too
+// much to set up.
+//
+// Each push of a block of 8 keys first compares them with the largest key
+// kept and returns if none is less, which is most blocks once the kept
+// keys are small. Otherwise it sorts the block with the bitonic network
+// of sort8_network and merges it in: the minimum of the kept keys and the
+// reversed block is the lower half of their union, a bitonic sequence
+// that the last 3 layers of the network sort. TopK16 merges the block with
+// the upper vector first and then the two vectors with each other.
+//
+// With payloads every key carries a uint16 payload lane, e.g. its column,
+// moved along by the compare-exchanges of argsort8Layer, which break ties
+// between equal keys by the smaller payload (as int16_t). Which of several
+// keys equal to the largest key kept are kept is unspecified.
+//
+// The keys are kept biased by 0x8000, so that SSE2's signed 16 bit min,
+// max and compares order them unsigned. Lanes not filled yet hold kMax
+// keys.
+template<std::size_t kVectors, bool kPayloads> class TopKRegisters {
+  static_assert(kVectors == 1 || kVectors == 2);
+
+ public:
+  static constexpr std::size_t kArity = 8;
+  static constexpr std::size_t kCapacity = kVectors * kArity;
+
+  TopKRegisters() { clear(); }
+
+  void clear() {
+    for (Lanes& v : best_) {
+      v.keys = _mm_set1_epi16(0x7fff); // kMax biased
+      v.payloads = _mm_setzero_si128();
+    }
+  }
+
+  // Merges in the 8 keys of block, and with payloads their payloads.
+  void push(__m128i block) {
+    static_assert(!kPayloads);
+    push(Lanes{bias(block), _mm_setzero_si128()});
+  }
+  void push(__m128i block, __m128i payloads) {
+    static_assert(kPayloads);
+    push(Lanes{bias(block), payloads});
+  }
+
+  // Merges in keys[0, n), with payloads first + i for keys[i].
+  void push(std::uint16_t const* keys, std::size_t n, std::uint16_t first = 0) {
+    __m128i payloads = _mm_add_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_set1_epi16(first));
+    __m128i step = _mm_set1_epi16(kArity);
+    std::size_t i = 0;
+    for (; i + kArity <= n; i += kArity) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(keys + i));
+      push(Lanes{bias(block), payloads});
+      payloads = _mm_add_epi16(payloads, step);
+    }
+    if (i < n) {
+      v128 tail = kV128Max;
+      std::memcpy(&tail, keys + i, (n - i) * sizeof(std::uint16_t));
+      push(Lanes{bias(tail.mm), payloads});
+    }
+  }
+
+  // Keys i * 8 to i * 8 + 7 of the kept keys in ascending order.
+  __m128i keys(std::size_t i = 0) const { return bias(best_[i].keys); }
+
+  // The payloads of keys(i).
+  __m128i payloads(std::size_t i = 0) const {
+    static_assert(kPayloads);
+    return best_[i].payloads;
+  }
+
+  // The largest key kept, kMax until kCapacity keys are kept.
+  std::uint16_t threshold() const {
+    return _mm_extract_epi16(best_[kVectors - 1].keys, 7) ^ 0x8000;
+  }
+
+ private:
+  struct Lanes {
+    __m128i keys;
+    __m128i payloads;
+  };
+
+  static __m128i bias(__m128i keys) { return _mm_xor_si128(keys, _mm_set1_epi16(-0x8000)); }
+
+  // Lanes in reverse order.
+  static __m128i reverse(__m128i v) {
+#if defined(__SSSE3__)
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1));
+#else
+    v = _mm_shuffle_epi32(v, 0x1b);
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+#endif
+  }
+
+  static Lanes reverse(Lanes v) {
+    if constexpr (kPayloads) v.payloads = reverse(v.payloads);
+    v.keys = reverse(v.keys);
+    return v;
+  }
+
+  // Lanes where (b.keys, b.payloads) < (a.keys, a.payloads).
+  static __m128i less(Lanes a, Lanes b) {
+    __m128i lt = _mm_cmplt_epi16(b.keys, a.keys);
+    if constexpr (kPayloads) {
+      lt = _mm_or_si128(lt, _mm_and_si128(_mm_cmpeq_epi16(b.keys, a.keys),
+                                          _mm_cmplt_epi16(b.payloads, a.payloads)));
+    }
+    return lt;
+  }
+
+  // The lane-wise minimum and maximum of a and b.
+  static void minmax(Lanes a, Lanes b, Lanes& lo, Lanes& hi) {
+    if constexpr (kPayloads) {
+      __m128i lt = less(a, b);
+      lo = Lanes{argsort8Blend(a.keys, b.keys, lt), argsort8Blend(a.payloads, b.payloads, lt)};
+      hi = Lanes{argsort8Blend(b.keys, a.keys, lt), argsort8Blend(b.payloads, a.payloads, lt)};
+    } else {
+      lo = Lanes{_mm_min_epi16(a.keys, b.keys), a.payloads};
+      hi = Lanes{_mm_max_epi16(a.keys, b.keys), a.payloads};
+    }
+  }
+
+  template<int k, int j>
+  static void layer(Lanes& v) {
+    if constexpr (kPayloads) {
+      argsort8Layer<k, j>(v.keys, v.payloads);
+    } else {
+      __m128i p = argsort8Partner<j>(v.keys);
+      v.keys = argsort8Blend(_mm_min_epi16(v.keys, p), _mm_max_epi16(v.keys, p),
+                             argsort8HiLanes<k, j>());
+    }
+  }
+
+  // Sorts a bitonic v.
+  static void clean(Lanes& v) {
+    layer<8, 4>(v);
+    layer<8, 2>(v);
+    layer<8, 1>(v);
+  }
+
+  static void sort(Lanes& v) {
+    layer<2, 1>(v);
+    layer<4, 2>(v);
+    layer<4, 1>(v);
+    clean(v);
+  }
+
+  void push(Lanes block) {
+    // The largest key kept in all lanes.
+    __m128i last = _mm_shufflehi_epi16(best_[kVectors - 1].keys, 0xff);
+    __m128i max = _mm_shuffle_epi32(last, 0xff);
+    if (_mm_movemask_epi8(_mm_cmplt_epi16(block.keys, max)) == 0) return;
+    sort(block);
+    Lanes lo, hi;
+    minmax(best_[kVectors - 1], reverse(block), lo, hi);
+    clean(lo);
+    if constexpr (kVectors == 1) {
+      best_[0] = lo;
+    } else {
+      // The 16 smallest are best_[0] and lo, see the bitonic merge in merge16.
+      minmax(best_[0], reverse(lo), best_[0], best_[1]);
+      clean(best_[0]);
+      clean(best_[1]);
+    }
+  }
+
+  Lanes best_[kVectors];
+};
+
+// The 8 smallest keys, in one register, or two with payloads.
+template<bool kPayloads = false> using TopK8 = TopKRegisters<1, kPayloads>;
+
+// The 16 smallest keys, in two registers, or four with payloads.
+template<bool kPayloads = false> using TopK16 = TopKRegisters<2, kPayloads>;
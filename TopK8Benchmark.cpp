@@ -0,0 +1,104 @@
+/*
+   brew install google-benchmark
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -c Select.cpp Sort8.cpp RadixSort.cpp &&
+   g++ -std=c++17 -msse4 -O2 -DNDEBUG -pthread -lbenchmark -lbenchmark_main Select.o Sort8.o RadixSort.o TopK8Benchmark.cpp
+   ./a.out
+*/
+
+#include "TopK8.hpp"
+#include "Select.hpp"
+#include "Heap8.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+// The keys of kRows rows of state.range(0) keys each, back to back.
+constexpr size_t kRows = 10000;
+
+std::vector<uint16_t> randomKeys(size_t n) {
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<uint16_t> distr(0, std::numeric_limits<uint16_t>::max());
+  std::vector<uint16_t> keys(n);
+  for (uint16_t& k : keys) k = distr(gen);
+  return keys;
+}
+
+// The smallest 8 or 16 keys of every row, with their columns if kPayloads.
+template<class TopK>
+void bm_top_k_registers(benchmark::State& state) {
+  size_t columns = state.range(0);
+  std::vector<uint16_t> const keys = randomKeys(kRows * columns);
+  for (auto _ : state) {
+    for (size_t r = 0; r < kRows; ++r) {
+      TopK top;
+      top.push(keys.data() + r * columns, columns);
+      benchmark::DoNotOptimize(top);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// heapify each row and pop 8.
+void bm_heap8_pop(benchmark::State& state) {
+  size_t columns = state.range(0);
+  std::vector<uint16_t> const keys = randomKeys(kRows * columns);
+  uint16_t out[8];
+  for (auto _ : state) {
+    for (size_t r = 0; r < kRows; ++r) {
+      Heap8 heap;
+      heap.append(keys.begin() + r * columns, keys.begin() + (r + 1) * columns);
+      heap.heapify();
+      for (size_t i = 0; i < 8; ++i) out[i] = heap.pop();
+      benchmark::DoNotOptimize(out);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+void bm_select_top_k(benchmark::State& state) {
+  size_t columns = state.range(0);
+  std::vector<uint16_t> const keys = randomKeys(kRows * columns);
+  uint16_t out[8];
+  for (auto _ : state) {
+    for (size_t r = 0; r < kRows; ++r) {
+      topK(keys.data() + r * columns, columns, 8, out);
+      benchmark::DoNotOptimize(out);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// partial_sort a copy of each row.
+void bm_std_partial_sort(benchmark::State& state) {
+  size_t columns = state.range(0);
+  std::vector<uint16_t> const keys = randomKeys(kRows * columns);
+  std::vector<uint16_t> row(columns);
+  for (auto _ : state) {
+    for (size_t r = 0; r < kRows; ++r) {
+      std::copy(keys.begin() + r * columns, keys.begin() + (r + 1) * columns, row.begin());
+      std::partial_sort(row.begin(), row.begin() + 8, row.end());
+      benchmark::DoNotOptimize(row.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Rows of 16 to 256 keys.
+void RowArguments(benchmark::internal::Benchmark* b) {
+  for (int64_t columns = 16; columns <= 256; columns *= 4) b->Args({columns});
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(bm_top_k_registers, TopK8<>)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(bm_top_k_registers, TopK8<true>)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(bm_top_k_registers, TopK16<>)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(bm_top_k_registers, TopK16<true>)->Apply(RowArguments);
+BENCHMARK(bm_heap8_pop)->Apply(RowArguments);
+BENCHMARK(bm_select_top_k)->Apply(RowArguments);
+BENCHMARK(bm_std_partial_sort)->Apply(RowArguments);
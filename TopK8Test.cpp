@@ -0,0 +1,139 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main TopK8Test.cpp
+   ./a.out
+*/
+
+#include "TopK8.hpp"
+#include "v128.h"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace std;
+
+constexpr uint16_t kMax = numeric_limits<uint16_t>::max();
+
+vector<uint16_t> randomKeys(size_t n, uint16_t max_key, default_random_engine& gen) {
+  uniform_int_distribution<uint16_t> distr(0, max_key);
+  vector<uint16_t> keys(n);
+  for (uint16_t& k : keys) k = distr(gen);
+  return keys;
+}
+
+// The kept keys, and the payloads if any, of top.
+template<class TopK>
+vector<uint16_t> keysOf(TopK const& top) {
+  vector<uint16_t> keys;
+  for (size_t i = 0; i < TopK::kCapacity / TopK::kArity; ++i) {
+    v128 v = mm2v128(top.keys(i));
+    keys.insert(keys.end(), &v.values[0], &v.values[0] + 8);
+  }
+  return keys;
+}
+
+template<class TopK>
+vector<uint16_t> payloadsOf(TopK const& top) {
+  vector<uint16_t> payloads;
+  for (size_t i = 0; i < TopK::kCapacity / TopK::kArity; ++i) {
+    v128 v = mm2v128(top.payloads(i));
+    payloads.insert(payloads.end(), &v.values[0], &v.values[0] + 8);
+  }
+  return payloads;
+}
+
+// The kCapacity smallest of keys, padded with kMax.
+vector<uint16_t> expected(vector<uint16_t> keys, size_t capacity) {
+  keys.resize(max(keys.size(), capacity), kMax);
+  partial_sort(keys.begin(), keys.begin() + capacity, keys.end());
+  keys.resize(capacity);
+  return keys;
+}
+
+template<class TopK>
+void testRows() {
+  default_random_engine gen(0);
+  for (uint16_t max_key : {uint16_t(3), uint16_t(1000), kMax}) {
+    for (size_t n = 0; n <= 100; ++n) {
+      vector<uint16_t> keys = randomKeys(n, max_key, gen);
+      TopK top;
+      top.push(keys.data(), n);
+      vector<uint16_t> best = expected(keys, TopK::kCapacity);
+      ASSERT_EQ(best, keysOf(top)) << n << " " << max_key;
+      EXPECT_EQ(best.back(), top.threshold());
+    }
+  }
+}
+
+template<class TopK>
+void testPayloads() {
+  default_random_engine gen(1);
+  for (uint16_t max_key : {uint16_t(3), uint16_t(1000), kMax}) {
+    for (size_t n = TopK::kCapacity; n <= 100; ++n) {
+      vector<uint16_t> keys = randomKeys(n, max_key, gen);
+      TopK top;
+      top.push(keys.data(), n, 1000);
+      vector<uint16_t> best = expected(keys, TopK::kCapacity);
+      vector<uint16_t> kept = keysOf(top);
+      ASSERT_EQ(best, kept) << n << " " << max_key;
+      vector<uint16_t> payloads = payloadsOf(top);
+      for (size_t i = 0; i < TopK::kCapacity; ++i) {
+        ASSERT_LE(1000, payloads[i]);
+        ASSERT_EQ(kept[i], keys[payloads[i] - 1000]) << n << " " << max_key << " " << i;
+      }
+      sort(payloads.begin(), payloads.end());
+      EXPECT_EQ(payloads.end(), adjacent_find(payloads.begin(), payloads.end()));
+    }
+  }
+}
+
+TEST(TopK8Test, Rows) {
+  testRows<TopK8<>>();
+  testRows<TopK8<true>>();
+}
+
+TEST(TopK16Test, Rows) {
+  testRows<TopK16<>>();
+  testRows<TopK16<true>>();
+}
+
+TEST(TopK8Test, Payloads) {
+  testPayloads<TopK8<true>>();
+}
+
+TEST(TopK16Test, Payloads) {
+  testPayloads<TopK16<true>>();
+}
+
+// Blocks pushed one at a time, with blocks that all keys reject, and
+// after clear.
+TEST(TopK16Test, Blocks) {
+  TopK16<> top;
+  v128 a = { { 9, 8, 7, 6, 5, 4, 3, 2 } };
+  v128 b = { { 100, 1, 100, 100, 100, 100, 100, 0 } };
+  v128 c = { { 200, 200, 200, 200, 200, 200, 200, 200 } };
+  top.push(a.mm);
+  EXPECT_EQ(kMax, top.threshold());
+  top.push(b.mm);
+  EXPECT_EQ(100, top.threshold());
+  top.push(c.mm);
+  EXPECT_EQ(100, top.threshold());
+  v128 lower = { { 0, 1, 2, 3, 4, 5, 6, 7 } };
+  v128 upper = { { 8, 9, 100, 100, 100, 100, 100, 100 } };
+  EXPECT_EQ(lower, mm2v128(top.keys(0)));
+  EXPECT_EQ(upper, mm2v128(top.keys(1)));
+  top.push(a.mm);
+  v128 again = { { 5, 5, 6, 6, 7, 7, 8, 8 } };
+  EXPECT_EQ(again, mm2v128(top.keys(1)));
+  top.clear();
+  EXPECT_EQ(kV128Max, mm2v128(top.keys(0)));
+  EXPECT_EQ(kMax, top.threshold());
+}
+
+} // namespace
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "minpos.h"
+#include "v128.h"
+#include "align.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// 8-ary tournament (winner) tree over k inputs for k-way merging, a
+// KWayMerger backend alternative to the heap maps, see KWayMerge.hpp.
+//
+// The leaves hold the input head keys 8 to a v128 node. Each internal node
+// holds the winning (minimum) keys of its 8 children in a v128, so replaying
+// the path from a changed leaf to the root is a single minpos per level,
+// without the data dependent sift decisions of a heap.
+//
+// It implements the part of the heap map interface that KWayMerger uses:
+// extend, set_entry and heapify to build, top_index and mapped to find the
+// winner, push_down to replace a leaf's key and pop_entry to retire the
+// winner. Retired leaves have key kMax and a cleared bit in the active
+// masks of the nodes, so that an active leaf with key kMax still wins over
+// them.
+class TournamentTree8 {
+ public:
+  typedef std::uint16_t key_type;
+  typedef std::uint32_t mapped_type;
+  typedef std::pair<key_type, mapped_type> entry_type;
+  typedef std::size_t size_type;
+
+ private:
+  static constexpr key_type kMax = std::numeric_limits<key_type>::max();
+  static constexpr size_type kArity = 8;
+
+  static_assert(sizeof(v128) == kArity * sizeof(key_type));
+
+  struct Level {
+    std::vector<v128> keys;
+    // Winning leaf of each child, empty at the leaf level.
+    std::vector<std::uint32_t> winners;
+    // Bit j of masks[n] is set if child j of node n has an active leaf.
+    std::vector<std::uint8_t> masks;
+  };
+
+ public:
+  TournamentTree8() : leaves_(0), size_(0), winner_(0) { levels_.resize(1); }
+  ~TournamentTree8() = default;
+  TournamentTree8(const TournamentTree8&) = delete;
+  TournamentTree8& operator=(const TournamentTree8&) = delete;
+
+  // Number of active leaves.
+  size_type size() const { return size_; }
+
+  key_type key(size_type index) const { return leaf_keys()[index]; }
+
+  mapped_type const& mapped(size_type index) const { return mapped_[index]; }
+
+  entry_type entry(size_type index) const {
+    return std::make_pair(key(index), mapped(index));
+  }
+
+  void set_entry(size_type index, entry_type a) {
+    leaf_keys()[index] = a.first;
+    mapped_[index] = a.second;
+  }
+
+  // Adds n active leaves. Populate them with set_entry and call heapify.
+  void extend(size_type n) {
+    leaves_ += n;
+    size_ += n;
+    levels_[0].keys.resize(align_up(leaves_, kArity) / kArity, kV128Max);
+    mapped_.resize(leaves_);
+  }
+
+  // Builds the internal nodes over the leaves.
+  void heapify() {
+    levels_.resize(1);
+    Level& leaves = levels_[0];
+    leaves.masks.assign(leaves.keys.size(), 0);
+    for (size_type i = 0; i < leaves_; ++i) {
+      leaves.masks[i / kArity] |= 1u << (i % kArity);
+    }
+    while (levels_.back().keys.size() > 1) {
+      size_type l = levels_.size() - 1;
+      size_type n = levels_[l].keys.size();
+      Level up;
+      up.keys.assign(align_up(n, kArity) / kArity, kV128Max);
+      up.winners.assign(align_up(n, kArity), 0);
+      up.masks.assign(up.keys.size(), 0);
+      for (size_type node = 0; node < n; ++node) {
+        std::pair<key_type, std::uint32_t> w = play(l, node);
+        up.keys[node / kArity].values[node % kArity] = w.first;
+        up.winners[node] = w.second;
+        if (levels_[l].masks[node]) up.masks[node / kArity] |= 1u << (node % kArity);
+      }
+      levels_.push_back(std::move(up));
+    }
+    if (leaves_ > 0) winner_ = play(levels_.size() - 1, 0).second;
+  }
+
+  size_type top_index() const {
+    assert(size_ > 0);
+    return winner_;
+  }
+
+  entry_type top_entry() const { return entry(top_index()); }
+
+  // Replaces the leaf at p with key a and mapped value s and replays it.
+  void push_down(key_type a, mapped_type s, size_type p) {
+    assert(p < leaves_);
+    mapped_[p] = s;
+    replay(p, a);
+  }
+
+  // Retires the winning leaf.
+  entry_type pop_entry() {
+    assert(size_ > 0);
+    size_type p = winner_;
+    entry_type e = entry(p);
+    deactivate(p);
+    --size_;
+    replay(p, kMax);
+    return e;
+  }
+
+  void clear() {
+    levels_.clear();
+    levels_.resize(1);
+    mapped_.clear();
+    leaves_ = 0;
+    size_ = 0;
+    winner_ = 0;
+  }
+
+ private:
+  key_type* leaf_keys() {
+    return reinterpret_cast<key_type*>(levels_[0].keys.data());
+  }
+  key_type const* leaf_keys() const {
+    return reinterpret_cast<key_type const*>(levels_[0].keys.data());
+  }
+
+  // The winning key and leaf of node at level l.
+  std::pair<key_type, std::uint32_t> play(size_type l, size_type node) const {
+    Level const& level = levels_[l];
+    minpos_type x = minpos(level.keys[node].mm);
+    unsigned pos = minpos_pos(x);
+    unsigned mask = level.masks[node];
+    // Only possible if the minimum is kMax: prefer an active child.
+    if (!(mask >> pos & 1) && mask) pos = __builtin_ctz(mask);
+    size_type slot = node * kArity + pos;
+    std::uint32_t leaf = l == 0 ? slot : level.winners[slot];
+    return std::make_pair(minpos_min(x), leaf);
+  }
+
+  // Returns v with lane i replaced by a. Stores whole vectors so that the
+  // next minpos load of the node is forwarded from the store buffer, which
+  // fails after a narrow store into the vector.
+  static v128 with_lane(v128 v, size_type i, key_type a) {
+    static constexpr v128 kLanes[kArity] = {
+      { { kMax, 0, 0, 0, 0, 0, 0, 0 } },
+      { { 0, kMax, 0, 0, 0, 0, 0, 0 } },
+      { { 0, 0, kMax, 0, 0, 0, 0, 0 } },
+      { { 0, 0, 0, kMax, 0, 0, 0, 0 } },
+      { { 0, 0, 0, 0, kMax, 0, 0, 0 } },
+      { { 0, 0, 0, 0, 0, kMax, 0, 0 } },
+      { { 0, 0, 0, 0, 0, 0, kMax, 0 } },
+      { { 0, 0, 0, 0, 0, 0, 0, kMax } },
+    };
+    u16x8 m = kLanes[i].values;
+    v.values = (v.values & ~m) | (a & m);
+    return v;
+  }
+
+  // Sets the key of leaf p to a and replays the path to the root, one
+  // minpos per level.
+  void replay(size_type p, key_type a) {
+    size_type top = levels_.size() - 1;
+    size_type slot = p;
+    for (size_type l = 0; l < top; ++l) {
+      size_type node = slot / kArity;
+      v128& keys = levels_[l].keys[node];
+      keys = with_lane(keys, slot % kArity, a);
+      std::pair<key_type, std::uint32_t> w = play(l, node);
+      a = w.first;
+      levels_[l + 1].winners[node] = w.second;
+      slot = node;
+    }
+    v128& keys = levels_[top].keys[0];
+    keys = with_lane(keys, slot, a);
+    winner_ = play(top, 0).second;
+  }
+
+  // Clears the active bits of leaf p and of the nodes it leaves empty.
+  void deactivate(size_type p) {
+    size_type slot = p;
+    for (size_type l = 0; l < levels_.size(); ++l) {
+      std::uint8_t& mask = levels_[l].masks[slot / kArity];
+      mask &= ~(1u << (slot % kArity));
+      if (mask != 0) break;
+      slot /= kArity;
+    }
+  }
+
+  std::vector<Level> levels_; // levels_[0] holds the leaves
+  std::vector<mapped_type> mapped_;
+  size_type leaves_;
+  size_type size_;
+  std::uint32_t winner_;
+};
@@ -0,0 +1,83 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main TournamentTree8Test.cpp
+   ./a.out
+*/
+
+#include "TournamentTree8.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+typedef TournamentTree8::entry_type Entry;
+
+TEST(TournamentTree8Test, Empty) {
+  TournamentTree8 t;
+  t.extend(0);
+  t.heapify();
+  EXPECT_EQ(0, t.size());
+}
+
+TEST(TournamentTree8Test, Winner) {
+  TournamentTree8 t;
+  t.extend(3);
+  t.set_entry(0, Entry(5, 100));
+  t.set_entry(1, Entry(2, 101));
+  t.set_entry(2, Entry(9, 102));
+  t.heapify();
+  EXPECT_EQ(3, t.size());
+  EXPECT_EQ(Entry(2, 101), t.top_entry());
+  // Replace the winner's key, like an input advancing.
+  t.push_down(7, 101, t.top_index());
+  EXPECT_EQ(Entry(5, 100), t.top_entry());
+  EXPECT_EQ(Entry(5, 100), t.pop_entry());
+  EXPECT_EQ(Entry(7, 101), t.pop_entry());
+  EXPECT_EQ(Entry(9, 102), t.pop_entry());
+  EXPECT_EQ(0, t.size());
+}
+
+// Replays from leaves other than the winner too, over several levels.
+TEST(TournamentTree8Test, RandomReplace) {
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<uint16_t> keys(0, 65535);
+  for (size_t n : {1, 8, 9, 64, 65, 1000}) {
+    std::uniform_int_distribution<size_t> leaves(0, n - 1);
+    TournamentTree8 t;
+    std::vector<uint16_t> model(n);
+    t.extend(n);
+    for (size_t i = 0; i < n; ++i) {
+      model[i] = keys(gen);
+      t.set_entry(i, Entry(model[i], i));
+    }
+    t.heapify();
+    for (int r = 0; r < 1000; ++r) {
+      size_t i = leaves(gen);
+      model[i] = keys(gen);
+      t.push_down(model[i], i, i);
+      EXPECT_EQ(*std::min_element(model.begin(), model.end()), t.top_entry().first);
+      EXPECT_EQ(t.top_entry().first, model[t.top_entry().second]);
+    }
+  }
+}
+
+TEST(TournamentTree8Test, PopAllMax) {
+  TournamentTree8 t;
+  size_t const n = 100;
+  t.extend(n);
+  for (size_t i = 0; i < n; ++i) t.set_entry(i, Entry(65535, i));
+  t.heapify();
+  std::vector<bool> seen(n);
+  while (t.size() > 0) {
+    Entry e = t.pop_entry();
+    EXPECT_EQ(65535, e.first);
+    EXPECT_FALSE(seen[e.second]);
+    seen[e.second] = true;
+  }
+  EXPECT_EQ(n, std::count(seen.begin(), seen.end(), true));
+}
+
+} // namespace
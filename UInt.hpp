@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <limits>
+
+// N bit unsigned integer in (N + 7) / 8 bytes with conversions to and from
+// uint64_t, generalizing U48. Conversions keep the low N bits.
+template<unsigned N> struct UInt {
+  static_assert(17 <= N && N <= 63, "use uint16_t, uint32_t or uint64_t");
+  static constexpr unsigned kBits = N;
+  static constexpr unsigned kBytes = (N + 7) / 8;
+  static constexpr uint64_t kMask = (uint64_t(1) << N) - 1;
+  std::array<uint8_t, kBytes> bytes;
+  UInt() = default;
+  constexpr UInt(uint64_t u) : bytes{} {
+    u &= kMask;
+    for (unsigned i = 0; i < kBytes; ++i) bytes[i] = uint8_t(u >> (8 * i));
+  }
+  constexpr operator uint64_t() const {
+    uint64_t u = 0;
+    for (unsigned i = 0; i < kBytes; ++i) u |= uint64_t(bytes[i]) << (8 * i);
+    return u;
+  }
+};
+
+namespace std {
+  template<unsigned N> class numeric_limits<UInt<N>> {
+   public:
+    static constexpr UInt<N> max() { return UInt<N>::kMask; }
+  };
+}
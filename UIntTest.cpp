@@ -0,0 +1,42 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main UIntTest.cpp
+   ./a.out
+*/
+
+#include "UInt.hpp"
+#include <cstdint>
+#include <limits>
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(UInt, sizes) {
+  EXPECT_EQ(3, sizeof(UInt<17>));
+  EXPECT_EQ(3, sizeof(UInt<24>));
+  EXPECT_EQ(5, sizeof(UInt<33>));
+  EXPECT_EQ(6, sizeof(UInt<48>));
+  EXPECT_EQ(8, sizeof(UInt<63>));
+}
+
+template<unsigned N>
+void testConversions() {
+  constexpr uint64_t mask = (uint64_t(1) << N) - 1;
+  EXPECT_EQ(42, static_cast<UInt<N>>(42));
+  EXPECT_EQ(42, static_cast<UInt<N>>(42 + (uint64_t(42) << N)));
+  EXPECT_EQ(mask, std::numeric_limits<UInt<N>>::max());
+  EXPECT_EQ(0, static_cast<UInt<N>>(mask + 1));
+  EXPECT_EQ(mask, static_cast<UInt<N>>(std::numeric_limits<uint64_t>::max()));
+  EXPECT_EQ(0x0123456789abcdef & mask, static_cast<UInt<N>>(0x0123456789abcdef));
+}
+
+TEST(UInt, conversions) {
+  testConversions<17>();
+  testConversions<31>();
+  testConversions<40>();
+  testConversions<48>();
+  testConversions<57>();
+  testConversions<63>();
+}
+
+} // namespace
@@ -2,7 +2,12 @@
    gcc -g -std=c11 -msse4 -c h8.c # optimize with -O2 -DNDEBUG
 */
 
+#ifdef __linux__
+#define _GNU_SOURCE // mremap, MAP_HUGETLB
+#endif
+
 #include "h8.h"
+#include "h8_inline.h"
 #include "minpos.h"
 #include "v128.h"
 #include "align.h"
@@ -15,11 +20,15 @@
 #include <stdnoreturn.h> // noreturn
 #include <stdlib.h> // exit
 #include <string.h> // memcpy
+#include <sys/mman.h> // mmap, mremap, munmap, madvise
+#include <unistd.h> // sysconf
 
 //// Private constants: ////
 
 #define VALUE_MAX UINT16_MAX
 #define ALIGN 16 // H8_ARITY * sizeof(h8_value_type)
+#define HUGE_PAGE_SIZE ((size_t)2 << 20) // x86-64 2MB pages
+#define MAPPED (H8_HEAP_MMAP | H8_HEAP_HUGETLB)
 
 // From https://en.wikibooks.org/wiki/C_Programming/Preprocessor_directives_and_macros
 #define num2str(x) str(x)
@@ -41,33 +50,159 @@ static_assert(sizeof(v128) == H8_ARITY * sizeof(h8_value_type),
 
 //// Private functions: ////
 
-static size_t parent(size_t q) { return (q / H8_ARITY) - 1; }
+static size_t page_size(void) {
+  static size_t size = 0;
+  if (size == 0) size = (size_t)sysconf(_SC_PAGESIZE);
+  return size;
+}
 
-static size_t children(size_t p) { return (p + 1) * H8_ARITY; }
+// Rounds a mapping up to whole pages, and to whole huge pages if it is at
+// least one huge page large or if huge pages are mandatory with MAP_HUGETLB.
+static size_t map_bytes(unsigned flags, size_t num_bytes) {
+  if ((flags & H8_HEAP_HUGETLB) || num_bytes >= HUGE_PAGE_SIZE) {
+    return align_up(num_bytes, HUGE_PAGE_SIZE);
+  }
+  return align_up(num_bytes, page_size());
+}
 
-static void heap_vector_set(h8_heap* h, size_t p, v128 v) {
-  assert(is_aligned(p, H8_ARITY));
-  assert(p + 8 <= h->capacity);
-  *(v128*)(h->array + p) = v;
+static void* map_new(unsigned flags, size_t num_bytes) {
+  int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+  if (flags & H8_HEAP_PREFAULT) map_flags |= MAP_POPULATE;
+#endif
+  void* ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (flags & H8_HEAP_HUGETLB) {
+    ptr = mmap(NULL, num_bytes, PROT_READ | PROT_WRITE, map_flags | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (ptr == MAP_FAILED) {
+    ptr = mmap(NULL, num_bytes, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+  }
+  return ptr == MAP_FAILED ? NULL : ptr;
 }
 
-static minpos_type heap_vector_minpos(h8_heap const* h, size_t p) {
-  assert(is_aligned(p, H8_ARITY));
-  assert(p < h->size);
-  return minpos8(h->array + p);
+// Touches the bytes [from, to) of the array so the kernel allocates pages.
+static void prefault(h8_heap* h, size_t from, size_t to) {
+  if (from >= to) return;
+  char* bytes = (char*)h->array;
+#ifdef MADV_POPULATE_WRITE
+  if (h->flags & MAPPED) {
+    size_t begin = align_down(from, page_size());
+    if (madvise(bytes + begin, to - begin, MADV_POPULATE_WRITE) == 0) return;
+  }
+#endif
+  // Bytes past the padded size are unused so we are free to overwrite them.
+  for (size_t i = from; i < to; i = align_down(i, page_size()) + page_size()) {
+    bytes[i] = 0;
+  }
+}
+
+// Moves the array to a memory block of new_capacity values.
+// Precondition: new_capacity >= align_up(h->size, H8_ARITY).
+static bool heap_realloc(h8_heap* h, size_t new_capacity) {
+  if (h->flags & H8_HEAP_BORROWED) return false;
+  size_t padded_size = align_up(h->size, H8_ARITY);
+  // Guaranteed to not overflow/wrap-around or exceed SIZE_MAX because
+  // new_capacity <= H8_SIZE_MAX <= SIZE_MAX / sizeof(h8_value_type).
+  size_t num_bytes = new_capacity * sizeof(h8_value_type);
+  h8_value_type* new_array;
+  if (h->flags & MAPPED) {
+    size_t old_bytes = h->capacity * sizeof(h8_value_type);
+    if (num_bytes > SIZE_MAX - HUGE_PAGE_SIZE) return false;
+    num_bytes = map_bytes(h->flags, num_bytes);
+    new_array = NULL;
+#ifdef __linux__
+    if (h->array) {
+      void* ptr = mremap(h->array, old_bytes, num_bytes, MREMAP_MAYMOVE);
+      // mremap can fail for MAP_HUGETLB mappings on older kernels,
+      // then we fall through to copying.
+      if (ptr != MAP_FAILED) new_array = (h8_value_type*)ptr;
+    }
+#endif
+    if (!new_array) {
+      new_array = (h8_value_type*)map_new(h->flags, num_bytes);
+      if (!new_array) return false;
+      if (h->array) {
+        memcpy(new_array, h->array, padded_size * sizeof(h8_value_type));
+        munmap(h->array, old_bytes);
+      }
+    }
+#ifdef MADV_HUGEPAGE
+    // Ignored if the mapping already has huge pages from MAP_HUGETLB.
+    if (num_bytes >= HUGE_PAGE_SIZE) madvise(new_array, num_bytes, MADV_HUGEPAGE);
+#endif
+  } else {
+    new_array = (h8_value_type*)aligned_alloc(ALIGN, num_bytes);
+    if (!new_array) return false;
+    // TODO(soren): Measure if it's faster to utilize that we copy an integral
+    // number of aligned v128s, e.g. with SSE instructions.
+    memcpy(new_array, h->array, padded_size * sizeof(h8_value_type));
+    free(h->array);
+  }
+  h->array = new_array;
+  h->capacity = num_bytes / sizeof(h8_value_type);
+  if (h->flags & H8_HEAP_PREFAULT) {
+    prefault(h, padded_size * sizeof(h8_value_type),
+             h->capacity * sizeof(h8_value_type));
+  }
+  return true;
 }
 
 //// Public functions: ////
 
 void h8_heap_init(h8_heap* h) {
+  h8_heap_init_flags(h, 0);
+}
+
+void h8_heap_init_flags(h8_heap* h, unsigned flags) {
   h->array = NULL;
   h->capacity = 0;
   h->size = 0;
+  h->flags = flags;
 }
 
 void h8_heap_clear(h8_heap* h) {
-  free(h->array);
-  h8_heap_init(h);
+  if (h->flags & H8_HEAP_BORROWED) {
+    // The caller owns the array.
+  } else if (h->flags & MAPPED) {
+    if (h->array) munmap(h->array, h->capacity * sizeof(h8_value_type));
+  } else {
+    free(h->array);
+  }
+  h8_heap_init_flags(h, h->flags & ~H8_HEAP_BORROWED);
+}
+
+bool h8_heap_adopt(h8_heap* h, h8_value_type* array, size_t size, size_t capacity) {
+  if (!is_aligned((size_t)array, ALIGN)) return false;
+  if (capacity > H8_SIZE_MAX) capacity = H8_SIZE_MAX;
+  // Whole vectors only, so that extend never pads beyond capacity.
+  capacity = align_down(capacity, H8_ARITY);
+  if (align_up(size, H8_ARITY) > capacity) return false;
+  h8_heap_clear(h);
+  h->array = array;
+  h->capacity = capacity;
+  h->size = size;
+  h->flags |= H8_HEAP_BORROWED;
+  for (size_t i = size; !is_aligned(i, H8_ARITY); ++i) {
+    array[i] = VALUE_MAX;
+  }
+  h8_heap_heapify(h);
+  return true;
+}
+
+h8_value_type* h8_heap_release(h8_heap* h) {
+  h8_value_type* array = h->array;
+  h8_heap_init_flags(h, h->flags & ~H8_HEAP_BORROWED);
+  return array;
+}
+
+bool h8_heap_reserve(h8_heap* h, size_t n) {
+  if (n > H8_SIZE_MAX) return false;
+  if (n <= h->capacity) return true;
+  // align_up(n, H8_ARITY) <= H8_SIZE_MAX because H8_SIZE_MAX is a multiple
+  // of H8_ARITY.
+  return heap_realloc(h, align_up(n, H8_ARITY));
 }
 
 h8_value_type* h8_heap_extend(h8_heap* h, size_t n) {
@@ -89,146 +224,45 @@ h8_value_type* h8_heap_extend(h8_heap* h, size_t n) {
       if (new_capacity < padded_new_size) {
         new_capacity = padded_new_size;
       }
-      // Guaranteed to not overflow/wrap-around or exceed SIZE_MAX because
-      // new_capacity <= H8_SIZE_MAX <= SIZE_MAX / sizeof(h8_value_type).
-      size_t num_bytes = new_capacity * sizeof(h8_value_type);
-      h8_value_type* new_array = (h8_value_type*)aligned_alloc(ALIGN, num_bytes);
-      if (!new_array) return NULL;
-      // TODO(soren): Measure if it's faster to utilize that we copy an integral
-      // number of aligned v128s, e.g. with SSE instructions.
-      memcpy(new_array, h->array, padded_size * sizeof(h8_value_type));
-      free(h->array);
-      h->array = new_array;
-      h->capacity = new_capacity;
+      if (!heap_realloc(h, new_capacity)) return NULL;
     }
     // Unnecessary if new_size == padded_new_size but we just do it always.
-    heap_vector_set(h, padded_new_size - H8_ARITY, kV128Max);
+    h8i_vector_set(h, padded_new_size - H8_ARITY, kV128Max);
   }
   h->size = new_size;
   return h->array + new_size - n;
 }
 
+// The remaining functions are defined in h8_inline.h.
+
 void h8_heap_pull_up(h8_heap* h, h8_value_type b, size_t q) {
-  assert(q < h->size);
-  while (q >= H8_ARITY) {
-    size_t p = parent(q);
-    h8_value_type a = h->array[p];
-    if (a <= b) break;
-    h->array[q] = a;
-    q = p;
-  }
-  h->array[q] = b;
+  h8i_heap_pull_up(h, b, q);
 }
 
 void h8_heap_push_down(h8_heap* h, h8_value_type a, size_t p) {
-  assert(p < h->size);
-  while (true) {
-    size_t q = children(p);
-    if (q >= h->size) break;
-    minpos_type x = heap_vector_minpos(h, q);
-    h8_value_type b = minpos_min(x);
-    if (a <= b) break;
-    h->array[p] = b;
-    p = q + minpos_pos(x);
-  }
-  h->array[p] = a;
+  h8i_heap_push_down(h, a, p);
 }
 
 void h8_heap_heapify(h8_heap* h) {
-  if (h->size <= H8_ARITY) return;
-
-  size_t q = align_down(h->size - 1, H8_ARITY);
-
-  // The first while loop is an optimization for the bottom level of the heap,
-  // inlining the call to heap_push_down which is trivial at the bottom level.
-  // Here "bottom level" means the 8-vectors without children.
-  size_t r = parent(q);
-  while (q > r) {
-    minpos_type x = heap_vector_minpos(h, q);
-    h8_value_type b = minpos_min(x);
-    size_t p = parent(q);
-    h8_value_type a = h->array[p];
-    if (b < a) {
-      h->array[p] = b;
-      // The next line inlines heap_push_down(h, a, q + minpos_pos(x))
-      // with the knowledge that children(q) >= h->size.
-      h->array[q + minpos_pos(x)] = a;
-    }
-    q -= H8_ARITY;
-  }
-
-  while (q > 0) {
-    minpos_type x = heap_vector_minpos(h, q);
-    h8_value_type b = minpos_min(x);
-    size_t p = parent(q);
-    h8_value_type a = h->array[p];
-    if (b < a) {
-      h->array[p] = b;
-      h8_heap_push_down(h, a, q + minpos_pos(x));
-    }
-    q -= H8_ARITY;
-  }
+  h8i_heap_heapify(h);
 }
 
 bool h8_heap_is_heap(h8_heap const* h) {
-  if (h->size <= H8_ARITY) return true;
-  size_t q = align_down(h->size - 1, H8_ARITY);
-  while (q > 0) {
-    minpos_type x = heap_vector_minpos(h, q);
-    h8_value_type b = minpos_min(x);
-    size_t p = parent(q);
-    h8_value_type a = h->array[p];
-    if (b < a) return false;
-    q -= H8_ARITY;
-  }
-  return true;
+  return h8i_heap_is_heap(h);
 }
 
 bool h8_heap_push(h8_heap* h, h8_value_type b) {
-  if (!h8_heap_extend(h, 1)) {
-    return false;
-  }
-  h8_heap_pull_up(h, b, h->size - 1);
-  return true;
+  return h8i_heap_push(h, b);
 }
 
 h8_value_type h8_heap_top(h8_heap const* h) {
-  assert(h->size > 0);
-  minpos_type x = heap_vector_minpos(h, 0);
-  return minpos_min(x);
+  return h8i_heap_top(h);
 }
 
 h8_value_type h8_heap_pop(h8_heap* h) {
-  assert(h->size > 0);
-  minpos_type x = heap_vector_minpos(h, 0);
-  h8_value_type b = minpos_min(x);
-  h8_value_type a = h->array[h->size - 1];
-  h->array[h->size - 1] = VALUE_MAX;
-  h->size--;
-  size_t p = minpos_pos(x);
-  if (p != h->size) {
-    h8_heap_push_down(h, a, p);
-  }
-  return b;
+  return h8i_heap_pop(h);
 }
 
 void h8_heap_sort(h8_heap* h) {
-  v128 v = kV128Max;
-  size_t x = h->size;
-  size_t i = x % H8_ARITY;
-  x -= i;
-  if (i != 0) {
-    do {
-      --i;
-      v.values[i] = h8_heap_pop(h);
-    } while (i > 0);
-    heap_vector_set(h, x, v);
-  }
-  while (x > 0) {
-    x -= H8_ARITY;
-    for (size_t j = H8_ARITY; j > 0; --j) {
-      v.values[j - 1] = h8_heap_pop(h);
-    }
-    heap_vector_set(h, x, v);
-  }
+  h8i_heap_sort(h);
 }
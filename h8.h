@@ -9,12 +9,29 @@ typedef uint16_t h8_value_type;
 #define H8_ARITY 8
 #define H8_SIZE_MAX ((SIZE_MAX / sizeof(h8_value_type)) & ~(H8_ARITY - 1))
 
+// Allocation flags for h8_heap_init_flags.
+//
+// H8_HEAP_MMAP allocates the array with anonymous mmap, advises the kernel to
+// back it with transparent huge pages, and grows it with mremap (on Linux)
+// instead of allocating a new block and copying.
+// H8_HEAP_HUGETLB is like H8_HEAP_MMAP but first tries MAP_HUGETLB, which
+// needs reserved huge pages (vm.nr_hugepages), and falls back to H8_HEAP_MMAP.
+// H8_HEAP_PREFAULT populates new memory when the capacity grows so that page
+// faults are taken up front, e.g. in h8_heap_reserve, not in push or pop.
+#define H8_HEAP_MMAP 1u
+#define H8_HEAP_HUGETLB 2u
+#define H8_HEAP_PREFAULT 4u
+// Set by h8_heap_adopt while the array is owned by the caller. Such a heap
+// never reallocates: it can't grow beyond the adopted capacity.
+#define H8_HEAP_BORROWED 8u
+
 typedef struct {
   // The empty heap is represented by NULL if capacity is zero,
   // otherwise heap points to a memory block of size capacity.
   h8_value_type* array;
   size_t capacity;
   size_t size;
+  unsigned flags; // H8_HEAP_* allocation flags
 } h8_heap;
 
 #ifdef __cplusplus
@@ -23,8 +40,36 @@ extern "C" {
 
 void h8_heap_init(h8_heap* h);
 
+// Like h8_heap_init but with the given H8_HEAP_* allocation flags.
+void h8_heap_init_flags(h8_heap* h, unsigned flags);
+
+// Frees the array. The allocation flags are kept.
 void h8_heap_clear(h8_heap* h);
 
+// Grows the capacity to at least n values without changing the size.
+// With H8_HEAP_PREFAULT the new memory is populated.
+// Returns false if memory allocation fails or n > H8_SIZE_MAX.
+bool h8_heap_reserve(h8_heap* h, size_t n);
+
+// Makes h a heap over the caller's array without copying. The array must be
+// 16 byte aligned and hold capacity values of which the first size are the
+// heap values. The positions from size up to the next multiple of H8_ARITY
+// are overwritten with UINT16_MAX padding so capacity must leave room for
+// them. The array is heapified in place. Any previous array is freed.
+//
+// The heap can shrink and grow within capacity but never reallocates, so
+// h8_heap_extend and h8_heap_push fail when they would exceed capacity.
+// Returns false without adopting if the array is misaligned or too small.
+bool h8_heap_adopt(h8_heap* h, h8_value_type* array, size_t size, size_t capacity);
+
+// Hands the array back to the caller and resets h to the empty heap with its
+// allocation flags, including h->size and h->capacity, so read them before
+// the call if needed. An adopted array is the caller's own; otherwise the
+// caller must release it with free, or if h was initialized with H8_HEAP_MMAP
+// or H8_HEAP_HUGETLB with munmap of the h->capacity values read before the
+// call.
+h8_value_type* h8_heap_release(h8_heap* h);
+
 // Increases heap by n consecutive value positions at the end and returns a
 // pointer to the first of those positions.
 //
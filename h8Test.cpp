@@ -19,6 +19,7 @@
 
 #include "h8.h"
 #include <cstddef>
+#include <sys/mman.h> // munmap
 #include <limits>
 #include <gtest/gtest.h>
 
@@ -36,6 +37,17 @@ TEST(h8, heap_init) {
   EXPECT_EQ(0, h.size);
 }
 
+TEST(h8, heap_init_flags) {
+  h8_heap h;
+  h8_heap_init_flags(&h, H8_HEAP_MMAP);
+  EXPECT_EQ(nullptr, h.array);
+  EXPECT_EQ(0, h.capacity);
+  EXPECT_EQ(0, h.size);
+  EXPECT_EQ(H8_HEAP_MMAP, h.flags);
+  h8_heap_clear(&h);
+  EXPECT_EQ(H8_HEAP_MMAP, h.flags);
+}
+
 TEST(h8, heap_clear) {
   h8_heap h;
   h8_heap_init(&h);
@@ -57,6 +69,21 @@ TEST(h8, heap_extend) {
   h8_heap_clear(&h);
 }
 
+TEST(h8, heap_reserve) {
+  h8_heap h;
+  h8_heap_init(&h);
+  EXPECT_TRUE(h8_heap_push(&h, 42));
+  EXPECT_TRUE(h8_heap_reserve(&h, 1000));
+  EXPECT_GE(h.capacity, 1000);
+  EXPECT_EQ(1, h.size);
+  EXPECT_EQ(42, h8_heap_top(&h));
+  h8_value_type* array = h.array;
+  EXPECT_NE(nullptr, h8_heap_extend(&h, 999));
+  EXPECT_EQ(array, h.array);
+  EXPECT_FALSE(h8_heap_reserve(&h, H8_SIZE_MAX + 1));
+  h8_heap_clear(&h);
+}
+
 TEST(h8, heap_extend_too_much) {
   h8_heap h;
   h8_heap_init(&h);
@@ -132,4 +159,85 @@ TEST(h8, heap_push_100) {
   h8_heap_clear(&h);
 }
 
+TEST(h8, heap_adopt) {
+  size_t const n = 100;
+  alignas(16) h8_value_type array[104 + 8];
+  for (size_t i = 0; i < n; ++i) array[i] = n - 1 - i;
+  h8_heap h;
+  h8_heap_init(&h);
+  EXPECT_TRUE(h8_heap_push(&h, 42)); // freed by adopt
+  EXPECT_TRUE(h8_heap_adopt(&h, array, n, 104));
+  EXPECT_EQ(array, h.array);
+  EXPECT_EQ(n, h.size);
+  EXPECT_EQ(104, h.capacity);
+  EXPECT_TRUE(h8_heap_is_heap(&h));
+  EXPECT_EQ(0, h8_heap_top(&h));
+  // Can't grow beyond the adopted capacity.
+  EXPECT_EQ(nullptr, h8_heap_extend(&h, 5));
+  EXPECT_EQ(n, h.size);
+  h8_heap_sort(&h);
+  EXPECT_EQ(array, h8_heap_release(&h));
+  EXPECT_EQ(nullptr, h.array);
+  EXPECT_EQ(0, h.capacity);
+  for (size_t i = 0; i < n; ++i) EXPECT_EQ(n - 1 - i, array[i]);
+  h8_heap_clear(&h);
+}
+
+TEST(h8, heap_adopt_invalid) {
+  alignas(16) h8_value_type array[24];
+  h8_heap h;
+  h8_heap_init(&h);
+  EXPECT_FALSE(h8_heap_adopt(&h, array + 1, 8, 16)); // misaligned
+  EXPECT_FALSE(h8_heap_adopt(&h, array, 9, 15)); // no room for padding
+  EXPECT_TRUE(h8_heap_adopt(&h, array, 9, 23));
+  EXPECT_EQ(16, h.capacity);
+  EXPECT_EQ(UINT16_MAX, array[15]);
+  h8_heap_clear(&h);
+  EXPECT_EQ(nullptr, h.array);
+  EXPECT_EQ(0, h.flags);
+}
+
+// The released array of a mapped heap is unmapped with the capacity read
+// before the release.
+TEST(h8, heap_mmap_release) {
+  h8_heap h;
+  h8_heap_init_flags(&h, H8_HEAP_MMAP);
+  for (size_t i = 0; i < 1000; ++i) EXPECT_TRUE(h8_heap_push(&h, i));
+  size_t capacity = h.capacity;
+  EXPECT_LE(1000, capacity);
+  h8_value_type* array = h8_heap_release(&h);
+  EXPECT_EQ(nullptr, h.array);
+  EXPECT_EQ(0, h.capacity);
+  EXPECT_EQ(H8_HEAP_MMAP, h.flags);
+  EXPECT_EQ(0, array[0]);
+  EXPECT_EQ(0, munmap(array, capacity * sizeof(h8_value_type)));
+}
+
+TEST(h8, heap_mmap_push_pop) {
+  for (unsigned flags : {H8_HEAP_MMAP, H8_HEAP_HUGETLB,
+                         H8_HEAP_MMAP | H8_HEAP_PREFAULT}) {
+    h8_heap h;
+    h8_heap_init_flags(&h, flags);
+    // 2.4MB of values grows the mapping past a 2MB huge page, so the
+    // HUGETLB heap grows from one huge page to two.
+    size_t const n = 1200000;
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_TRUE(h8_heap_push(&h, (n - 1 - i) % 65536));
+    }
+    EXPECT_GT(h.capacity * sizeof(h8_value_type), (size_t)2 << 20);
+    EXPECT_TRUE(h8_heap_is_heap(&h));
+    EXPECT_TRUE(h8_heap_reserve(&h, 4 * n));
+    EXPECT_GE(h.capacity, 4 * n);
+    EXPECT_TRUE(h8_heap_is_heap(&h));
+    h8_value_type prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+      h8_value_type x = h8_heap_pop(&h);
+      EXPECT_LE(prev, x);
+      prev = x;
+    }
+    h8_heap_clear(&h);
+    EXPECT_EQ(nullptr, h.array);
+  }
+}
+
 } // namespace
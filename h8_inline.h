@@ -0,0 +1,164 @@
+#pragma once
+
+#include "h8.h"
+#include "minpos.h"
+#include "v128.h"
+#include "align.h"
+#include <assert.h> // assert
+#include <stdbool.h> // bool
+#include <stddef.h> // size_t
+#include <stdint.h> // UINT16_MAX
+
+// Static inline definitions of the h8_heap operations that don't allocate,
+// named h8i_heap_* instead of h8_heap_*, so that the compiler can inline
+// them into the caller's loops. h8i_heap_push only calls out of line to
+// h8_heap_extend when the array is full. h8.c defines the h8_heap_*
+// functions with these.
+
+static inline size_t h8i_parent(size_t q) { return (q / H8_ARITY) - 1; }
+
+static inline size_t h8i_children(size_t p) { return (p + 1) * H8_ARITY; }
+
+static inline void h8i_vector_set(h8_heap* h, size_t p, v128 v) {
+  assert(is_aligned(p, H8_ARITY));
+  assert(p + H8_ARITY <= h->capacity);
+  *(v128*)(h->array + p) = v;
+}
+
+static inline minpos_type h8i_vector_minpos(h8_heap const* h, size_t p) {
+  assert(is_aligned(p, H8_ARITY));
+  assert(p < h->size);
+  return minpos8(h->array + p);
+}
+
+static inline void h8i_heap_pull_up(h8_heap* h, h8_value_type b, size_t q) {
+  assert(q < h->size);
+  while (q >= H8_ARITY) {
+    size_t p = h8i_parent(q);
+    h8_value_type a = h->array[p];
+    if (a <= b) break;
+    h->array[q] = a;
+    q = p;
+  }
+  h->array[q] = b;
+}
+
+static inline void h8i_heap_push_down(h8_heap* h, h8_value_type a, size_t p) {
+  assert(p < h->size);
+  while (true) {
+    size_t q = h8i_children(p);
+    if (q >= h->size) break;
+    minpos_type x = h8i_vector_minpos(h, q);
+    h8_value_type b = minpos_min(x);
+    if (a <= b) break;
+    h->array[p] = b;
+    p = q + minpos_pos(x);
+  }
+  h->array[p] = a;
+}
+
+static inline void h8i_heap_heapify(h8_heap* h) {
+  if (h->size <= H8_ARITY) return;
+
+  size_t q = align_down(h->size - 1, H8_ARITY);
+
+  // The first while loop is an optimization for the bottom level of the heap,
+  // inlining the call to heap_push_down which is trivial at the bottom level.
+  // Here "bottom level" means the 8-vectors without children.
+  size_t r = h8i_parent(q);
+  while (q > r) {
+    minpos_type x = h8i_vector_minpos(h, q);
+    h8_value_type b = minpos_min(x);
+    size_t p = h8i_parent(q);
+    h8_value_type a = h->array[p];
+    if (b < a) {
+      h->array[p] = b;
+      // The next line inlines heap_push_down(h, a, q + minpos_pos(x))
+      // with the knowledge that children(q) >= h->size.
+      h->array[q + minpos_pos(x)] = a;
+    }
+    q -= H8_ARITY;
+  }
+
+  while (q > 0) {
+    minpos_type x = h8i_vector_minpos(h, q);
+    h8_value_type b = minpos_min(x);
+    size_t p = h8i_parent(q);
+    h8_value_type a = h->array[p];
+    if (b < a) {
+      h->array[p] = b;
+      h8i_heap_push_down(h, a, q + minpos_pos(x));
+    }
+    q -= H8_ARITY;
+  }
+}
+
+static inline bool h8i_heap_is_heap(h8_heap const* h) {
+  if (h->size <= H8_ARITY) return true;
+  size_t q = align_down(h->size - 1, H8_ARITY);
+  while (q > 0) {
+    minpos_type x = h8i_vector_minpos(h, q);
+    h8_value_type b = minpos_min(x);
+    size_t p = h8i_parent(q);
+    h8_value_type a = h->array[p];
+    if (b < a) return false;
+    q -= H8_ARITY;
+  }
+  return true;
+}
+
+static inline bool h8i_heap_push(h8_heap* h, h8_value_type b) {
+  size_t size = h->size;
+  if (!is_aligned(size, H8_ARITY)) {
+    // The last vector is already padded.
+    h->size = size + 1;
+  } else if (size + H8_ARITY <= h->capacity) {
+    h8i_vector_set(h, size, kV128Max);
+    h->size = size + 1;
+  } else if (!h8_heap_extend(h, 1)) {
+    return false;
+  }
+  h8i_heap_pull_up(h, b, size);
+  return true;
+}
+
+static inline h8_value_type h8i_heap_top(h8_heap const* h) {
+  assert(h->size > 0);
+  minpos_type x = h8i_vector_minpos(h, 0);
+  return minpos_min(x);
+}
+
+static inline h8_value_type h8i_heap_pop(h8_heap* h) {
+  assert(h->size > 0);
+  minpos_type x = h8i_vector_minpos(h, 0);
+  h8_value_type b = minpos_min(x);
+  h8_value_type a = h->array[h->size - 1];
+  h->array[h->size - 1] = UINT16_MAX;
+  h->size--;
+  size_t p = minpos_pos(x);
+  if (p != h->size) {
+    h8i_heap_push_down(h, a, p);
+  }
+  return b;
+}
+
+static inline void h8i_heap_sort(h8_heap* h) {
+  v128 v = kV128Max;
+  size_t x = h->size;
+  size_t i = x % H8_ARITY;
+  x -= i;
+  if (i != 0) {
+    do {
+      --i;
+      v.values[i] = h8i_heap_pop(h);
+    } while (i > 0);
+    h8i_vector_set(h, x, v);
+  }
+  while (x > 0) {
+    x -= H8_ARITY;
+    for (size_t j = H8_ARITY; j > 0; --j) {
+      v.values[j - 1] = h8i_heap_pop(h);
+    }
+    h8i_vector_set(h, x, v);
+  }
+}
@@ -0,0 +1,327 @@
+/*
+   gcc -g -std=c11 -msse4 -c h8file.c # optimize with -O2 -DNDEBUG
+*/
+
+#ifdef __linux__
+#define _GNU_SOURCE // mremap
+#endif
+
+#include "h8file.h"
+#include "h8.h"
+#include "h8_inline.h"
+#include "align.h"
+#include <assert.h> // assert, static_assert
+#include <errno.h> // errno, EINVAL
+#include <fcntl.h> // open, O_RDWR, O_CREAT
+#include <stdbool.h> // bool
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint16_t, uint64_t, UINT16_MAX
+#include <stdlib.h> // free, realloc
+#include <string.h> // memcmp, memcpy, memset
+#include <sys/mman.h> // mmap, mremap, munmap, msync
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, ftruncate, sysconf
+
+//// Private constants: ////
+
+#define VALUE_MAX UINT16_MAX
+#define HEADER_SIZE H8_FILE_HEADER_SIZE
+
+static char const kMagic[8] = "8heap";
+
+static_assert(sizeof(h8_file_header) <= HEADER_SIZE,
+              "h8_file_header must fit in the header page");
+static_assert(HEADER_SIZE % 16 == 0,
+              "the array after the header must be v128 aligned");
+
+//// Private functions: ////
+
+static h8_value_type* file_array(h8_file_header* header) {
+  return (h8_value_type*)((char*)header + HEADER_SIZE);
+}
+
+static size_t page_size(void) {
+  static size_t size = 0;
+  if (size == 0) size = (size_t)sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+static bool header_is_valid(h8_file_header const* header, size_t file_bytes) {
+  return memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+         header->version == H8_FILE_VERSION &&
+         header->arity == H8_ARITY &&
+         header->key_size == sizeof(h8_value_type) &&
+         is_aligned(header->capacity, H8_ARITY) &&
+         header->capacity <= (file_bytes - HEADER_SIZE) / sizeof(h8_value_type) &&
+         header->size <= header->capacity;
+}
+
+// The page of the mapping with the value at position i.
+static size_t value_page(size_t i) {
+  return (HEADER_SIZE + i * sizeof(h8_value_type)) / page_size();
+}
+
+static void mark_page(h8_file* f, size_t page) {
+  f->dirty_pages[page / 64] |= (uint64_t)1 << (page % 64);
+}
+
+// Records that the value at position i was written.
+static void touched_value(h8_file* f, size_t i) {
+  mark_page(f, value_page(i));
+}
+
+// Records that the values [begin, end) were written and that the heap
+// size may have changed.
+static void touched(h8_file* f, size_t begin, size_t end) {
+  f->header->dirty = 1;
+  f->header->size = f->heap.size;
+  if (begin >= end) return;
+  for (size_t page = value_page(begin), last = value_page(end - 1); page <= last; ++page) {
+    mark_page(f, page);
+  }
+}
+
+// The first page from page on that is dirty, or clean if !dirty, or
+// dirty_words * 64 if there is none.
+static size_t next_dirty_page(h8_file const* f, size_t page, bool dirty) {
+  size_t w = page / 64;
+  if (w >= f->dirty_words) return f->dirty_words * 64;
+  uint64_t flip = dirty ? 0 : ~(uint64_t)0;
+  uint64_t bits = (f->dirty_pages[w] ^ flip) & (~(uint64_t)0 << (page % 64));
+  while (bits == 0) {
+    if (++w == f->dirty_words) return w * 64;
+    bits = f->dirty_pages[w] ^ flip;
+  }
+  return w * 64 + (size_t)__builtin_ctzll(bits);
+}
+
+// Grows the dirty page bitmap to cover a mapping of num_bytes.
+static bool dirty_pages_reserve(h8_file* f, size_t num_bytes) {
+  size_t words = (align_up(num_bytes, page_size()) / page_size() + 63) / 64;
+  if (words <= f->dirty_words) return true;
+  uint64_t* bits = (uint64_t*)realloc(f->dirty_pages, words * sizeof(uint64_t));
+  if (!bits) return false;
+  memset(bits + f->dirty_words, 0, (words - f->dirty_words) * sizeof(uint64_t));
+  f->dirty_pages = bits;
+  f->dirty_words = words;
+  return true;
+}
+
+// Like h8_heap_pull_up and h8_heap_push_down, recording the values written.
+
+static void file_pull_up(h8_file* f, h8_value_type b, size_t q) {
+  h8_heap* h = &f->heap;
+  assert(q < h->size);
+  while (q >= H8_ARITY) {
+    size_t p = h8i_parent(q);
+    h8_value_type a = h->array[p];
+    if (a <= b) break;
+    h->array[q] = a;
+    touched_value(f, q);
+    q = p;
+  }
+  h->array[q] = b;
+  touched_value(f, q);
+}
+
+static void file_push_down(h8_file* f, h8_value_type a, size_t p) {
+  h8_heap* h = &f->heap;
+  assert(p < h->size);
+  while (true) {
+    size_t q = h8i_children(p);
+    if (q >= h->size) break;
+    minpos_type x = h8i_vector_minpos(h, q);
+    h8_value_type b = minpos_min(x);
+    if (a <= b) break;
+    h->array[p] = b;
+    touched_value(f, p);
+    p = q + minpos_pos(x);
+  }
+  h->array[p] = a;
+  touched_value(f, p);
+}
+
+static bool file_map(h8_file* f, size_t num_bytes) {
+  void* ptr = MAP_FAILED;
+  if (f->header) {
+#ifdef __linux__
+    ptr = mremap(f->header, f->mapped_bytes, num_bytes, MREMAP_MAYMOVE);
+#else
+    munmap(f->header, f->mapped_bytes);
+    f->header = NULL;
+#endif
+  }
+  if (ptr == MAP_FAILED && !f->header) {
+    ptr = mmap(NULL, num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+  }
+  if (ptr == MAP_FAILED) return false;
+  f->header = (h8_file_header*)ptr;
+  f->mapped_bytes = num_bytes;
+  f->heap.array = file_array(f->header);
+  return true;
+}
+
+// Grows the file and the mapping to hold at least min_capacity values.
+static bool file_grow(h8_file* f, size_t min_capacity) {
+  if (min_capacity > H8_SIZE_MAX) return false;
+  size_t capacity = f->heap.capacity;
+  size_t new_capacity = capacity <= H8_SIZE_MAX / 2 ? 2 * capacity : H8_SIZE_MAX;
+  if (new_capacity < min_capacity) new_capacity = min_capacity;
+  // Whole pages, which are a multiple of H8_ARITY values.
+  size_t data_bytes = new_capacity * sizeof(h8_value_type);
+  if (data_bytes > SIZE_MAX - HEADER_SIZE - page_size()) return false;
+  data_bytes = align_up(data_bytes, page_size());
+  size_t num_bytes = HEADER_SIZE + data_bytes;
+  if (!dirty_pages_reserve(f, num_bytes)) return false;
+  if (ftruncate(f->fd, (off_t)num_bytes) != 0) return false;
+  if (!file_map(f, num_bytes)) return false;
+  f->heap.capacity = data_bytes / sizeof(h8_value_type);
+  f->header->capacity = f->heap.capacity;
+  return true;
+}
+
+static bool file_reserve(h8_file* f, size_t n) {
+  if (n > H8_SIZE_MAX) return false;
+  size_t padded = align_up(n, H8_ARITY);
+  return padded <= f->heap.capacity || file_grow(f, padded);
+}
+
+// Restores the heap invariant after a process died during a mutation.
+static void file_repair(h8_file* f) {
+  h8_heap* h = &f->heap;
+  for (size_t i = h->size; !is_aligned(i, H8_ARITY); ++i) {
+    h->array[i] = VALUE_MAX;
+  }
+  h8_heap_heapify(h);
+  touched(f, 0, align_up(h->size, H8_ARITY));
+}
+
+//// Public functions: ////
+
+bool h8_file_open(h8_file* f, char const* path) {
+  memset(f, 0, sizeof(*f));
+  f->fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (f->fd < 0) return false;
+  struct stat st;
+  if (fstat(f->fd, &st) != 0) goto fail;
+  bool fresh = st.st_size == 0;
+  if (fresh) {
+    if (ftruncate(f->fd, HEADER_SIZE) != 0) goto fail;
+    st.st_size = HEADER_SIZE;
+  } else if (st.st_size < HEADER_SIZE) {
+    errno = EINVAL;
+    goto fail;
+  }
+  if (!file_map(f, (size_t)st.st_size)) goto fail;
+  if (!dirty_pages_reserve(f, f->mapped_bytes)) goto fail;
+  h8_file_header* header = f->header;
+  if (fresh) {
+    memcpy(header->magic, kMagic, sizeof(kMagic));
+    header->version = H8_FILE_VERSION;
+    header->arity = H8_ARITY;
+    header->key_size = sizeof(h8_value_type);
+    header->dirty = 0;
+    header->size = 0;
+    header->capacity = 0;
+  } else if (!header_is_valid(header, f->mapped_bytes)) {
+    errno = EINVAL;
+    goto fail;
+  }
+  h8_heap_init_flags(&f->heap, H8_HEAP_BORROWED);
+  f->heap.array = file_array(header);
+  f->heap.capacity = header->capacity;
+  f->heap.size = header->size;
+  if (header->dirty) file_repair(f);
+  return true;
+
+fail:
+  {
+    int saved_errno = errno;
+    if (f->header) munmap(f->header, f->mapped_bytes);
+    free(f->dirty_pages);
+    close(f->fd);
+    memset(f, 0, sizeof(*f));
+    f->fd = -1;
+    errno = saved_errno;
+  }
+  return false;
+}
+
+bool h8_file_close(h8_file* f) {
+  bool ok = h8_file_checkpoint(f);
+  munmap(f->header, f->mapped_bytes);
+  free(f->dirty_pages);
+  close(f->fd);
+  memset(f, 0, sizeof(*f));
+  f->fd = -1;
+  return ok;
+}
+
+bool h8_file_checkpoint(h8_file* f) {
+  // Pages count from the start of the mapping, which is page aligned as
+  // msync requires, whether or not the header is a whole page.
+  char* bytes = (char*)f->header;
+  size_t begin = next_dirty_page(f, 0, true);
+  while (begin < f->dirty_words * 64) {
+    size_t end = next_dirty_page(f, begin, false);
+    size_t offset = begin * page_size();
+    size_t length = end * page_size() - offset;
+    if (length > f->mapped_bytes - offset) length = f->mapped_bytes - offset;
+    if (msync(bytes + offset, length, MS_SYNC) != 0) return false;
+    for (size_t page = begin; page < end; ++page) {
+      f->dirty_pages[page / 64] &= ~((uint64_t)1 << (page % 64));
+    }
+    begin = next_dirty_page(f, end, true);
+  }
+  if (!f->header->dirty) return true;
+  // The header is written last so that a clean header implies durable values.
+  f->header->size = f->heap.size;
+  f->header->dirty = 0;
+  return msync(f->header, HEADER_SIZE, MS_SYNC) == 0;
+}
+
+bool h8_file_reserve(h8_file* f, size_t n) {
+  return file_reserve(f, n);
+}
+
+h8_value_type* h8_file_extend(h8_file* f, size_t n) {
+  size_t size = f->heap.size;
+  if (n > H8_SIZE_MAX - size || !file_reserve(f, size + n)) return NULL;
+  h8_value_type* ptr = h8_heap_extend(&f->heap, n);
+  if (ptr) touched(f, size, align_up(f->heap.size, H8_ARITY));
+  return ptr;
+}
+
+void h8_file_heapify(h8_file* f) {
+  h8_heap_heapify(&f->heap);
+  touched(f, 0, f->heap.size);
+}
+
+// Like h8_heap_push and h8_heap_pop, with the sifts above.
+
+bool h8_file_push(h8_file* f, h8_value_type b) {
+  size_t q = f->heap.size;
+  if (!h8_file_extend(f, 1)) return false;
+  file_pull_up(f, b, q);
+  return true;
+}
+
+h8_value_type h8_file_pop(h8_file* f) {
+  h8_heap* h = &f->heap;
+  assert(h->size > 0);
+  minpos_type x = h8i_vector_minpos(h, 0);
+  h8_value_type b = minpos_min(x);
+  size_t last = h->size - 1;
+  h8_value_type a = h->array[last];
+  h->array[last] = VALUE_MAX;
+  h->size = last;
+  touched(f, last, last + 1);
+  size_t p = minpos_pos(x);
+  if (p != last) file_push_down(f, a, p);
+  return b;
+}
+
+void h8_file_clear(h8_file* f) {
+  f->heap.size = 0;
+  touched(f, 0, 0);
+}
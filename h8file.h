@@ -0,0 +1,82 @@
+#pragma once
+
+#include "h8.h"
+#include <stdbool.h> // bool
+#include <stddef.h> // size_t
+#include <stdint.h> // uint16_t, uint32_t, uint64_t
+
+// A h8_heap stored in a memory mapped file so that a process can reopen it
+// in O(1) after a restart instead of rebuilding it.
+//
+// The file starts with a 4K header followed by the heap array. Mutations
+// through the h8_file functions below mark the file dirty, keep the size in
+// the header up to date and record which pages they wrote: a push or pop
+// only writes the pages on its sift path. h8_file_checkpoint flushes those
+// pages and marks the file clean. If the process dies without a checkpoint,
+// the next h8_file_open repairs the heap with heapify because it may have
+// died in the middle of a push or pop.
+
+#define H8_FILE_VERSION 1
+#define H8_FILE_HEADER_SIZE 4096 // the array is v128 aligned after it
+
+typedef struct {
+  char magic[8]; // "8heap\0\0\0"
+  uint32_t version; // H8_FILE_VERSION
+  uint16_t arity; // H8_ARITY
+  uint16_t key_size; // sizeof(h8_value_type)
+  uint32_t dirty; // nonzero if modified since the last checkpoint
+  uint32_t reserved;
+  uint64_t size;
+  uint64_t capacity;
+} h8_file_header;
+
+typedef struct {
+  // Adopted view of the mapped array. Read it with the h8_heap functions,
+  // e.g. h8_heap_top(&f->heap), but mutate it with the h8_file functions.
+  h8_heap heap;
+  h8_file_header* header; // start of the mapping
+  size_t mapped_bytes;
+  // One bit per page of the mapping, set if written since the last
+  // checkpoint.
+  uint64_t* dirty_pages;
+  size_t dirty_words;
+  int fd;
+} h8_file;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Opens the heap file at path, creating an empty heap if the file doesn't
+// exist or is empty. Returns false and sets errno if the file can't be
+// opened or mapped or if it has a header from another version, arity or
+// key type (errno EINVAL).
+bool h8_file_open(h8_file* f, char const* path);
+
+// Checkpoints and closes the file. Returns false if the checkpoint fails,
+// but always releases the mapping and the file descriptor.
+bool h8_file_close(h8_file* f);
+
+// Flushes the dirty pages and then the header to the file with msync, one
+// msync per run of consecutive dirty pages, and marks the file clean. Returns false and sets errno if msync fails.
+bool h8_file_checkpoint(h8_file* f);
+
+// Grows the file to hold at least n values.
+bool h8_file_reserve(h8_file* f, size_t n);
+
+// Like h8_heap_extend, growing the file as needed.
+h8_value_type* h8_file_extend(h8_file* f, size_t n);
+
+void h8_file_heapify(h8_file* f);
+
+// Like h8_heap_push, growing the file as needed.
+bool h8_file_push(h8_file* f, h8_value_type b);
+
+h8_value_type h8_file_pop(h8_file* f);
+
+// Empties the heap without shrinking the file.
+void h8_file_clear(h8_file* f);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,120 @@
+/*
+   brew install google-benchmark
+   gcc -g -std=c11 -msse4 -O2 -DNDEBUG -c h8.c h8file.c &&
+   g++ -g -std=c++17 -msse4 -O2 -DNDEBUG -lbenchmark h8.o h8file.o h8fileBenchmark.cpp
+
+   # compares reopening a heap file with rebuilding the heap from scratch,
+   # the file is written to $TMPDIR (default /tmp)
+   ./a.out
+*/
+
+#include "h8file.h"
+#include "h8.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+// The source of truth that a restarted process would rebuild the heap from.
+std::vector<h8_value_type> source;
+
+std::string heapPath(int64_t sz) {
+  char const* tmpdir = std::getenv("TMPDIR");
+  return std::string(tmpdir ? tmpdir : "/tmp") + "/h8fileBenchmark." + std::to_string(sz);
+}
+
+void initSource(size_t sz) {
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<h8_value_type> distr(0, std::numeric_limits<h8_value_type>::max());
+  source.resize(sz);
+  for (auto& v : source) v = distr(gen);
+}
+
+void bm_rebuild(benchmark::State& state) {
+  size_t sz = state.range(0);
+  if (source.size() < sz) initSource(sz);
+  for (auto _ : state) {
+    h8_heap h;
+    h8_heap_init(&h);
+    h8_value_type* ptr = h8_heap_extend(&h, sz);
+    std::memcpy(ptr, source.data(), sz * sizeof(h8_value_type));
+    h8_heap_heapify(&h);
+    benchmark::DoNotOptimize(h8_heap_top(&h));
+    state.PauseTiming();
+    h8_heap_clear(&h);
+    state.ResumeTiming();
+  }
+}
+
+void bm_reopen(benchmark::State& state) {
+  size_t sz = state.range(0);
+  std::string path = heapPath(sz);
+  std::remove(path.c_str());
+  {
+    if (source.size() < sz) initSource(sz);
+    h8_file f;
+    if (!h8_file_open(&f, path.c_str())) {
+      state.SkipWithError("h8_file_open failed");
+      return;
+    }
+    h8_value_type* ptr = h8_file_extend(&f, sz);
+    std::memcpy(ptr, source.data(), sz * sizeof(h8_value_type));
+    h8_file_heapify(&f);
+    h8_file_close(&f);
+  }
+  for (auto _ : state) {
+    h8_file f;
+    h8_file_open(&f, path.c_str());
+    benchmark::DoNotOptimize(h8_heap_top(&f.heap));
+    h8_file_close(&f);
+  }
+  std::remove(path.c_str());
+}
+
+void bm_checkpoint(benchmark::State& state) {
+  size_t sz = state.range(0);
+  std::string path = heapPath(sz);
+  std::remove(path.c_str());
+  if (source.size() < sz) initSource(sz);
+  h8_file f;
+  if (!h8_file_open(&f, path.c_str())) {
+    state.SkipWithError("h8_file_open failed");
+    return;
+  }
+  h8_value_type* ptr = h8_file_extend(&f, sz);
+  std::memcpy(ptr, source.data(), sz * sizeof(h8_value_type));
+  h8_file_heapify(&f);
+  h8_file_checkpoint(&f);
+  for (auto _ : state) {
+    // A burst of pops and pushes followed by a checkpoint.
+    for (int i = 0; i < 1000; ++i) h8_file_push(&f, h8_file_pop(&f));
+    h8_file_checkpoint(&f);
+  }
+  h8_file_close(&f);
+  std::remove(path.c_str());
+}
+
+// Parameters in ascending order.
+const std::vector<int64_t> kSizes = { 1000000, 10000000, 100000000 };
+
+void Arguments(benchmark::internal::Benchmark* b) {
+  for (int64_t s : kSizes) b->Arg(s);
+}
+
+} // namespace
+
+BENCHMARK(bm_rebuild)->Apply(Arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_reopen)->Apply(Arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_checkpoint)->Apply(Arguments)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+}
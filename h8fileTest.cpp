@@ -0,0 +1,139 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   gcc -g -std=c11 -msse4 -c h8.c h8file.c &&
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main h8.o h8file.o h8fileTest.cpp
+*/
+
+#include "h8file.h"
+#include "h8.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+class H8FileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = testing::TempDir() + "h8fileTest.heap";
+    std::remove(path_.c_str());
+  }
+  void TearDown() override { std::remove(path_.c_str()); }
+  std::string path_;
+};
+
+TEST_F(H8FileTest, create) {
+  h8_file f;
+  ASSERT_TRUE(h8_file_open(&f, path_.c_str()));
+  EXPECT_EQ(0, f.heap.size);
+  EXPECT_EQ(0, f.heap.capacity);
+  EXPECT_TRUE(h8_file_push(&f, 2));
+  EXPECT_TRUE(h8_file_push(&f, 1));
+  EXPECT_TRUE(h8_file_push(&f, 3));
+  EXPECT_EQ(1, h8_heap_top(&f.heap));
+  EXPECT_EQ(1, h8_file_pop(&f));
+  EXPECT_TRUE(h8_file_close(&f));
+}
+
+TEST_F(H8FileTest, reopen) {
+  size_t const n = 100000;
+  h8_file f;
+  ASSERT_TRUE(h8_file_open(&f, path_.c_str()));
+  h8_value_type* ptr = h8_file_extend(&f, n);
+  ASSERT_NE(nullptr, ptr);
+  for (size_t i = 0; i < n; ++i) ptr[i] = (n - 1 - i) % 65536;
+  h8_file_heapify(&f);
+  EXPECT_TRUE(h8_file_close(&f));
+
+  ASSERT_TRUE(h8_file_open(&f, path_.c_str()));
+  EXPECT_EQ(n, f.heap.size);
+  EXPECT_EQ(0, f.header->dirty);
+  EXPECT_TRUE(h8_heap_is_heap(&f.heap));
+  h8_value_type prev = 0;
+  for (size_t i = 0; i < n / 2; ++i) {
+    h8_value_type x = h8_file_pop(&f);
+    EXPECT_LE(prev, x);
+    prev = x;
+  }
+  EXPECT_TRUE(h8_file_checkpoint(&f));
+  EXPECT_EQ(0, f.header->dirty);
+  EXPECT_EQ(n / 2, f.header->size);
+  EXPECT_TRUE(h8_file_close(&f));
+
+  ASSERT_TRUE(h8_file_open(&f, path_.c_str()));
+  EXPECT_EQ(n - n / 2, f.heap.size);
+  EXPECT_LE(prev, h8_heap_top(&f.heap));
+  EXPECT_TRUE(h8_file_close(&f));
+}
+
+size_t dirty_page_count(h8_file const& f) {
+  size_t count = 0;
+  for (size_t w = 0; w < f.dirty_words; ++w) count += __builtin_popcountll(f.dirty_pages[w]);
+  return count;
+}
+
+// A push or pop only dirties the pages on its sift path, not the whole heap.
+TEST_F(H8FileTest, dirty_pages) {
+  size_t const n = 1000000; // about 500 pages of 4K
+  h8_file f;
+  ASSERT_TRUE(h8_file_open(&f, path_.c_str()));
+  h8_value_type* ptr = h8_file_extend(&f, n);
+  ASSERT_NE(nullptr, ptr);
+  for (size_t i = 0; i < n; ++i) ptr[i] = (i * 7919) % 65536;
+  h8_file_heapify(&f);
+  size_t pages = dirty_page_count(f);
+  EXPECT_LE(n * sizeof(h8_value_type) / sysconf(_SC_PAGESIZE), pages);
+  EXPECT_TRUE(h8_file_checkpoint(&f));
+  EXPECT_EQ(0, dirty_page_count(f));
+  // A heap of 1M values has 7 levels of nodes.
+  EXPECT_TRUE(h8_file_push(&f, 0));
+  EXPECT_LE(1, dirty_page_count(f));
+  EXPECT_GE(7, dirty_page_count(f));
+  EXPECT_TRUE(h8_file_checkpoint(&f));
+  EXPECT_EQ(0, h8_file_pop(&f));
+  EXPECT_LE(1, dirty_page_count(f));
+  EXPECT_GE(8, dirty_page_count(f));
+  EXPECT_TRUE(h8_file_close(&f));
+
+  ASSERT_TRUE(h8_file_open(&f, path_.c_str()));
+  EXPECT_EQ(n, f.heap.size);
+  EXPECT_TRUE(h8_heap_is_heap(&f.heap));
+  EXPECT_TRUE(h8_file_close(&f));
+}
+
+TEST_F(H8FileTest, repair_after_crash) {
+  h8_file f;
+  ASSERT_TRUE(h8_file_open(&f, path_.c_str()));
+  for (int i = 100; i > 0; --i) EXPECT_TRUE(h8_file_push(&f, i));
+  EXPECT_TRUE(h8_file_checkpoint(&f));
+  EXPECT_TRUE(h8_file_push(&f, 0));
+  EXPECT_EQ(1, f.header->dirty);
+  // Simulate a crash in the middle of a push: the value is placed at the
+  // end but the pull up never happened.
+  f.heap.array[f.heap.size - 1] = 0;
+  f.heap.array[0] = 200;
+  munmap(f.header, f.mapped_bytes);
+  free(f.dirty_pages);
+  close(f.fd);
+
+  ASSERT_TRUE(h8_file_open(&f, path_.c_str()));
+  EXPECT_EQ(101, f.heap.size);
+  EXPECT_TRUE(h8_heap_is_heap(&f.heap));
+  EXPECT_EQ(0, h8_file_pop(&f));
+  EXPECT_TRUE(h8_file_close(&f));
+}
+
+TEST_F(H8FileTest, invalid) {
+  std::FILE* file = std::fopen(path_.c_str(), "w");
+  ASSERT_NE(nullptr, file);
+  std::fputs("not a heap", file);
+  std::fclose(file);
+  h8_file f;
+  EXPECT_FALSE(h8_file_open(&f, path_.c_str()));
+}
+
+} // namespace
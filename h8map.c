@@ -0,0 +1,215 @@
+/*
+   gcc -g -std=c11 -msse4 -c h8map.c # optimize with -O2 -DNDEBUG
+*/
+
+#include "h8map.h"
+#include "h8.h"
+#include "h8_inline.h"
+#include "minpos.h"
+#include "v128.h"
+#include "align.h"
+#include <assert.h> // assert
+#include <stdbool.h> // bool
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // SIZE_MAX, UINT16_MAX
+#include <stdlib.h> // realloc, free
+#include <string.h> // memcpy
+
+//// Private functions: ////
+
+static unsigned char* payload(h8_map const* m, size_t index) {
+  return m->payloads + index * m->payload_size;
+}
+
+static void copy_payload(h8_map* m, size_t to, size_t from) {
+  memcpy(payload(m, to), payload(m, from), m->payload_size);
+}
+
+static unsigned char* scratch(h8_map const* m) {
+  return payload(m, m->payload_capacity);
+}
+
+// Grows the payloads to match the capacity of the keys, plus the scratch slot.
+static bool payloads_reserve(h8_map* m) {
+  size_t n = m->keys.capacity;
+  if (n <= m->payload_capacity && m->payloads) return true;
+  if (n >= SIZE_MAX / m->payload_size) return false;
+  unsigned char* ptr = (unsigned char*)realloc(m->payloads, (n + 1) * m->payload_size);
+  if (!ptr) return false;
+  m->payloads = ptr;
+  m->payload_capacity = n;
+  return true;
+}
+
+// Like h8_map_pop but the payload may only be copied to scratch space or
+// outside the map.
+static h8_value_type map_pop(h8_map* m, void* out) {
+  h8_heap* h = &m->keys;
+  assert(h->size > 0);
+  minpos_type x = h8i_vector_minpos(h, 0);
+  h8_value_type b = minpos_min(x);
+  size_t q = minpos_pos(x);
+  if (out) memcpy(out, payload(m, q), m->payload_size);
+  h8_value_type a = h->array[h->size - 1];
+  h->array[h->size - 1] = UINT16_MAX;
+  h->size--;
+  // The last payload is beyond the new size so push_down doesn't overwrite it.
+  if (q != h->size) h8_map_push_down(m, a, payload(m, h->size), q);
+  return b;
+}
+
+//// Public functions: ////
+
+void h8_map_init(h8_map* m, size_t payload_size) {
+  assert(payload_size > 0);
+  h8_heap_init(&m->keys);
+  m->payloads = NULL;
+  m->payload_size = payload_size;
+  m->payload_capacity = 0;
+}
+
+void h8_map_clear(h8_map* m) {
+  h8_heap_clear(&m->keys);
+  free(m->payloads);
+  h8_map_init(m, m->payload_size);
+}
+
+bool h8_map_reserve(h8_map* m, size_t n) {
+  return h8_heap_reserve(&m->keys, n) && payloads_reserve(m);
+}
+
+bool h8_map_extend(h8_map* m, size_t n) {
+  size_t size = m->keys.size;
+  if (!h8_heap_extend(&m->keys, n)) return false;
+  if (!payloads_reserve(m)) {
+    // The padding beyond size is intact, extend only writes new vectors.
+    m->keys.size = size;
+    return false;
+  }
+  return true;
+}
+
+void h8_map_set_entry(h8_map* m, size_t index, h8_value_type key, void const* t) {
+  assert(index < m->keys.size);
+  m->keys.array[index] = key;
+  memcpy(payload(m, index), t, m->payload_size);
+}
+
+void h8_map_pull_up(h8_map* m, h8_value_type b, void const* t, size_t q) {
+  h8_heap* h = &m->keys;
+  assert(q < h->size);
+  while (q >= H8_ARITY) {
+    size_t p = h8i_parent(q);
+    h8_value_type a = h->array[p];
+    if (a <= b) break;
+    h->array[q] = a;
+    copy_payload(m, q, p);
+    q = p;
+  }
+  h->array[q] = b;
+  memcpy(payload(m, q), t, m->payload_size);
+}
+
+void h8_map_push_down(h8_map* m, h8_value_type a, void const* s, size_t p) {
+  h8_heap* h = &m->keys;
+  assert(p < h->size);
+  while (true) {
+    size_t q = h8i_children(p);
+    if (q >= h->size) break;
+    minpos_type x = h8i_vector_minpos(h, q);
+    h8_value_type b = minpos_min(x);
+    if (a <= b) break;
+    h->array[p] = b;
+    q += minpos_pos(x);
+    copy_payload(m, p, q);
+    p = q;
+  }
+  h->array[p] = a;
+  memcpy(payload(m, p), s, m->payload_size);
+}
+
+void h8_map_heapify(h8_map* m) {
+  h8_heap* h = &m->keys;
+  if (h->size <= H8_ARITY) return;
+
+  size_t q = align_down(h->size - 1, H8_ARITY);
+
+  // The first while loop is an optimization for the bottom level of the heap,
+  // inlining the call to push_down which is trivial at the bottom level.
+  size_t r = h8i_parent(q);
+  while (q > r) {
+    minpos_type x = h8i_vector_minpos(h, q);
+    h8_value_type b = minpos_min(x);
+    size_t p = h8i_parent(q);
+    h8_value_type a = h->array[p];
+    if (b < a) {
+      size_t q_new = q + minpos_pos(x);
+      memcpy(scratch(m), payload(m, p), m->payload_size);
+      copy_payload(m, p, q_new);
+      h->array[p] = b;
+      h->array[q_new] = a;
+      memcpy(payload(m, q_new), scratch(m), m->payload_size);
+    }
+    q -= H8_ARITY;
+  }
+
+  while (q > 0) {
+    minpos_type x = h8i_vector_minpos(h, q);
+    h8_value_type b = minpos_min(x);
+    size_t p = h8i_parent(q);
+    h8_value_type a = h->array[p];
+    if (b < a) {
+      size_t q_new = q + minpos_pos(x);
+      memcpy(scratch(m), payload(m, p), m->payload_size);
+      copy_payload(m, p, q_new);
+      h->array[p] = b;
+      h8_map_push_down(m, a, scratch(m), q_new);
+    }
+    q -= H8_ARITY;
+  }
+}
+
+bool h8_map_is_heap(h8_map const* m) {
+  return h8_heap_is_heap(&m->keys);
+}
+
+bool h8_map_push(h8_map* m, h8_value_type b, void const* t) {
+  if (!h8_map_extend(m, 1)) return false;
+  h8_map_pull_up(m, b, t, m->keys.size - 1);
+  return true;
+}
+
+size_t h8_map_top_index(h8_map const* m) {
+  assert(m->keys.size > 0);
+  return minpos_pos(h8i_vector_minpos(&m->keys, 0));
+}
+
+h8_value_type h8_map_pop(h8_map* m, void* t) {
+  return map_pop(m, t);
+}
+
+void h8_map_sort(h8_map* m) {
+  h8_heap* h = &m->keys;
+  v128 v = kV128Max;
+  size_t x = h->size;
+  size_t i = x % H8_ARITY;
+  x -= i;
+  // Keys are collected in v and stored a vector at a time because minpos
+  // scans whole vectors, payloads are stored right away.
+  if (i != 0) {
+    do {
+      --i;
+      v.values[i] = map_pop(m, scratch(m));
+      memcpy(payload(m, x + i), scratch(m), m->payload_size);
+    } while (i > 0);
+    h8i_vector_set(h, x, v);
+  }
+  while (x > 0) {
+    x -= H8_ARITY;
+    for (size_t j = H8_ARITY; j > 0; --j) {
+      v.values[j - 1] = map_pop(m, scratch(m));
+      memcpy(payload(m, x + j - 1), scratch(m), m->payload_size);
+    }
+    h8i_vector_set(h, x, v);
+  }
+}
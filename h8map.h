@@ -0,0 +1,90 @@
+#pragma once
+
+#include "h8.h"
+#include <stdbool.h> // bool
+#include <stddef.h> // size_t
+
+// A heap map in C: h8_heap keys, each with a fixed size payload that moves
+// along with its key, like the C++ Heap8Aux.
+//
+// The keys are scanned 8 at a time with minpos like in h8_heap. The payloads
+// are stored in a separate array, payload_size bytes per entry, and are
+// copied with memcpy so they must be trivially copyable. Payload i starts
+// at byte i * payload_size of a malloc'ed block, so it is aligned to
+// alignof(max_align_t) if payload_size is a multiple of it.
+
+typedef struct {
+  h8_heap keys;
+  unsigned char* payloads;
+  size_t payload_size;
+  // Entries that fit in payloads. One more slot at the end is scratch space
+  // for heapify and sort.
+  size_t payload_capacity;
+} h8_map;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Precondition: payload_size > 0.
+void h8_map_init(h8_map* m, size_t payload_size);
+
+// Frees the keys and payloads. The payload size is kept.
+void h8_map_clear(h8_map* m);
+
+static inline size_t h8_map_size(h8_map const* m) { return m->keys.size; }
+
+static inline h8_value_type h8_map_key(h8_map const* m, size_t index) {
+  return m->keys.array[index];
+}
+
+static inline void* h8_map_payload(h8_map const* m, size_t index) {
+  return m->payloads + index * m->payload_size;
+}
+
+// Grows the capacity to at least n entries without changing the size.
+// Returns false if memory allocation fails or n > H8_SIZE_MAX.
+bool h8_map_reserve(h8_map* m, size_t n);
+
+// Increases the map by n entries at the end with unspecified keys and
+// payloads. Like h8_heap_extend this breaks the heap invariant: the caller
+// must populate the new entries with h8_map_set_entry and call
+// h8_map_heapify.
+// Returns false if memory allocation fails or the size would exceed
+// H8_SIZE_MAX.
+bool h8_map_extend(h8_map* m, size_t n);
+
+void h8_map_set_entry(h8_map* m, size_t index, h8_value_type key, void const* payload);
+
+// In the sifts the payload t or s must not point into m's payloads.
+void h8_map_pull_up(h8_map* m, h8_value_type b, void const* t, size_t q);
+
+void h8_map_push_down(h8_map* m, h8_value_type a, void const* s, size_t p);
+
+void h8_map_heapify(h8_map* m);
+
+bool h8_map_is_heap(h8_map const* m);
+
+// Adds key b with a copy of the payload pointed to by t.
+// Precondition: h8_map_is_heap(m).
+// Returns false if memory allocation fails or the map is full.
+bool h8_map_push(h8_map* m, h8_value_type b, void const* t);
+
+// Index of the entry with the minimum key.
+// Precondition: h8_map_size(m) > 0.
+size_t h8_map_top_index(h8_map const* m);
+
+// Removes the entry with the minimum key and returns its key. Its payload
+// is copied to *payload unless payload is NULL.
+// Precondition: h8_map_size(m) > 0.
+h8_value_type h8_map_pop(h8_map* m, void* payload);
+
+// Precondition: h8_map_is_heap(m).
+// Postcondition: the size is zero and the former entries are in positions
+// [0, former size) in descending key order, readable with h8_map_key and
+// h8_map_payload until the next mutation.
+void h8_map_sort(h8_map* m);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,156 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   gcc -g -std=c11 -msse4 -c h8.c h8map.c &&
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main h8.o h8map.o h8mapTest.cpp
+*/
+
+#include "h8map.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+
+namespace {
+
+// Odd sized payload to exercise unaligned payload copies.
+struct Payload {
+  uint16_t key;
+  char text[11];
+};
+
+Payload payload(uint16_t key) {
+  Payload t;
+  t.key = key;
+  std::snprintf(t.text, sizeof(t.text), "v%u", key);
+  return t;
+}
+
+void expectPayload(uint16_t key, void const* ptr) {
+  Payload t;
+  std::memcpy(&t, ptr, sizeof(t));
+  EXPECT_EQ(key, t.key);
+  EXPECT_EQ("v" + std::to_string(key), std::string(t.text));
+}
+
+TEST(h8map, init_clear) {
+  h8_map m;
+  h8_map_init(&m, sizeof(Payload));
+  EXPECT_EQ(0, h8_map_size(&m));
+  EXPECT_EQ(sizeof(Payload), m.payload_size);
+  Payload t = payload(7);
+  EXPECT_TRUE(h8_map_push(&m, 7, &t));
+  EXPECT_EQ(1, h8_map_size(&m));
+  h8_map_clear(&m);
+  EXPECT_EQ(0, h8_map_size(&m));
+  EXPECT_EQ(nullptr, m.payloads);
+  EXPECT_EQ(sizeof(Payload), m.payload_size);
+}
+
+TEST(h8map, push_pop_3) {
+  h8_map m;
+  h8_map_init(&m, sizeof(Payload));
+  for (uint16_t k : {2, 1, 3}) {
+    Payload t = payload(k);
+    EXPECT_TRUE(h8_map_push(&m, k, &t));
+  }
+  EXPECT_TRUE(h8_map_is_heap(&m));
+  EXPECT_EQ(1, h8_map_key(&m, h8_map_top_index(&m)));
+  expectPayload(1, h8_map_payload(&m, h8_map_top_index(&m)));
+  for (uint16_t k : {1, 2, 3}) {
+    Payload t;
+    EXPECT_EQ(k, h8_map_pop(&m, &t));
+    expectPayload(k, &t);
+  }
+  EXPECT_EQ(0, h8_map_size(&m));
+  h8_map_clear(&m);
+}
+
+TEST(h8map, extend_heapify_100) {
+  h8_map m;
+  h8_map_init(&m, sizeof(Payload));
+  size_t const n = 100;
+  EXPECT_TRUE(h8_map_extend(&m, n));
+  EXPECT_EQ(n, h8_map_size(&m));
+  for (size_t i = 0; i < n; ++i) {
+    uint16_t k = n - 1 - i;
+    Payload t = payload(k);
+    h8_map_set_entry(&m, i, k, &t);
+  }
+  h8_map_heapify(&m);
+  EXPECT_TRUE(h8_map_is_heap(&m));
+  for (size_t i = 0; i < n; ++i) {
+    Payload t;
+    EXPECT_EQ(i, h8_map_pop(&m, &t));
+    expectPayload(i, &t);
+  }
+  h8_map_clear(&m);
+}
+
+TEST(h8map, pop_without_payload) {
+  h8_map m;
+  h8_map_init(&m, sizeof(uint64_t));
+  uint64_t t = 42;
+  EXPECT_TRUE(h8_map_push(&m, 5, &t));
+  EXPECT_EQ(5, h8_map_pop(&m, NULL));
+  h8_map_clear(&m);
+}
+
+TEST(h8map, push_down) {
+  h8_map m;
+  h8_map_init(&m, sizeof(Payload));
+  for (uint16_t k = 0; k < 20; ++k) {
+    Payload t = payload(k);
+    EXPECT_TRUE(h8_map_push(&m, k, &t));
+  }
+  // Replace the top entry, like a pop followed by a push.
+  Payload t = payload(100);
+  h8_map_push_down(&m, 100, &t, h8_map_top_index(&m));
+  EXPECT_TRUE(h8_map_is_heap(&m));
+  for (uint16_t k = 1; k < 20; ++k) EXPECT_EQ(k, h8_map_pop(&m, NULL));
+  Payload u;
+  EXPECT_EQ(100, h8_map_pop(&m, &u));
+  expectPayload(100, &u);
+  h8_map_clear(&m);
+}
+
+TEST(h8map, sort_random) {
+  std::default_random_engine gen(0);
+  std::uniform_int_distribution<uint16_t> distr(0, 999);
+  for (size_t n : {0, 1, 7, 8, 9, 100, 1001}) {
+    h8_map m;
+    h8_map_init(&m, sizeof(Payload));
+    EXPECT_TRUE(h8_map_reserve(&m, n));
+    for (size_t i = 0; i < n; ++i) {
+      uint16_t k = distr(gen);
+      Payload t = payload(k);
+      EXPECT_TRUE(h8_map_push(&m, k, &t));
+    }
+    h8_map_sort(&m);
+    EXPECT_EQ(0, h8_map_size(&m));
+    for (size_t i = 0; i < n; ++i) {
+      if (i > 0) {
+        EXPECT_GE(h8_map_key(&m, i - 1), h8_map_key(&m, i));
+      }
+      expectPayload(h8_map_key(&m, i), h8_map_payload(&m, i));
+    }
+    h8_map_clear(&m);
+  }
+}
+
+TEST(h8map, extend_too_much) {
+  h8_map m;
+  h8_map_init(&m, sizeof(uint64_t));
+  uint64_t t = 42;
+  EXPECT_TRUE(h8_map_push(&m, 1, &t));
+  EXPECT_FALSE(h8_map_extend(&m, H8_SIZE_MAX));
+  EXPECT_EQ(1, h8_map_size(&m));
+  EXPECT_EQ(1, h8_map_pop(&m, &t));
+  EXPECT_EQ(42, t);
+  h8_map_clear(&m);
+}
+
+} // namespace
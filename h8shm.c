@@ -0,0 +1,259 @@
+/*
+   gcc -g -std=c11 -msse4 -c h8shm.c # optimize with -O2 -DNDEBUG
+*/
+
+#define _POSIX_C_SOURCE 200809L // shm_open, pthread_mutexattr_setrobust
+
+#include "h8shm.h"
+#include "h8.h"
+#include "h8_inline.h"
+#include "align.h"
+#include <assert.h> // assert
+#include <errno.h> // errno, EAGAIN, EINVAL, EOWNERDEAD
+#include <fcntl.h> // O_CREAT, O_EXCL, O_RDWR
+#include <pthread.h>
+#include <stdbool.h> // bool
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint64_t, UINT16_MAX
+#include <sys/mman.h> // mmap, munmap, shm_open, shm_unlink
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, ftruncate
+
+//// Private constants: ////
+
+#define MAGIC 0x38686561u // "8hea"
+#define ARRAY_OFFSET align_up(sizeof(h8_shm_header), 64) // cache line
+
+//// Private functions: ////
+
+static h8_value_type* shm_array(h8_shm* q) {
+  return (h8_value_type*)((char*)q->header + ARRAY_OFFSET);
+}
+
+// A h8_heap view of the shared array, valid while the lock is held.
+static h8_heap shm_heap(h8_shm* q) {
+  h8_heap h;
+  h8_heap_init_flags(&h, H8_HEAP_BORROWED);
+  h.array = shm_array(q);
+  h.capacity = q->header->capacity;
+  h.size = q->header->size;
+  return h;
+}
+
+// A process can die between any two of its stores to the segment, so the
+// compiler must keep them in program order around the stores to hole and
+// size, which tell the recovery in shm_lock how far a push or pop got.
+
+static void set_hole(h8_shm_header* header, uint64_t hole) {
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  header->hole = hole;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static void set_size(h8_shm_header* header, uint64_t size) {
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  __atomic_store_n(&header->size, size, __ATOMIC_RELAXED);
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static void shm_lock(h8_shm* q) {
+  if (pthread_mutex_lock(&q->header->lock) == EOWNERDEAD) {
+    // The previous owner died, maybe in the middle of a push or pop.
+    h8_shm_header* header = q->header;
+    if (header->hole != H8_SHM_NO_HOLE) {
+      if (header->hole == header->size) set_size(header, header->size + 1);
+      shm_array(q)[header->hole] = header->pending;
+      set_hole(header, H8_SHM_NO_HOLE);
+    }
+    h8_heap h = shm_heap(q);
+    for (size_t i = h.size; !is_aligned(i, H8_ARITY); ++i) {
+      h.array[i] = UINT16_MAX;
+    }
+    h8_heap_heapify(&h);
+    pthread_mutex_consistent(&q->header->lock);
+  }
+}
+
+static void shm_unlock(h8_shm* q) {
+  pthread_mutex_unlock(&q->header->lock);
+}
+
+// Like h8_heap_push and h8_heap_pop, but the values in [0, size) other than
+// the hole, plus pending if there is a hole, are the values in the queue
+// after every store, and size is published by every push and pop.
+
+static bool shm_push(h8_shm* q, h8_value_type b) {
+  h8_shm_header* header = q->header;
+  h8_heap h = shm_heap(q);
+  size_t i = h.size;
+  if (i == h.capacity) return false;
+  if (is_aligned(i, H8_ARITY)) h8i_vector_set(&h, i, kV128Max);
+  header->pending = b;
+  set_hole(header, i);
+  h.size = i + 1;
+  set_size(header, h.size);
+  while (i >= H8_ARITY) {
+    size_t p = h8i_parent(i);
+    h8_value_type a = h.array[p];
+    if (a <= b) break;
+    h.array[i] = a;
+    set_hole(header, p);
+    i = p;
+  }
+  h.array[i] = b;
+  set_hole(header, H8_SHM_NO_HOLE);
+  return true;
+}
+
+static h8_value_type shm_pop(h8_shm* q) {
+  h8_shm_header* header = q->header;
+  h8_heap h = shm_heap(q);
+  assert(h.size > 0);
+  minpos_type x = h8i_vector_minpos(&h, 0);
+  h8_value_type b = minpos_min(x);
+  size_t last = h.size - 1;
+  h8_value_type a = h.array[last];
+  header->pending = a;
+  set_hole(header, last);
+  h.size = last;
+  set_size(header, last);
+  h.array[last] = UINT16_MAX;
+  size_t p = minpos_pos(x);
+  if (p != last) {
+    set_hole(header, p); // b is gone from here on
+    while (true) {
+      size_t i = h8i_children(p);
+      if (i >= h.size) break;
+      minpos_type y = h8i_vector_minpos(&h, i);
+      h8_value_type c = minpos_min(y);
+      if (a <= c) break;
+      h.array[p] = c;
+      p = i + minpos_pos(y);
+      set_hole(header, p);
+    }
+    h.array[p] = a;
+  }
+  set_hole(header, H8_SHM_NO_HOLE);
+  return b;
+}
+
+static bool shm_map(h8_shm* q, int fd, size_t num_bytes) {
+  void* ptr = mmap(NULL, num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int saved_errno = errno;
+  close(fd);
+  errno = saved_errno;
+  if (ptr == MAP_FAILED) return false;
+  q->header = (h8_shm_header*)ptr;
+  q->mapped_bytes = num_bytes;
+  return true;
+}
+
+//// Public functions: ////
+
+bool h8_shm_create(h8_shm* q, char const* name, size_t capacity) {
+  if (capacity > H8_SIZE_MAX) {
+    errno = EINVAL;
+    return false;
+  }
+  capacity = align_up(capacity, H8_ARITY);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) return false;
+  size_t num_bytes = ARRAY_OFFSET + capacity * sizeof(h8_value_type);
+  if (ftruncate(fd, (off_t)num_bytes) != 0) {
+    int saved_errno = errno;
+    close(fd);
+    shm_unlink(name);
+    errno = saved_errno;
+    return false;
+  }
+  if (!shm_map(q, fd, num_bytes)) {
+    int saved_errno = errno;
+    shm_unlink(name);
+    errno = saved_errno;
+    return false;
+  }
+  h8_shm_header* header = q->header;
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&header->lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+  header->version = H8_SHM_VERSION;
+  header->capacity = capacity;
+  header->size = 0;
+  header->hole = H8_SHM_NO_HOLE;
+  header->pending = 0;
+  // Published last so h8_shm_open never sees a half initialized header.
+  __atomic_store_n(&header->magic, MAGIC, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool h8_shm_open(h8_shm* q, char const* name) {
+  int fd = shm_open(name, O_RDWR, 0600);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return false;
+  }
+  if ((size_t)st.st_size < ARRAY_OFFSET) {
+    // h8_shm_create hasn't sized the segment yet.
+    close(fd);
+    errno = EAGAIN;
+    return false;
+  }
+  if (!shm_map(q, fd, (size_t)st.st_size)) return false;
+  h8_shm_header* header = q->header;
+  bool valid =
+    __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == MAGIC &&
+    header->version == H8_SHM_VERSION &&
+    ARRAY_OFFSET + header->capacity * sizeof(h8_value_type) <= q->mapped_bytes;
+  if (!valid) {
+    int saved_errno = header->magic == 0 ? EAGAIN : EINVAL;
+    h8_shm_close(q);
+    errno = saved_errno;
+    return false;
+  }
+  return true;
+}
+
+void h8_shm_close(h8_shm* q) {
+  munmap(q->header, q->mapped_bytes);
+  q->header = NULL;
+  q->mapped_bytes = 0;
+}
+
+bool h8_shm_unlink(char const* name) {
+  return shm_unlink(name) == 0;
+}
+
+size_t h8_shm_size(h8_shm const* q) {
+  return __atomic_load_n(&q->header->size, __ATOMIC_RELAXED);
+}
+
+bool h8_shm_push(h8_shm* q, h8_value_type b) {
+  return h8_shm_push_n(q, &b, 1) == 1;
+}
+
+bool h8_shm_pop(h8_shm* q, h8_value_type* b) {
+  return h8_shm_pop_n(q, b, 1) == 1;
+}
+
+size_t h8_shm_push_n(h8_shm* q, h8_value_type const* values, size_t n) {
+  shm_lock(q);
+  size_t i = 0;
+  while (i < n && shm_push(q, values[i])) ++i;
+  shm_unlock(q);
+  return i;
+}
+
+size_t h8_shm_pop_n(h8_shm* q, h8_value_type* values, size_t n) {
+  shm_lock(q);
+  size_t i = 0;
+  for (; i < n && q->header->size > 0; ++i) values[i] = shm_pop(q);
+  shm_unlock(q);
+  return i;
+}
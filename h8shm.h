@@ -0,0 +1,82 @@
+#pragma once
+
+#include "h8.h"
+#include <pthread.h> // pthread_mutex_t
+#include <stdbool.h> // bool
+#include <stddef.h> // size_t
+#include <stdint.h> // uint32_t, uint64_t
+
+// A h8_heap in a POSIX shared memory segment that several processes can
+// push to and pop from concurrently without a broker process.
+//
+// The segment holds a header with a process-shared mutex followed by the
+// heap array at a fixed offset, so no pointers are stored in shared memory
+// and every process can map the segment at a different address. The
+// capacity is fixed when the segment is created.
+//
+// The lock is a robust mutex. If a process dies while it holds the lock,
+// the next process to take it recovers the queue: every push and pop that
+// returned is kept, and only the value in flight can be affected. A push in
+// progress is either completed or undone, and the value of a pop in progress
+// is either still in the queue or lost with the dead process. No value is
+// ever duplicated or made up. Values popped by an h8_shm_pop_n call of the
+// dead process before the one in progress are lost with it too.
+
+#define H8_SHM_VERSION 2
+#define H8_SHM_NO_HOLE UINT64_MAX
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version; // H8_SHM_VERSION
+  pthread_mutex_t lock; // PTHREAD_PROCESS_SHARED
+  uint64_t capacity; // values in the array after the header
+  uint64_t size;
+  // During a push or pop: the position in the array whose value is stale
+  // and the value that belongs there, which is one past the end if hole is
+  // size. H8_SHM_NO_HOLE otherwise.
+  uint64_t hole;
+  h8_value_type pending;
+} h8_shm_header;
+
+typedef struct {
+  h8_shm_header* header; // start of the mapping in this process
+  size_t mapped_bytes;
+} h8_shm;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Creates the shared memory segment name (see shm_open) with room for
+// capacity values, rounded up to a multiple of H8_ARITY, and maps it.
+// Fails with errno EEXIST if it exists.
+bool h8_shm_create(h8_shm* q, char const* name, size_t capacity);
+
+// Maps an existing segment created by h8_shm_create.
+bool h8_shm_open(h8_shm* q, char const* name);
+
+// Unmaps the segment in this process. The segment stays until unlinked.
+void h8_shm_close(h8_shm* q);
+
+// Removes the segment name, see shm_unlink.
+bool h8_shm_unlink(char const* name);
+
+size_t h8_shm_size(h8_shm const* q);
+
+// Returns false if the queue is full.
+bool h8_shm_push(h8_shm* q, h8_value_type b);
+
+// Returns false if the queue is empty, otherwise pops the minimum into *b.
+bool h8_shm_pop(h8_shm* q, h8_value_type* b);
+
+// Pushes n values under one lock acquisition, fewer if the queue gets full.
+// Returns the number pushed.
+size_t h8_shm_push_n(h8_shm* q, h8_value_type const* values, size_t n);
+
+// Pops up to n values in ascending order under one lock acquisition.
+// Returns the number popped.
+size_t h8_shm_pop_n(h8_shm* q, h8_value_type* values, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
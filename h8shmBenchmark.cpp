@@ -0,0 +1,140 @@
+/*
+   brew install google-benchmark
+   gcc -g -std=c11 -msse4 -O2 -DNDEBUG -c h8.c h8shm.c &&
+   g++ -g -std=c++17 -msse4 -O2 -DNDEBUG -lbenchmark -lpthread -lrt h8.o h8shm.o h8shmBenchmark.cpp
+
+   # throughput of worker processes sharing one queue, through shared memory
+   # or through a broker process that owns the heap and serves pipe requests
+   ./a.out
+*/
+
+#include "h8shm.h"
+#include "H8.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+constexpr int kOpsPerWorker = 100000;
+
+// Each worker alternates pushing a random value and popping the minimum.
+template<class Push, class Pop>
+void work(int seed, Push push, Pop pop) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<uint16_t> distr;
+  for (int i = 0; i < kOpsPerWorker; ++i) {
+    push(distr(gen));
+    pop();
+  }
+}
+
+void waitAll(int count) {
+  for (int i = 0; i < count; ++i) {
+    int status;
+    wait(&status);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) std::abort();
+  }
+}
+
+void bm_shm(benchmark::State& state) {
+  int workers = state.range(0);
+  std::string name = "/h8shmBenchmark." + std::to_string(getpid());
+  for (auto _ : state) {
+    h8_shm q;
+    if (!h8_shm_create(&q, name.c_str(), workers * kOpsPerWorker)) {
+      state.SkipWithError("h8_shm_create failed");
+      return;
+    }
+    for (int w = 0; w < workers; ++w) {
+      if (fork() == 0) {
+        h8_shm r;
+        if (!h8_shm_open(&r, name.c_str())) _exit(1);
+        work(w,
+             [&](uint16_t b) { h8_shm_push(&r, b); },
+             [&]() { h8_value_type b; h8_shm_pop(&r, &b); });
+        h8_shm_close(&r);
+        _exit(0);
+      }
+    }
+    waitAll(workers);
+    h8_shm_close(&q);
+    h8_shm_unlink(name.c_str());
+  }
+  state.SetItemsProcessed(state.iterations() * workers * kOpsPerWorker * 2);
+}
+
+// Broker protocol: workers write requests to one shared pipe, writes of
+// PIPE_BUF bytes or less are atomic. The broker answers pops on a pipe per
+// worker.
+struct Request {
+  uint16_t worker;
+  uint16_t op; // kPush, kPop, kDone
+  uint16_t value;
+};
+enum : uint16_t { kPush, kPop, kDone };
+
+void bm_pipe_broker(benchmark::State& state) {
+  int workers = state.range(0);
+  for (auto _ : state) {
+    int requests[2];
+    if (pipe(requests) != 0) std::abort();
+    std::vector<int> responses(2 * workers);
+    for (int w = 0; w < workers; ++w) {
+      if (pipe(&responses[2 * w]) != 0) std::abort();
+    }
+    for (int w = 0; w < workers; ++w) {
+      if (fork() == 0) {
+        int in = responses[2 * w], out = requests[1];
+        auto send = [&](uint16_t op, uint16_t value) {
+          Request r = { uint16_t(w), op, value };
+          if (write(out, &r, sizeof(r)) != sizeof(r)) _exit(1);
+        };
+        work(w,
+             [&](uint16_t b) { send(kPush, b); },
+             [&]() {
+               send(kPop, 0);
+               uint16_t b;
+               if (read(in, &b, sizeof(b)) != sizeof(b)) _exit(2);
+             });
+        send(kDone, 0);
+        _exit(0);
+      }
+    }
+    // The broker.
+    H8 heap;
+    for (int done = 0; done < workers;) {
+      Request r;
+      if (read(requests[0], &r, sizeof(r)) != sizeof(r)) std::abort();
+      if (r.op == kPush) {
+        heap.push(r.value);
+      } else if (r.op == kPop) {
+        uint16_t b = heap.size() > 0 ? heap.pop() : 0;
+        if (write(responses[2 * r.worker + 1], &b, sizeof(b)) != sizeof(b)) std::abort();
+      } else {
+        ++done;
+      }
+    }
+    waitAll(workers);
+    close(requests[0]);
+    close(requests[1]);
+    for (int fd : responses) close(fd);
+  }
+  state.SetItemsProcessed(state.iterations() * workers * kOpsPerWorker * 2);
+}
+
+void Arguments(benchmark::internal::Benchmark* b) {
+  for (int w = 1; w <= 8; w *= 2) b->Arg(w);
+}
+
+} // namespace
+
+BENCHMARK(bm_shm)->Apply(Arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_pipe_broker)->Apply(Arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,129 @@
+/*
+   # first install gtest as described in h8Test.cpp
+   gcc -g -std=c11 -msse4 -c h8.c h8shm.c &&
+   g++ -g -std=c++17 -msse4 -lgtest -lgtest_main -lpthread -lrt h8.o h8shm.o h8shmTest.cpp
+*/
+
+#include "h8shm.h"
+#include "h8.h"
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+class H8ShmTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    name_ = "/h8shmTest." + std::to_string(getpid());
+    h8_shm_unlink(name_.c_str());
+  }
+  void TearDown() override { h8_shm_unlink(name_.c_str()); }
+  std::string name_;
+};
+
+TEST_F(H8ShmTest, push_pop) {
+  h8_shm q;
+  ASSERT_TRUE(h8_shm_create(&q, name_.c_str(), 100));
+  EXPECT_EQ(104, q.header->capacity); // rounded up to whole vectors
+  EXPECT_EQ(0, h8_shm_size(&q));
+  h8_value_type b;
+  EXPECT_FALSE(h8_shm_pop(&q, &b));
+  for (int i = 104; i > 0; --i) EXPECT_TRUE(h8_shm_push(&q, i));
+  EXPECT_FALSE(h8_shm_push(&q, 0)); // full
+  EXPECT_EQ(104, h8_shm_size(&q));
+  h8_value_type values[10];
+  EXPECT_EQ(10, h8_shm_pop_n(&q, values, 10));
+  for (int i = 0; i < 10; ++i) EXPECT_EQ(i + 1, values[i]);
+  EXPECT_TRUE(h8_shm_pop(&q, &b));
+  EXPECT_EQ(11, b);
+  h8_shm_close(&q);
+}
+
+TEST_F(H8ShmTest, create_existing) {
+  h8_shm q, r;
+  ASSERT_TRUE(h8_shm_create(&q, name_.c_str(), 8));
+  EXPECT_FALSE(h8_shm_create(&r, name_.c_str(), 8));
+  EXPECT_EQ(EEXIST, errno);
+  h8_shm_close(&q);
+}
+
+TEST_F(H8ShmTest, processes) {
+  h8_shm q;
+  ASSERT_TRUE(h8_shm_create(&q, name_.c_str(), 4000));
+  int const kChildren = 4;
+  for (int c = 0; c < kChildren; ++c) {
+    pid_t pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+      h8_shm r;
+      if (!h8_shm_open(&r, name_.c_str())) _exit(1);
+      for (int i = 0; i < 1000; ++i) {
+        if (!h8_shm_push(&r, c * 1000 + i)) _exit(2);
+      }
+      h8_shm_close(&r);
+      _exit(0);
+    }
+  }
+  for (int c = 0; c < kChildren; ++c) {
+    int status;
+    wait(&status);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+  }
+  EXPECT_EQ(kChildren * 1000, h8_shm_size(&q));
+  for (int i = 0; i < kChildren * 1000; ++i) {
+    h8_value_type b;
+    EXPECT_TRUE(h8_shm_pop(&q, &b));
+    EXPECT_EQ(i, b);
+  }
+  h8_shm_close(&q);
+}
+
+// Children that pop and push back values without end are killed at
+// random points. Only values they popped and didn't push back yet are lost,
+// and recovery never duplicates a value or makes one up.
+TEST_F(H8ShmTest, kill) {
+  h8_shm q;
+  int const kValues = 20000, kRounds = 20, kBatch = 16;
+  ASSERT_TRUE(h8_shm_create(&q, name_.c_str(), kValues));
+  std::vector<int> counts(UINT16_MAX + 1);
+  for (int i = 0; i < kValues; ++i) {
+    h8_value_type b = i * 7 % 1000;
+    ASSERT_TRUE(h8_shm_push(&q, b));
+    counts[b]++;
+  }
+  for (int round = 0; round < kRounds; ++round) {
+    pid_t pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+      h8_shm r;
+      if (!h8_shm_open(&r, name_.c_str())) _exit(1);
+      h8_value_type values[kBatch];
+      while (true) h8_shm_push_n(&r, values, h8_shm_pop_n(&r, values, kBatch));
+    }
+    usleep(1000 + 500 * round);
+    kill(pid, SIGKILL);
+    int status;
+    waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFSIGNALED(status));
+  }
+  int size = 0;
+  h8_value_type b, prev = 0;
+  while (h8_shm_pop(&q, &b)) { // the first pop recovers
+    EXPECT_LE(prev, b);
+    EXPECT_LE(0, --counts[b]) << b;
+    prev = b;
+    ++size;
+  }
+  EXPECT_LE(kValues - kRounds * kBatch, size);
+  EXPECT_EQ(0, h8_shm_size(&q));
+  h8_shm_close(&q);
+}
+
+} // namespace
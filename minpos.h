@@ -1,9 +1,27 @@
 #pragma once
 
 #include <stddef.h> // size_t
-#include <stdint.h> // uint16_t
+#include <stdint.h> // uint16_t, uint64_t
+#include <string.h> // memcpy
 #include <emmintrin.h> // __m128i
+
+// Two backends, selected at compile time:
+//
+//  - SSE4.1 with _mm_minpos_epu16, used when compiling with -msse4,
+//  - SWAR (SIMD within a register) with 64 bit scalar arithmetic, used when
+//    SSE4.1 is unavailable, e.g. for x86-64 baseline builds with only SSE2,
+//    or when MINPOS_SWAR is defined.
+//
+// minpos_swar is always defined, minpos_sse41 only with SSE4.1, so they
+// can be compared with each other.
+#if defined(__SSE4_1__) && !defined(MINPOS_SWAR)
+#define MINPOS_SSE41 1
+#define MINPOS_BACKEND "sse4.1"
 #include <smmintrin.h> // _mm_minpos_epu16
+#else
+#define MINPOS_SSE41 0
+#define MINPOS_BACKEND "swar"
+#endif
 
 typedef int minpos_type;
 
@@ -13,10 +31,56 @@ static inline size_t minpos_pos(minpos_type x) { return x >> 16; }
 
 static inline minpos_type minpos_shift(minpos_type x, int i) { return x + (i << 16); }
 
-static inline minpos_type minpos(__m128i mm) {
+// Lane-wise minimum of two words of two 32 bit lanes with values < 2^31.
+static inline uint64_t minpos_swar_min2x32(uint64_t a, uint64_t b) {
+  const uint64_t kHigh = 0x8000000080000000ull;
+  // The high bit of each lane is set where a >= b.
+  uint64_t ge = ((a | kHigh) - b) & kHigh;
+  uint64_t mask = (ge >> 31) * 0xffffffffull;
+  return (b & mask) | (a & ~mask);
+}
+
+// Each value v at position i becomes the key v << 3 | i in a 32 bit lane,
+// so the minimum key gives the minimum value at its lowest position, like
+// _mm_minpos_epu16. Assumes little endian, as on x86.
+static inline minpos_type minpos_swar(__m128i mm) {
+  const uint64_t kEven = 0x0000ffff0000ffffull;
+  uint64_t w[2];
+  memcpy(w, &mm, sizeof(w));
+  // Lanes hold keys for positions {0,2}, {1,3}, {4,6}, {5,7}.
+  uint64_t k0 = ((w[0] & kEven) << 3) | 0x0000000200000000ull;
+  uint64_t k1 = (((w[0] >> 16) & kEven) << 3) | 0x0000000300000001ull;
+  uint64_t k2 = ((w[1] & kEven) << 3) | 0x0000000600000004ull;
+  uint64_t k3 = (((w[1] >> 16) & kEven) << 3) | 0x0000000700000005ull;
+  uint64_t k = minpos_swar_min2x32(minpos_swar_min2x32(k0, k1), minpos_swar_min2x32(k2, k3));
+  uint32_t lo = (uint32_t)k;
+  uint32_t hi = (uint32_t)(k >> 32);
+  uint32_t key = lo < hi ? lo : hi;
+  return (minpos_type)((key >> 3) | ((key & 7) << 16));
+}
+
+static inline minpos_type minpos8_swar(uint16_t const* a) {
+  return minpos_swar(*(__m128i const*)a);
+}
+
+#if MINPOS_SSE41
+static inline minpos_type minpos_sse41(__m128i mm) {
   return _mm_cvtsi128_si32(_mm_minpos_epu16(mm));
 }
 
+static inline minpos_type minpos8_sse41(uint16_t const* a) {
+  return minpos_sse41(*(__m128i const*)a);
+}
+#endif
+
+static inline minpos_type minpos(__m128i mm) {
+#if MINPOS_SSE41
+  return minpos_sse41(mm);
+#else
+  return minpos_swar(mm);
+#endif
+}
+
 static inline minpos_type minpos8(uint16_t const* a) {
   return minpos(*(__m128i const*)a);
 }
@@ -1,6 +1,7 @@
 /*
    brew install google-benchmark
    g++ -g -std=c++17 -msse4 -O2 -DNDEBUG -lbenchmark minposBenchmark.cpp
+   # the swar rows show the cost of running without SSE4.1
 */
 
 #include "minpos.h"
@@ -50,6 +51,10 @@ void Arguments(benchmark::internal::Benchmark* b) {
 BENCHMARK_CAPTURE(bm_minpos,  8, minpos8 )->Apply(Arguments);
 BENCHMARK_CAPTURE(bm_minpos, 16, minpos16)->Apply(Arguments);
 BENCHMARK_CAPTURE(bm_minpos, 32, minpos32)->Apply(Arguments);
+#if MINPOS_SSE41
+BENCHMARK_CAPTURE(bm_minpos, 8_sse41, minpos8_sse41)->Apply(Arguments);
+#endif
+BENCHMARK_CAPTURE(bm_minpos, 8_swar, minpos8_swar)->Apply(Arguments);
 
 int main(int argc, char** argv) {
   initData(kLargestParam);
@@ -1,12 +1,14 @@
 /*
    # first install gtest as described in h8Test.cpp
    g++ -g -std=c++17 -msse4 -lgtest -lgtest_main minposTest.cpp
+   # without -msse4 the tests run against the SWAR backend
 */
 
 #include "minpos.h"
 #include "v128.h"
 #include <stdalign.h> // no <cstdalign> on mac
 #include <cstdint>
+#include <random>
 #include <gtest/gtest.h>
 
 namespace {
@@ -56,4 +58,43 @@ TEST(minpos, minpos32) {
   EXPECT_EQ(20, minpos_pos(mp));
 }
 
+// Scalar reference: the minimum and its lowest position.
+minpos_type minposScalar(v128 v) {
+  int pos = 0;
+  for (int i = 1; i < 8; ++i) {
+    if (v.values[i] < v.values[pos]) pos = i;
+  }
+  return v.values[pos] | (pos << 16);
+}
+
+TEST(minpos, swar) {
+  constexpr uint16_t M = 65535;
+  v128 v0 = { { M - 7, M - 9, M - 13, M - 3, M - 2, M - 3, M - 2, M - 3 } };
+  EXPECT_EQ(M - 13, minpos_min(minpos_swar(v0.mm)));
+  EXPECT_EQ(2, minpos_pos(minpos_swar(v0.mm)));
+  v128 v1 = { { M, M, M, M, M, M, M, M } };
+  EXPECT_EQ(M, minpos_min(minpos_swar(v1.mm)));
+  EXPECT_EQ(0, minpos_pos(minpos_swar(v1.mm)));
+  v128 v2 = { { 5, 3, 4, 3, 0, 7, 0, 1 } };
+  EXPECT_EQ(0, minpos_min(minpos_swar(v2.mm)));
+  EXPECT_EQ(4, minpos_pos(minpos_swar(v2.mm)));
+}
+
+TEST(minpos, swarRandom) {
+  std::default_random_engine gen(0);
+  // Narrow ranges give many ties, which must resolve to the lowest position.
+  for (int range : { 3, 100, 65535 }) {
+    std::uniform_int_distribution<int> distr(65535 - range, 65535);
+    for (int n = 0; n < 10000; ++n) {
+      v128 v;
+      for (int i = 0; i < 8; ++i) v.values[i] = distr(gen);
+      EXPECT_EQ(minposScalar(v), minpos_swar(v.mm)) << v;
+#if MINPOS_SSE41
+      EXPECT_EQ(minpos_sse41(v.mm), minpos_swar(v.mm)) << v;
+#endif
+      EXPECT_EQ(minposScalar(v), minpos(v.mm)) << v;
+    }
+  }
+}
+
 } // namespace
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <stdint.h>
-#include <emmintrin.h>
+#include <emmintrin.h> // SSE2, which every x86-64 has, see minpos.h
 
 // https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
 typedef uint16_t u16x8 __attribute__ ((vector_size (sizeof(uint16_t) * 8)));